@@ -1,8 +1,20 @@
+#ifdef __linux__
+	#define _GNU_SOURCE //For sched_setaffinity
+#endif
+
 #include "interpreter.h"
 
 #include "interpreter_fmt.h"
+#include "interpreter_map.h"
+#include "interpreter_pvec.h"
+#include "interpreter_pmap.h"
+#include "interpreter_intvec.h"
+#include "interpreter_iter.h"
+#include "interpreter_range.h"
 
 #include "../proj_utils.h"
+#include "../regex/regex.h"
+#include "../tui/utf8.h"
 #include <string.h>
 
 #include <stdlib.h>
@@ -56,21 +68,217 @@ void int_clear_extern_fns() {
 	external_functions.items = NULL;
 }
 
+struct r_string *int_new_string(const char *src, unsigned len) {
+	struct r_string *str = s_alloc(sizeof(struct r_string) + len);
+	str->ref_c = 1;
+	str->len = len;
+	str->str = str->data;
+	str->parent = NULL;
+	str->flags = 0;
+	
+	if(src != NULL)
+		memcpy(str->data, src, len);
+	
+	return str;
+}
+
+struct r_string *int_string_slice(struct r_string *str, unsigned start, unsigned len) {
+	S_ASSERT(start + len <= str->len);
+	
+	if(start == 0 && len == str->len) {
+		str->ref_c++;
+		return str;
+	}
+	
+	//Any piece of ascii text is ascii (and valid utf8) too
+	unsigned char flags = str->flags & R_STRING_ASCII ? R_STRING_SCANNED | R_STRING_ASCII | R_STRING_UTF8 : 0;
+	
+	//A slice costs a header and keeps the whole parent alive, so pieces shorter than a header are cheaper to copy
+	if(len < sizeof(struct r_string)) {
+		struct r_string *copy = int_new_string(str->str + start, len);
+		copy->flags = flags;
+		return copy;
+	}
+	
+	struct r_string *parent = str->parent != NULL ? str->parent : str;
+	
+	struct r_string *slice = SALLOC(struct r_string);
+	slice->ref_c = 1;
+	slice->len = len;
+	slice->str = str->str + start;
+	slice->parent = parent;
+	parent->ref_c++;
+	slice->flags = flags;
+	
+	return slice;
+}
+
+struct r_array *int_new_array(unsigned len) {
+	struct r_array *array = s_alloc(sizeof(struct r_array) + sizeof(struct r_val) * len);
+	array->len = len;
+	array->ref_c = 1;
+	array->cap = len;
+	array->items = array->data;
+	array->parent = NULL;
+	
+	return array;
+}
+
+struct r_array *int_array_reserve(struct r_array *array, unsigned cap) {
+	S_ASSERT(array->ref_c == 1 && array->parent == NULL);
+	
+	if(cap <= array->cap)
+		return array;
+	
+	unsigned new_cap = array->cap;
+	while(new_cap < cap) {
+		new_cap += 1;
+		new_cap *= 2;
+	}
+	
+	array = s_realloc(array, sizeof(struct r_array) + sizeof(struct r_val) * new_cap);
+	array->cap = new_cap;
+	array->items = array->data;
+	return array;
+}
+
+struct r_array *int_array_slice(struct r_array *array, unsigned start, unsigned len) {
+	S_ASSERT(start + len <= array->len);
+	
+	if(start == 0 && len == array->len) {
+		array->ref_c++;
+		return array;
+	}
+	
+	//As with strings, pieces smaller than a header are cheaper to copy than to keep the whole parent alive for
+	if(sizeof(struct r_val) * len < sizeof(struct r_array)) {
+		struct r_array *copy = int_new_array(len);
+		for(unsigned i = 0; i < len; i++) {
+			copy->items[i] = array->items[start + i];
+			int_incr_refcount(copy->items[i]);
+		}
+		return copy;
+	}
+	
+	struct r_array *parent = array->parent != NULL ? array->parent : array;
+	
+	struct r_array *slice = SALLOC(struct r_array);
+	slice->len = len;
+	slice->ref_c = 1;
+	slice->cap = 0;
+	slice->items = array->items + start;
+	slice->parent = parent;
+	parent->ref_c++;
+	
+	return slice;
+}
+
+unsigned long long int_string_hash(struct r_string *str) {
+	if(!(str->flags & R_STRING_HASHED)) {
+		str->hash = hash_bytes(str->str, str->len, 0);
+		str->flags |= R_STRING_HASHED;
+	}
+	return str->hash;
+}
+
+static void scan_string(struct r_string *str) {
+	if(str->flags & R_STRING_SCANNED)
+		return;
+	
+	if(utf8_ascii_prefix(str->str, str->len) == str->len)
+		str->flags |= R_STRING_ASCII | R_STRING_UTF8;
+	else if(utf8_validate(str->str, str->len))
+		str->flags |= R_STRING_UTF8;
+	
+	str->flags |= R_STRING_SCANNED;
+}
+
+bool int_string_is_ascii(struct r_string *str) {
+	scan_string(str);
+	return str->flags & R_STRING_ASCII;
+}
+
+bool int_string_is_utf8(struct r_string *str) {
+	scan_string(str);
+	return str->flags & R_STRING_UTF8;
+}
+
+static void free_string(struct r_string *str) {
+	struct r_string *parent = str->parent;
+	s_dealloc(str);
+	
+	if(parent != NULL && --parent->ref_c == 0)
+		s_dealloc(parent);
+}
+
 void int_decr_refcount(struct r_val val) {
 	switch(val.type) {
 		case TYPE_STR:
 			if(--val.str_v->ref_c == 0)
-				s_dealloc(val.str_v);
+				free_string(val.str_v);
 			break;
 		
 		case TYPE_ARRAY:
 			if(--val.array_v->ref_c == 0) {
+				struct r_array *parent = val.array_v->parent;
+				if(parent != NULL) {
+					s_dealloc(val.array_v);
+					int_decr_refcount((struct r_val) { .type = TYPE_ARRAY, .array_v = parent });
+					break;
+				}
+				
 				for(unsigned i = 0; i < val.array_v->len; i++) {
 					int_decr_refcount(val.array_v->items[i]);
 				}
 				s_dealloc(val.array_v);
 			}
 			break;
+		
+		case TYPE_STRBUILDER:
+			if(--val.builder_v->ref_c == 0) {
+				if(val.builder_v->str != NULL)
+					free_string(val.builder_v->str);
+				s_dealloc(val.builder_v);
+			}
+			break;
+		
+		case TYPE_REGEX:
+			if(--val.regex_v->ref_c == 0) {
+				regex_free(val.regex_v->re);
+				s_dealloc(val.regex_v);
+			}
+			break;
+		
+		case TYPE_MAP:
+		case TYPE_SET:
+			if(--val.map_v->ref_c == 0)
+				int_free_map(val.map_v);
+			break;
+		
+		case TYPE_PVEC:
+			if(--val.pvec_v->ref_c == 0)
+				int_free_pvec(val.pvec_v);
+			break;
+		
+		case TYPE_PMAP:
+			if(--val.pmap_v->ref_c == 0)
+				int_free_pmap(val.pmap_v);
+			break;
+		
+		case TYPE_INTVEC:
+			if(--val.intvec_v->ref_c == 0)
+				s_dealloc(val.intvec_v);
+			break;
+		
+		case TYPE_ITER:
+			if(--val.iter_v->ref_c == 0)
+				int_free_iter(val.iter_v);
+			break;
+		
+		case TYPE_RANGE:
+			if(--val.range_v->ref_c == 0)
+				s_dealloc(val.range_v);
+			break;
 	}
 }
 
@@ -83,6 +291,39 @@ void int_incr_refcount(struct r_val val) {
 		case TYPE_ARRAY:
 			val.array_v->ref_c++;
 			break;
+		
+		case TYPE_STRBUILDER:
+			val.builder_v->ref_c++;
+			break;
+		
+		case TYPE_REGEX:
+			val.regex_v->ref_c++;
+			break;
+		
+		case TYPE_MAP:
+		case TYPE_SET:
+			val.map_v->ref_c++;
+			break;
+		
+		case TYPE_PVEC:
+			val.pvec_v->ref_c++;
+			break;
+		
+		case TYPE_PMAP:
+			val.pmap_v->ref_c++;
+			break;
+		
+		case TYPE_INTVEC:
+			val.intvec_v->ref_c++;
+			break;
+		
+		case TYPE_ITER:
+			val.iter_v->ref_c++;
+			break;
+		
+		case TYPE_RANGE:
+			val.range_v->ref_c++;
+			break;
 	}
 }
 
@@ -104,6 +345,9 @@ struct interp_env {
 	unsigned long long n_entries;
 	struct env_entry *root;
 	FILE *err_out, *std_out, *std_in;
+	struct exec_limits limits;
+	struct exec_stats last_exec;
+	unsigned long long failed_execs;
 };
 
 struct interp_env *int_new_env() {
@@ -114,7 +358,11 @@ struct interp_env *int_new_env() {
 	env->std_out = stdout;
 	env->err_out = stderr;
 	env->std_in = stdin;
-
+	
+	env->limits = (struct exec_limits) { .timeout_ms = 0 };
+	env->last_exec = (struct exec_stats) { .status = 0 };
+	env->failed_execs = 0;
+	
 	return env;
 }
 
@@ -137,6 +385,14 @@ const struct r_val *int_env_get(struct interp_env *env, lstring name) {
 	return NULL;
 }
 
+struct r_val *int_env_get_mut(struct interp_env *env, lstring name) {
+	for(struct env_entry *entry = env->root; entry != NULL; entry = entry->next) {
+		if(lstring_cmp(&entry->name, &name))
+			return entry->flag == ENTRY_FLAG_CONST ? NULL : &entry->val;
+	}
+	return NULL;
+}
+
 int int_env_set(struct interp_env *env, lstring name, struct r_val val, int is_new, int is_const) {
 	for(struct env_entry *entry = env->root; entry != NULL; entry = entry->next) {
 		if(lstring_cmp(&entry->name, &name)) {
@@ -174,6 +430,53 @@ static int match_arity(unsigned args, int arity) {
 
 #define R_VAL_NULL ((struct r_val) { .type = TYPE_NULL })
 
+//---------------------------- Interruption
+
+#include <signal.h>
+
+/*
+An interrupt (SIGINT) only sets a flag, the evaluator checks it at every call and loop boundary and unwinds by returning Null
+until the outermost evaluation is reached. If an external command is running it gets the signal forwarded to its process group.
+*/
+
+static volatile sig_atomic_t interrupt_requested = 0;
+static volatile sig_atomic_t running_pgid = 0;
+static bool job_control = false;
+
+void int_request_interrupt() {
+	interrupt_requested = 1;
+	if(running_pgid > 0)
+		kill(-running_pgid, SIGINT);
+}
+
+bool int_interrupted() {
+	return interrupt_requested;
+}
+
+bool int_take_interrupt() {
+	bool was_requested = interrupt_requested;
+	interrupt_requested = 0;
+	return was_requested;
+}
+
+void int_set_job_control(bool enabled) {
+	job_control = enabled;
+}
+
+void int_reset_exec_signals() {
+	signal(SIGPIPE, SIG_DFL);
+}
+
+static void give_terminal(pid_t pgid) {
+	if(!isatty(STDIN_FILENO))
+		return;
+	
+	//A process that isn't in the foreground group gets SIGTTOU when it calls tcsetpgrp, which is exactly the case when the shell takes the terminal back
+	void (*old_handler)(int) = signal(SIGTTOU, SIG_IGN);
+	tcsetpgrp(STDIN_FILENO, pgid);
+	signal(SIGTTOU, old_handler);
+}
+
 static const char *current_src_name;
 static struct interp_env *current_env;
 
@@ -181,7 +484,17 @@ static struct r_val eval_expr(struct parse_node *expr);
 
 #define ARG_BUFFER_SIZE 32
 
+static struct r_val call_regex(struct r_regex *re, struct r_val *args, unsigned n_args) {
+	if(n_args != 1 || args[0].type != TYPE_STR)
+		return R_VAL_NULL;
+	
+	return (struct r_val) { .type = TYPE_INT, .int_v = regex_is_match(re->re, args[0].str_v->str, args[0].str_v->len) };
+}
+
 struct r_val int_call_r_fn(struct r_val fn, struct r_val *args, unsigned n_args, struct interp_env *env, const char *src_name) {
+	if(interrupt_requested)
+		return R_VAL_NULL;
+	
 	if(fn.type == TYPE_FN) {
 		if(n_args + 1 != fn.fn->expr.n_args)
 			return R_VAL_NULL;
@@ -227,6 +540,8 @@ struct r_val int_call_r_fn(struct r_val fn, struct r_val *args, unsigned n_args,
 			
 			return res;
 		}
+	} else if(fn.type == TYPE_REGEX) {
+		return call_regex(fn.regex_v, args, n_args);
 	}
 	
 	return R_VAL_NULL;
@@ -284,6 +599,14 @@ struct r_val int_call_fn(struct r_val fn, struct parse_node **args, unsigned n_a
 		}
 		
 		return eval_expr(fn.fn->expr.args[n_args]);
+	} else if(fn.type == TYPE_REGEX) {
+		if(n_args != 1)
+			return R_VAL_NULL;
+		
+		struct r_val arg_v = eval_expr(args[0]);
+		struct r_val res = call_regex(fn.regex_v, &arg_v, 1);
+		int_decr_refcount(arg_v);
+		return res;
 	} else {
 		return R_VAL_NULL;
 	}
@@ -304,6 +627,10 @@ static char **args_to_exec_commands(lstring com, struct r_val *args, unsigned n_
 	for(unsigned i = 0; i < n_args; i++) {
 		if(args[i].type == TYPE_ARRAY)
 			n_total_args += args[i].array_v->len;
+		else if(args[i].type == TYPE_INTVEC)
+			n_total_args += args[i].intvec_v->len;
+		else if(args[i].type == TYPE_RANGE) //Each argument takes at least two bytes of the buffer, so longer ranges can't fit anyway
+			n_total_args += args[i].range_v->len < ARG_STRING_BUFFER_SIZE ? args[i].range_v->len : 1;
 		else
 			n_total_args++;
 	}
@@ -323,6 +650,24 @@ static char **args_to_exec_commands(lstring com, struct r_val *args, unsigned n_
 					return NULL;
 				arg_strs[1 + arg_str_i++] = arg_s;
 			}
+		} else if(arg_v.type == TYPE_INTVEC) {
+			for(unsigned j = 0; j < arg_v.intvec_v->len; j++) {
+				char *arg_s = arg_buff;
+				arg_buff = fmt_write_r_val_to_buff(arg_buff, arg_buff_end, (struct r_val) { .type = TYPE_INT, .int_v = arg_v.intvec_v->items[j] }, true);
+				if(arg_buff == NULL)
+					return NULL;
+				arg_strs[1 + arg_str_i++] = arg_s;
+			}
+		} else if(arg_v.type == TYPE_RANGE) {
+			if(arg_v.range_v->len >= ARG_STRING_BUFFER_SIZE)
+				return NULL;
+			for(unsigned j = 0; j < arg_v.range_v->len; j++) {
+				char *arg_s = arg_buff;
+				arg_buff = fmt_write_r_val_to_buff(arg_buff, arg_buff_end, (struct r_val) { .type = TYPE_INT, .int_v = int_range_get(arg_v.range_v, j) }, true);
+				if(arg_buff == NULL)
+					return NULL;
+				arg_strs[1 + arg_str_i++] = arg_s;
+			}
 		} else {
 			char *arg_s = arg_buff;
 			arg_buff = fmt_write_r_val_to_buff(arg_buff, arg_buff_end, arg_v, true);
@@ -335,35 +680,259 @@ static char **args_to_exec_commands(lstring com, struct r_val *args, unsigned n_
 	return arg_strs;
 }
 
-static int exec_command(FILE *err_out, lstring com, struct r_val *args, unsigned n_args, struct interp_env *env) {
-	
-	memory_region *tmp_region = NEW_REGION();
-	int exec_status = -1;
-	
-	char **arg_strs = args_to_exec_commands(com, args, n_args, tmp_region);
+char **int_prepare_command(lstring com, struct r_val *args, unsigned n_args, struct interp_env *env, memory_region *region) {
+	char **arg_strs = args_to_exec_commands(com, args, n_args, region);
 	
 	if(arg_strs == NULL) {
-		fprintf(err_out, "Unable to execute command: Arguments dont fit into string buffer (%u bytes)\n", (unsigned) ARG_STRING_BUFFER_SIZE);
-		goto ERR;
+		fprintf(env->err_out, "Unable to execute command: Arguments dont fit into string buffer (%u bytes)\n", (unsigned) ARG_STRING_BUFFER_SIZE);
+		return NULL;
 	}
 	
-	const char *com_str = arg_strs[0];
-	
-	printf("COM (%s): ", com_str);
+	printf("COM (%s): ", arg_strs[0]);
 	for(char **c = arg_strs; *c != NULL; c++) {
 		fputs(*c, stdout);
 		putchar(' ');
 	}
 	putchar('\n');
 	
-
 	bool needs_user_approve = interpreter_get_config()->user_approve_commands;
-	bool approved = true;
 	
-	if(needs_user_approve)
-		approved = y_or_n_prompt(stdout, stdin, "Approve?");
+	if(needs_user_approve && !y_or_n_prompt(stdout, stdin, "Approve?"))
+		return NULL;
+	
+	return arg_strs;
+}
+
+static struct { struct pending_proc { pid_t pid; int fd; } *items; size_t len, cap; } pending_procs;
+
+void int_add_pending_proc(pid_t pid, int fd) {
+	if(pending_procs.len == pending_procs.cap) {
+		pending_procs.cap += 1;
+		pending_procs.cap *= 2;
+		pending_procs.items = SREALLOC(struct pending_proc, pending_procs.items, pending_procs.cap);
+	}
+	
+	pending_procs.items[pending_procs.len++] = (struct pending_proc) { .pid = pid, .fd = fd };
+}
+
+void int_close_pending_fds() {
+	for(size_t i = 0; i < pending_procs.len; i++)
+		close(pending_procs.items[i].fd);
+}
+
+static void finish_pending_procs() {
+	//The fds are closed before any of the processes are waited for, since a process reading from a pipe only exits once every write end is closed
+	int_close_pending_fds();
+	
+	for(size_t i = 0; i < pending_procs.len; i++) {
+		int status;
+		while(waitpid(pending_procs.items[i].pid, &status, 0) == -1 && errno == EINTR);
+	}
+	
+	pending_procs.len = 0;
+}
+
+#include <signal.h>
+#include <poll.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+
+#ifdef __linux__
+	#include <sched.h>
+	#include <sys/syscall.h>
+#endif
+
+void int_apply_exec_limits(struct interp_env *env) {
+	const struct exec_limits *limits = &env->limits;
+	
+	if(limits->mem_bytes > 0) {
+		struct rlimit lim = { .rlim_cur = limits->mem_bytes, .rlim_max = limits->mem_bytes };
+		setrlimit(RLIMIT_AS, &lim);
+	}
+	
+	if(limits->cpu_secs > 0) {
+		struct rlimit lim = { .rlim_cur = limits->cpu_secs, .rlim_max = limits->cpu_secs };
+		setrlimit(RLIMIT_CPU, &lim);
+	}
+	
+	if(limits->set_nice) {
+		errno = 0;
+		if(nice(limits->nice) == -1 && errno != 0)
+			fprintf(env->err_out, "Unable to set niceness: %s\n", strerror(errno));
+	}
 	
-	if(approved) {
+	#ifdef __linux__
+		if(limits->cores != 0) {
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			for(int i = 0; i < 64; i++) {
+				if(limits->cores & (1ULL << i))
+					CPU_SET(i, &set);
+			}
+			if(sched_setaffinity(0, sizeof(set), &set))
+				fprintf(env->err_out, "Unable to set CPU affinity: %s\n", strerror(errno));
+		}
+	#endif
+}
+
+//Waits for the child for at most timeout_ms milliseconds. Returns 1 if it exited (status is set), 0 on timeout and -1 on error.
+static int wait_child_timeout(pid_t pid, int *status, struct rusage *usage, r_int timeout_ms) {
+	struct timespec start;
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	
+	#if defined(__linux__) && defined(SYS_pidfd_open)
+		int pidfd = syscall(SYS_pidfd_open, pid, 0);
+	#else
+		int pidfd = -1;
+	#endif
+	
+	while(true) {
+		pid_t res = wait4(pid, status, WNOHANG, usage);
+		if(res == pid) {
+			if(pidfd != -1)
+				close(pidfd);
+			return 1;
+		}
+		if(res == -1 && errno != EINTR) {
+			if(pidfd != -1)
+				close(pidfd);
+			return -1;
+		}
+		
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		r_int elapsed = (now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000;
+		if(elapsed >= timeout_ms) {
+			if(pidfd != -1)
+				close(pidfd);
+			return 0;
+		}
+		
+		if(pidfd != -1) {
+			//A pidfd becomes readable once the process has exited
+			struct pollfd pfd = { .fd = pidfd, .events = POLLIN };
+			poll(&pfd, 1, timeout_ms - elapsed);
+		} else {
+			//Without pidfds there is nothing to block on, so fall back to polling in short intervals
+			struct timespec interval = { .tv_sec = 0, .tv_nsec = 10 * 1000000 };
+			nanosleep(&interval, NULL);
+		}
+	}
+}
+
+//---------------------------- Command profiling
+
+struct exec_profile_entry {
+	char *name;
+	unsigned long long count, failures;
+	r_int wall_us, user_us, sys_us, max_rss_kb, minor_faults, major_faults;
+};
+
+static struct { struct exec_profile_entry *items; size_t len, cap; } exec_profile;
+
+static void record_exec_profile(lstring com, const struct exec_stats *stats) {
+	struct exec_profile_entry *entry = NULL;
+	for(size_t i = 0; i < exec_profile.len; i++) {
+		if(cmp_len_strs(exec_profile.items[i].name, strlen(exec_profile.items[i].name), com.str, com.len)) {
+			entry = &exec_profile.items[i];
+			break;
+		}
+	}
+	
+	if(entry == NULL) {
+		if(exec_profile.len == exec_profile.cap) {
+			exec_profile.cap += 1;
+			exec_profile.cap *= 2;
+			exec_profile.items = SREALLOC(struct exec_profile_entry, exec_profile.items, exec_profile.cap);
+		}
+		
+		entry = &exec_profile.items[exec_profile.len++];
+		*entry = (struct exec_profile_entry) { .name = lstring_to_cstr(com, NULL) };
+	}
+	
+	entry->count++;
+	if(stats->status != 0)
+		entry->failures++;
+	
+	entry->wall_us += stats->wall_us;
+	entry->user_us += stats->user_us;
+	entry->sys_us += stats->sys_us;
+	entry->minor_faults += stats->minor_faults;
+	entry->major_faults += stats->major_faults;
+	if(stats->max_rss_kb > entry->max_rss_kb)
+		entry->max_rss_kb = stats->max_rss_kb;
+}
+
+void int_print_exec_profile(FILE *f) {
+	if(exec_profile.len == 0)
+		return;
+	
+	fprintf(f, "%-20s %8s %8s %12s %12s %12s %12s %10s %10s\n", "command", "runs", "failed", "wall ms", "user ms", "sys ms", "max rss kB", "minflt", "majflt");
+	
+	for(size_t i = 0; i < exec_profile.len; i++) {
+		struct exec_profile_entry *e = &exec_profile.items[i];
+		fprintf(f, "%-20s %8llu %8llu %12.1f %12.1f %12.1f %12lli %10lli %10lli\n", e->name, e->count, e->failures,
+			e->wall_us / 1000.0, e->user_us / 1000.0, e->sys_us / 1000.0, (long long) e->max_rss_kb, (long long) e->minor_faults, (long long) e->major_faults);
+	}
+}
+
+void int_clear_exec_profile() {
+	for(size_t i = 0; i < exec_profile.len; i++)
+		s_dealloc(exec_profile.items[i].name);
+	
+	s_dealloc(exec_profile.items);
+	exec_profile.items = NULL;
+	exec_profile.len = 0;
+	exec_profile.cap = 0;
+}
+
+const struct exec_stats *int_get_last_exec(struct interp_env *env) {
+	return &env->last_exec;
+}
+
+void int_set_last_exec(struct interp_env *env, const struct exec_stats *stats) {
+	env->last_exec = *stats;
+}
+
+unsigned long long int_count_failed_execs(struct interp_env *env) {
+	return env->failed_execs;
+}
+
+struct exec_limits int_set_exec_limits(struct interp_env *env, struct exec_limits limits) {
+	struct exec_limits old_limits = env->limits;
+	env->limits = limits;
+	return old_limits;
+}
+
+const struct exec_limits *int_get_exec_limits(struct interp_env *env) {
+	return &env->limits;
+}
+
+static int exec_command(FILE *err_out, lstring com, struct r_val *args, unsigned n_args, struct interp_env *env, int out_fd) {
+	
+	memory_region *tmp_region = NEW_REGION();
+	int exec_status = -1;
+	
+	char **arg_strs = int_prepare_command(com, args, n_args, env, tmp_region);
+	
+	if(arg_strs != NULL) {
+		const char *com_str = arg_strs[0];
+		
+		struct rusage usage = { .ru_maxrss = 0 };
+		struct timespec start, end;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		
+		//Closed by a successful exec, so the parent only reads anything from it if the program couldn't be run
+		int exec_pipe[2];
+		if(pipe(exec_pipe) == 0) {
+			fcntl(exec_pipe[0], F_SETFD, FD_CLOEXEC);
+			fcntl(exec_pipe[1], F_SETFD, FD_CLOEXEC);
+		} else {
+			exec_pipe[0] = exec_pipe[1] = -1;
+		}
+		bool exec_failed = false;
+		
 		pid_t res = fork();
 		switch(res) {
 			
@@ -374,51 +943,147 @@ static int exec_command(FILE *err_out, lstring com, struct r_val *args, unsigned
 			
 			case 0:
 				//Inside the newly created child process
-				if(env->std_out != stdout) {
+				if(exec_pipe[0] != -1)
+					close(exec_pipe[0]);
+				if(job_control)
+					setpgid(0, 0);
+				if(out_fd != -1) {
+					dup2(out_fd, STDOUT_FILENO);
+				} else if(env->std_out != stdout) {
 					dup2(fileno(env->std_out), STDOUT_FILENO);
 				}
 				if(env->std_in != stdin) {
 					dup2(fileno(env->std_in), STDIN_FILENO);
 				}
+				int_reset_exec_signals();
+				int_apply_exec_limits(env);
 				execvp(com_str, arg_strs);
 				
 				//This only happens if it was unable to run the program
-				fprintf(err_out, "Unable to exec '%s': %s\n", com_str, strerror(errno));
+				int exec_errno = errno;
+				fprintf(err_out, "Unable to exec '%s': %s\n", com_str, strerror(exec_errno));
+				if(exec_pipe[1] != -1) {
+					ssize_t written = write(exec_pipe[1], &exec_errno, sizeof(exec_errno));
+					(void) written; //If this fails the parent sees the exit status alone, which is all that's left to do
+				}
 				
 				exit(-1);
 			
 			default: {
 				//Everything went well
 				
+				if(job_control) {
+					//Done in both processes, since either one may run first
+					setpgid(res, res);
+					running_pgid = res;
+					give_terminal(res);
+				}
+				
+				if(exec_pipe[1] != -1) {
+					close(exec_pipe[1]);
+					exec_pipe[1] = -1;
+					
+					int exec_errno;
+					ssize_t n;
+					while((n = read(exec_pipe[0], &exec_errno, sizeof(exec_errno))) == -1 && errno == EINTR);
+					exec_failed = n == sizeof(exec_errno);
+				}
+				
 				int status;
+				
+				if(env->limits.timeout_ms > 0) {
+					int waited = wait_child_timeout(res, &status, &usage, env->limits.timeout_ms);
+					if(waited == 0) {
+						kill(res, SIGKILL);
+						while(wait4(res, &status, 0, &usage) == -1 && errno == EINTR);
+						fprintf(err_out, "Command '%s' timed out after %lli ms\n", com_str, (long long) env->limits.timeout_ms);
+						exec_status = -3;
+						break;
+					} else if(waited == -1) {
+						exec_status = -1;
+						break;
+					}
+					goto STATUS;
+				}
+				
 				WAIT:
 				
-				waitpid(res, &status, 0);
-				if(WIFEXITED(status)) {
+				if(wait4(res, &status, 0, &usage) == -1) {
+					if(errno == EINTR)
+						goto WAIT;
+					exec_status = -1;
+					break;
+				}
+				STATUS:
+				if(exec_failed) {
+					exec_status = -1;
+					break;
+				} else if(WIFEXITED(status)) {
 					exec_status = WEXITSTATUS(status);
 					break;
 				} else if(WIFSIGNALED(status)) {
+					//With job control the terminal sends ^C to the commands group only, so the evaluation is interrupted from here instead
+					if(WTERMSIG(status) == SIGINT)
+						int_request_interrupt();
 					exec_status = -2;
 					break;
 				}
 				goto WAIT;
 			}
 		}
+		
+		for(unsigned i = 0; i < 2; i++) {
+			if(exec_pipe[i] != -1)
+				close(exec_pipe[i]);
+		}
+		
+		if(job_control && res > 0) {
+			running_pgid = 0;
+			give_terminal(getpgrp());
+		}
+		
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		
+		if(res != -1) {
+			env->last_exec = (struct exec_stats) {
+				.status = exec_status,
+				.wall_us = (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000,
+				.user_us = usage.ru_utime.tv_sec * 1000000LL + usage.ru_utime.tv_usec,
+				.sys_us = usage.ru_stime.tv_sec * 1000000LL + usage.ru_stime.tv_usec,
+				.max_rss_kb = usage.ru_maxrss,
+				.minor_faults = usage.ru_minflt,
+				.major_faults = usage.ru_majflt
+			};
+			
+			if(exec_status != 0)
+				env->failed_execs++;
+			
+			if(interpreter_get_config()->profile_commands)
+				record_exec_profile(com, &env->last_exec);
+		}
 	}
 	
-	free_memory_region(tmp_region);
-	return exec_status;
+	finish_pending_procs();
 	
-	ERR:
 	free_memory_region(tmp_region);
-	
 	return exec_status;
 }
 
+int int_exec_command(struct interp_env *env, lstring com, struct r_val *args, unsigned n_args, int out_fd) {
+	return exec_command(env->err_out, com, args, n_args, env, out_fd);
+}
+
+char **int_exec_args(lstring com, struct r_val *args, unsigned n_args, memory_region *region) {
+	return args_to_exec_commands(com, args, n_args, region);
+}
+
 static struct r_val eval_expr(struct parse_node *expr) {
 	switch(expr->type) {
 		
 		case PNODE_EXPR: { 
+			if(interrupt_requested)
+				return R_VAL_NULL;
+			
 			if(expr->expr.op->type == PNODE_SYM) {
 				const struct r_val *var = int_env_get(current_env, expr->expr.op->str);
 				if(var == NULL) {
@@ -426,9 +1091,10 @@ static struct r_val eval_expr(struct parse_node *expr) {
 					unsigned n_args = expr->expr.n_args;
 					
 					for(unsigned i = 0; i < n_args; i++) {
-						args[i] = eval_expr(expr->expr.args[i]);
+						args[i] = int_iter_force(eval_expr(expr->expr.args[i]), current_env, current_src_name);
 					}
-					exec_command(current_env->err_out, expr->expr.op->str, args, n_args, current_env);
+					if(!interrupt_requested)
+						exec_command(current_env->err_out, expr->expr.op->str, args, n_args, current_env, -1);
 					
 					for(unsigned i = 0; i < n_args; i++) {
 						int_decr_refcount(args[i]);
@@ -446,7 +1112,7 @@ static struct r_val eval_expr(struct parse_node *expr) {
 		
 		case PNODE_BLOCK: {
 			struct r_val res = { .type = TYPE_NULL };
-			for(unsigned i = 0; i < expr->expr.n_args; i++) {
+			for(unsigned i = 0; i < expr->expr.n_args && !interrupt_requested; i++) {
 				int_decr_refcount(res);
 				res = eval_expr(expr->expr.args[i]);
 			}
@@ -466,11 +1132,7 @@ static struct r_val eval_expr(struct parse_node *expr) {
 		
 		case PNODE_SYM: {
 			lstring sym_str = expr->str;
-			struct r_string *new_str = s_alloc(sizeof(struct r_string) + sym_str.len);
-			memcpy((char *) new_str->str, sym_str.str, sym_str.len);
-			new_str->ref_c = 1;
-			//new_str->ref_c = 0;
-			new_str->len = sym_str.len;
+			struct r_string *new_str = int_new_string(sym_str.str, sym_str.len);
 			
 			return (struct r_val) { .type = TYPE_STR, .str_v = new_str }; //This isn't ideal; the interpreter will allocate a new string every time a string constant
 			//is used, even if it's the same one multiple times in a loop.
@@ -482,6 +1144,8 @@ static struct r_val eval_expr(struct parse_node *expr) {
 	}
 }
 
+static unsigned eval_depth = 0;
+
 struct r_val int_eval_expr(struct parse_node *fn, struct interp_env *env, const char *src_name) {
 	const char *tmp_name = current_src_name;
 	struct interp_env *tmp_env = current_env;
@@ -489,11 +1153,22 @@ struct r_val int_eval_expr(struct parse_node *fn, struct interp_env *env, const
 	current_src_name = src_name;
 	current_env = env;
 	
+	if(eval_depth == 0) //An interrupt that arrived between evaluations shouldn't cancel the next one
+		int_take_interrupt();
+	
+	eval_depth++;
 	struct r_val res = eval_expr(fn);
+	eval_depth--;
 	
 	current_src_name = tmp_name;
 	current_env = tmp_env;
 	
+	if(eval_depth == 0 && int_take_interrupt()) {
+		fputs("Interrupted\n", env->err_out);
+		int_decr_refcount(res);
+		return R_VAL_NULL;
+	}
+	
 	return res;
 }
 
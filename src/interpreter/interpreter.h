@@ -13,7 +13,16 @@ enum {
 	TYPE_FN,
 	TYPE_EXT_FN,
 	TYPE_ERR,
-	TYPE_ARRAY
+	TYPE_ARRAY,
+	TYPE_STRBUILDER,
+	TYPE_REGEX,
+	TYPE_MAP,
+	TYPE_SET,
+	TYPE_PVEC,
+	TYPE_PMAP,
+	TYPE_INTVEC,
+	TYPE_ITER,
+	TYPE_RANGE
 };
 
 struct interp_env;
@@ -27,6 +36,14 @@ struct r_intern_fn {
 }; */
 
 struct r_array;
+struct r_strbuilder;
+struct r_regex;
+struct r_map;
+struct r_pvec;
+struct r_pmap;
+struct r_intvec;
+struct r_iter;
+struct r_range;
 
 struct r_val {
 	unsigned char type;
@@ -40,16 +57,57 @@ struct r_val {
 		//struct r_intern_fn *fn;
 		extern_fn ext_fn;
 		struct r_array *array_v;
+		struct r_strbuilder *builder_v;
+		struct r_regex *regex_v;
+		struct r_map *map_v; //Also for TYPE_SET
+		struct r_pvec *pvec_v;
+		struct r_pmap *pmap_v;
+		struct r_intvec *intvec_v;
+		struct r_iter *iter_v;
+		struct r_range *range_v;
 	};
 };
 
 struct r_array {
 	unsigned len, ref_c;
-	struct r_val items[];
+	unsigned cap; //Number of items allocated, 0 for a slice
+	struct r_val *items; //Points to data, or into the parent for a slice
+	struct r_array *parent; //The array a slice references, kept alive by the slice. Always an owning array, never a slice itself.
+	struct r_val data[];
+};
+
+//Allocates an array with a reference count of 1 and len items, which are left for the caller to fill in
+struct r_array *int_new_array(unsigned len);
+//Makes room for at least cap items, growing geometrically so that appending one item at a time is amortised constant time.
+//The array may be moved, so this is only safe on arrays with a single reference, and never on slices.
+struct r_array *int_array_reserve(struct r_array *array, unsigned cap);
+//A view of part of another array, like int_string_slice
+struct r_array *int_array_slice(struct r_array *array, unsigned start, unsigned len);
+
+//A growable string; str->len is the used length, cap the number of bytes allocated after the header
+struct r_strbuilder {
+	unsigned ref_c, cap;
+	struct r_string *str;
+};
+
+//A compiled pattern; calling it with a string tells whether the pattern matches, so it can be given to filter
+struct r_regex {
+	unsigned ref_c;
+	struct regex *re;
 };
 
 void int_decr_refcount(struct r_val val);
 
+//Allocates a string with a reference count of 1, copying len bytes from src unless it is NULL
+struct r_string *int_new_string(const char *src, unsigned len);
+//A string referencing part of another one without copying it; the parent is kept alive for as long as the slice is
+struct r_string *int_string_slice(struct r_string *str, unsigned start, unsigned len);
+
+//Computed on first use and cached in the string header
+unsigned long long int_string_hash(struct r_string *str);
+bool int_string_is_ascii(struct r_string *str);
+bool int_string_is_utf8(struct r_string *str);
+
 void int_incr_refcount(struct r_val val);
 
 typedef struct r_val (*extern_callback_fn)(struct parse_node **, unsigned, struct interp_env *, const char *, struct parse_node *);
@@ -63,12 +121,77 @@ struct interp_env *int_new_env();
 void int_free_env(struct interp_env *env);
 
 const struct r_val *int_env_get(struct interp_env *env, lstring name);
+//For changing a variables value in place; NULL if it doesn't exist or is a constant
+struct r_val *int_env_get_mut(struct interp_env *env, lstring name);
 int int_env_set(struct interp_env *env, lstring name, struct r_val val, int is_new, int is_const);
 
 struct r_val int_eval_expr(struct parse_node *fn, struct interp_env *env, const char *src_name);
 
 struct r_val int_call_r_fn(struct r_val fn, struct r_val *args, unsigned n_args, struct interp_env *env, const char *src_name);
 
+//Builds the argument vector for an external command without announcing it; NULL if the arguments don't fit the string buffer
+char **int_exec_args(lstring com, struct r_val *args, unsigned n_args, memory_region *region);
+
+//Runs an external command the same way as when it is called from a script and returns its exit status.
+//If out_fd isn't -1 the commands stdout is redirected to it instead of the environments stdout.
+int int_exec_command(struct interp_env *env, lstring com, struct r_val *args, unsigned n_args, int out_fd);
+
+//Builds the argument vector for an external command, prints it and asks for approval if the config requires it.
+//Returns NULL if the arguments couldn't be built or if the command was denied. The vector is allocated in the given region.
+char **int_prepare_command(lstring com, struct r_val *args, unsigned n_args, struct interp_env *env, memory_region *region);
+
+#include <sys/types.h>
+#include <stdio.h>
+
+//Resource controls applied to external commands; a zero field means no limit
+struct exec_limits {
+	r_int timeout_ms; //Wall clock time after which the command is killed
+	r_int mem_bytes; //RLIMIT_AS
+	r_int cpu_secs; //RLIMIT_CPU
+	int nice;
+	bool set_nice;
+	unsigned long long cores; //CPU affinity mask, bit n is core n
+};
+
+//Exit status and resource usage of an external command, as reported by wait4
+struct exec_stats {
+	int status; //Exit code, -1 if it couldn't be run, -2 if killed by a signal, -3 if it timed out
+	r_int wall_us, user_us, sys_us;
+	r_int max_rss_kb;
+	r_int minor_faults, major_faults;
+};
+
+const struct exec_stats *int_get_last_exec(struct interp_env *env);
+void int_set_last_exec(struct interp_env *env, const struct exec_stats *stats);
+//The number of external commands run in this environment that exited with a non zero status
+unsigned long long int_count_failed_execs(struct interp_env *env);
+
+//Per command name totals, only collected when profile_commands is set in the config
+void int_print_exec_profile(FILE *f);
+void int_clear_exec_profile();
+
+struct exec_limits int_set_exec_limits(struct interp_env *env, struct exec_limits limits);
+const struct exec_limits *int_get_exec_limits(struct interp_env *env);
+//Applies the current limits (except the timeout) to the calling process; meant to be called in a child between fork and exec
+void int_apply_exec_limits(struct interp_env *env);
+
+//Registers a child whose pipe (fd) has been handed out as an argument, i.e through process substitution. The fd is closed and
+//the child is waited for once the next external command has finished.
+void int_add_pending_proc(pid_t pid, int fd);
+//Closes the parents ends of all pending pipes; used by children that shouldn't hold on to them
+void int_close_pending_fds();
+
+//Async-signal-safe; makes the running evaluation unwind at its next call or loop boundary and forwards SIGINT to the running command
+void int_request_interrupt();
+bool int_interrupted();
+//Returns whether an interrupt was requested, and clears the request
+bool int_take_interrupt();
+//Runs external commands in their own process groups, giving them the terminal while they run. Only meant for interactive use.
+void int_set_job_control(bool enabled);
+//The interpreter ignores SIGPIPE so that writing to a child that has exited fails with EPIPE; this gives the default back to a
+//child between fork and exec, so external commands behave as they would under any other shell
+void int_reset_exec_signals();
+
 #include <stdio.h>
 
 FILE *int_get_stdout(struct interp_env *env);
@@ -5,6 +5,7 @@
 
 struct int_config {
 	bool user_approve_commands;
+	bool profile_commands;
 };
 
 const struct int_config *interpreter_get_config();
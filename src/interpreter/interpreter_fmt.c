@@ -1,4 +1,28 @@
 #include "interpreter_fmt.h"
+#include "interpreter_map.h"
+#include "interpreter_pvec.h"
+#include "interpreter_pmap.h"
+#include "interpreter_intvec.h"
+#include "interpreter_range.h"
+
+//Persistent maps are walked with a callback, these carry the state between entries
+struct pmap_fmt {
+	FILE *f;
+	size_t len;
+	char *buff;
+	bool first;
+};
+
+static void print_pmap_entry(const struct r_map_entry *e, void *ctx) {
+	struct pmap_fmt *fmt = ctx;
+	if(!fmt->first)
+		fputs(", ", fmt->f);
+	fmt->first = false;
+	
+	fmt_print_r_val(fmt->f, e->key);
+	putc(' ', fmt->f);
+	fmt_print_r_val(fmt->f, e->val);
+}
 
 void fmt_print_r_val(FILE *f, struct r_val val) {
 	switch(val.type) {
@@ -14,11 +38,28 @@ void fmt_print_r_val(FILE *f, struct r_val val) {
 			print_len_str(f, val.str_v->str, val.str_v->len); 
 			break;
 		
+		case TYPE_STRBUILDER:
+			if(val.builder_v->str != NULL)
+				print_len_str(f, val.builder_v->str->str, val.builder_v->str->len);
+			break;
+		
 		case TYPE_FN:
 		case TYPE_EXT_FN:
 			fputs("Function", f);
 			break;
 		
+		case TYPE_REGEX:
+			fputs("Regex", f);
+			break;
+		
+		case TYPE_ITER:
+			fputs("Iterator", f);
+			break;
+		
+		case TYPE_RANGE:
+			fprintf(f, "(range %lli %lli %lli)", (long long) val.range_v->start, (long long) val.range_v->stop, (long long) val.range_v->step);
+			break;
+		
 		case TYPE_ARRAY:
 			putc('(', f);
 			for(unsigned i = 0; i < val.array_v->len; i++) {
@@ -29,6 +70,60 @@ void fmt_print_r_val(FILE *f, struct r_val val) {
 			putc(')', f);
 			break;
 		
+		case TYPE_MAP: {
+			putc('{', f);
+			bool first = true;
+			INT_MAP_FOREACH(val.map_v, e) {
+				if(!first)
+					fputs(", ", f);
+				first = false;
+				
+				fmt_print_r_val(f, e->key);
+				putc(' ', f);
+				fmt_print_r_val(f, e->val);
+			}
+			putc('}', f);
+		} break;
+		
+		case TYPE_SET: {
+			fputs("#{", f);
+			bool first = true;
+			INT_MAP_FOREACH(val.map_v, e) {
+				if(!first)
+					putc(' ', f);
+				first = false;
+				fmt_print_r_val(f, e->key);
+			}
+			putc('}', f);
+		} break;
+		
+		case TYPE_PVEC:
+			putc('[', f);
+			for(unsigned i = 0; i < val.pvec_v->len; i++) {
+				if(i != 0)
+					putc(' ', f);
+				fmt_print_r_val(f, int_pvec_get(val.pvec_v, i));
+			}
+			putc(']', f);
+			break;
+		
+		case TYPE_PMAP: {
+			struct pmap_fmt fmt = { .f = f, .first = true };
+			putc('{', f);
+			int_pmap_foreach(val.pmap_v, print_pmap_entry, &fmt);
+			putc('}', f);
+		} break;
+		
+		case TYPE_INTVEC:
+			fputs("#(", f);
+			for(unsigned i = 0; i < val.intvec_v->len; i++) {
+				if(i != 0)
+					putc(' ', f);
+				fprintf(f, "%lli", (long long) val.intvec_v->items[i]);
+			}
+			putc(')', f);
+			break;
+		
 		default:
 			fputs("Unkown value", f);
 			break;
@@ -37,6 +132,262 @@ void fmt_print_r_val(FILE *f, struct r_val val) {
 
 #include <string.h> 
 
+static const char null_text[] = "Null", fn_text[] = "Function", regex_text[] = "Regex", iter_text[] = "Iterator", range_text[] = "(range ", unknown_text[] = "Unkown value";
+
+static const char digit_pairs[] =
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+static unsigned fmt_int_len(r_int v) {
+	unsigned long long u = v < 0 ? -(unsigned long long) v : (unsigned long long) v;
+	
+	unsigned len = 1;
+	for(; u >= 10000; u /= 10000)
+		len += 4;
+	if(u >= 10)
+		len += 1 + (u >= 100) + (u >= 1000);
+	
+	return len + (v < 0);
+}
+
+//Writes the decimal form of v, two digits at a time from the back
+static char *fmt_write_int(char *buff, r_int v) {
+	unsigned long long u = v < 0 ? -(unsigned long long) v : (unsigned long long) v;
+	
+	char *end = buff + fmt_int_len(v);
+	char *p = end;
+	
+	for(; u >= 100; u /= 100) {
+		p -= 2;
+		memcpy(p, digit_pairs + (u % 100) * 2, 2);
+	}
+	if(u >= 10) {
+		p -= 2;
+		memcpy(p, digit_pairs + u * 2, 2);
+	} else
+		*(--p) = '0' + u;
+	
+	if(v < 0)
+		*(--p) = '-';
+	return end;
+}
+
+static void pmap_entry_len(const struct r_map_entry *e, void *ctx) {
+	struct pmap_fmt *fmt = ctx;
+	fmt->len += fmt_r_val_len(e->key) + 1 + fmt_r_val_len(e->val) + (fmt->first ? 0 : 2);
+	fmt->first = false;
+}
+
+static void write_pmap_entry(const struct r_map_entry *e, void *ctx) {
+	struct pmap_fmt *fmt = ctx;
+	if(!fmt->first) {
+		memcpy(fmt->buff, ", ", 2);
+		fmt->buff += 2;
+	}
+	fmt->first = false;
+	
+	fmt->buff = fmt_write_r_val(fmt->buff, e->key);
+	*(fmt->buff++) = ' ';
+	fmt->buff = fmt_write_r_val(fmt->buff, e->val);
+}
+
+size_t fmt_r_val_len(struct r_val val) {
+	switch(val.type) {
+		case TYPE_NULL:
+			return sizeof(null_text) - 1;
+		
+		case TYPE_INT:
+			return fmt_int_len(val.int_v);
+		
+		case TYPE_STR:
+			return val.str_v->len;
+		
+		case TYPE_STRBUILDER:
+			return val.builder_v->str != NULL ? val.builder_v->str->len : 0;
+		
+		case TYPE_FN:
+		case TYPE_EXT_FN:
+			return sizeof(fn_text) - 1;
+		
+		case TYPE_REGEX:
+			return sizeof(regex_text) - 1;
+		
+		case TYPE_ITER:
+			return sizeof(iter_text) - 1;
+		
+		case TYPE_RANGE:
+			return sizeof(range_text) - 1 + fmt_int_len(val.range_v->start) + fmt_int_len(val.range_v->stop) + fmt_int_len(val.range_v->step) + 3;
+		
+		case TYPE_ARRAY: {
+			size_t len = 2;
+			for(unsigned i = 0; i < val.array_v->len; i++)
+				len += fmt_r_val_len(val.array_v->items[i]) + (i != 0);
+			return len;
+		}
+		
+		case TYPE_MAP: {
+			size_t len = 2;
+			INT_MAP_FOREACH(val.map_v, e)
+				len += fmt_r_val_len(e->key) + 1 + fmt_r_val_len(e->val);
+			if(val.map_v->len > 1)
+				len += 2 * (val.map_v->len - 1);
+			return len;
+		}
+		
+		case TYPE_SET: {
+			size_t len = 3;
+			INT_MAP_FOREACH(val.map_v, e)
+				len += fmt_r_val_len(e->key);
+			if(val.map_v->len > 1)
+				len += val.map_v->len - 1;
+			return len;
+		}
+		
+		case TYPE_PVEC: {
+			size_t len = 2;
+			for(unsigned i = 0; i < val.pvec_v->len; i++)
+				len += fmt_r_val_len(int_pvec_get(val.pvec_v, i)) + (i != 0);
+			return len;
+		}
+		
+		case TYPE_PMAP: {
+			struct pmap_fmt fmt = { .len = 2, .first = true };
+			int_pmap_foreach(val.pmap_v, pmap_entry_len, &fmt);
+			return fmt.len;
+		}
+		
+		case TYPE_INTVEC: {
+			size_t len = 3;
+			for(unsigned i = 0; i < val.intvec_v->len; i++)
+				len += fmt_int_len(val.intvec_v->items[i]) + (i != 0);
+			return len;
+		}
+		
+		default:
+			return sizeof(unknown_text) - 1;
+	}
+}
+
+char *fmt_write_r_val(char *buff, struct r_val val) {
+	switch(val.type) {
+		case TYPE_NULL:
+			memcpy(buff, null_text, sizeof(null_text) - 1);
+			return buff + sizeof(null_text) - 1;
+		
+		case TYPE_INT:
+			return fmt_write_int(buff, val.int_v);
+		
+		case TYPE_STR:
+			memcpy(buff, val.str_v->str, val.str_v->len);
+			return buff + val.str_v->len;
+		
+		case TYPE_STRBUILDER:
+			if(val.builder_v->str == NULL)
+				return buff;
+			memcpy(buff, val.builder_v->str->str, val.builder_v->str->len);
+			return buff + val.builder_v->str->len;
+		
+		case TYPE_FN:
+		case TYPE_EXT_FN:
+			memcpy(buff, fn_text, sizeof(fn_text) - 1);
+			return buff + sizeof(fn_text) - 1;
+		
+		case TYPE_REGEX:
+			memcpy(buff, regex_text, sizeof(regex_text) - 1);
+			return buff + sizeof(regex_text) - 1;
+		
+		case TYPE_ITER:
+			memcpy(buff, iter_text, sizeof(iter_text) - 1);
+			return buff + sizeof(iter_text) - 1;
+		
+		case TYPE_RANGE:
+			memcpy(buff, range_text, sizeof(range_text) - 1);
+			buff = fmt_write_int(buff + sizeof(range_text) - 1, val.range_v->start);
+			*(buff++) = ' ';
+			buff = fmt_write_int(buff, val.range_v->stop);
+			*(buff++) = ' ';
+			buff = fmt_write_int(buff, val.range_v->step);
+			*(buff++) = ')';
+			return buff;
+		
+		case TYPE_ARRAY:
+			*(buff++) = '(';
+			for(unsigned i = 0; i < val.array_v->len; i++) {
+				if(i != 0)
+					*(buff++) = ' ';
+				buff = fmt_write_r_val(buff, val.array_v->items[i]);
+			}
+			*(buff++) = ')';
+			return buff;
+		
+		case TYPE_MAP: {
+			*(buff++) = '{';
+			bool first = true;
+			INT_MAP_FOREACH(val.map_v, e) {
+				if(!first) {
+					memcpy(buff, ", ", 2);
+					buff += 2;
+				}
+				first = false;
+				
+				buff = fmt_write_r_val(buff, e->key);
+				*(buff++) = ' ';
+				buff = fmt_write_r_val(buff, e->val);
+			}
+			*(buff++) = '}';
+			return buff;
+		}
+		
+		case TYPE_SET: {
+			memcpy(buff, "#{", 2);
+			buff += 2;
+			bool first = true;
+			INT_MAP_FOREACH(val.map_v, e) {
+				if(!first)
+					*(buff++) = ' ';
+				first = false;
+				buff = fmt_write_r_val(buff, e->key);
+			}
+			*(buff++) = '}';
+			return buff;
+		}
+		
+		case TYPE_PVEC:
+			*(buff++) = '[';
+			for(unsigned i = 0; i < val.pvec_v->len; i++) {
+				if(i != 0)
+					*(buff++) = ' ';
+				buff = fmt_write_r_val(buff, int_pvec_get(val.pvec_v, i));
+			}
+			*(buff++) = ']';
+			return buff;
+		
+		case TYPE_PMAP: {
+			struct pmap_fmt fmt = { .buff = buff + 1, .first = true };
+			*buff = '{';
+			int_pmap_foreach(val.pmap_v, write_pmap_entry, &fmt);
+			*(fmt.buff++) = '}';
+			return fmt.buff;
+		}
+		
+		case TYPE_INTVEC:
+			memcpy(buff, "#(", 2);
+			buff += 2;
+			for(unsigned i = 0; i < val.intvec_v->len; i++) {
+				if(i != 0)
+					*(buff++) = ' ';
+				buff = fmt_write_int(buff, val.intvec_v->items[i]);
+			}
+			*(buff++) = ')';
+			return buff;
+		
+		default:
+			memcpy(buff, unknown_text, sizeof(unknown_text) - 1);
+			return buff + sizeof(unknown_text) - 1;
+	}
+}
+
 static char *write_to_buff(char *buff, char *buff_end, const char *src, size_t len) {
 	if(len > buff_end - buff) {
 		return NULL;
@@ -59,7 +410,14 @@ char *fmt_write_r_val_to_buff(char *buff, char *buff_end, struct r_val val, bool
 	switch(val.type) {
 		case TYPE_STR:
 			buff = write_to_buff(buff, buff_end, val.str_v->str, val.str_v->len);
-			if(c_str)
+			if(c_str && buff != NULL)
+				buff = write_char_to_buff(buff, buff_end, '\0');
+			return buff;
+		
+		case TYPE_STRBUILDER:
+			if(val.builder_v->str != NULL)
+				buff = write_to_buff(buff, buff_end, val.builder_v->str->str, val.builder_v->str->len);
+			if(c_str && buff != NULL)
 				buff = write_char_to_buff(buff, buff_end, '\0');
 			return buff;
 		
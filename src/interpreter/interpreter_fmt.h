@@ -6,6 +6,10 @@
 
 void fmt_print_r_val(FILE *f, struct r_val val);
 
+//The exact length of the text fmt_print_r_val prints for val, and a version writing it to a buffer with room for that many bytes
+size_t fmt_r_val_len(struct r_val val);
+char *fmt_write_r_val(char *buff, struct r_val val);
+
 char *fmt_write_r_val_to_buff(char *buff, char *buff_end, struct r_val val, bool c_str);
 
 #endif
@@ -0,0 +1,256 @@
+#include "interpreter_intvec.h"
+
+struct r_intvec *int_new_intvec(unsigned len) {
+	struct r_intvec *vec = s_alloc(sizeof(struct r_intvec) + sizeof(r_int) * len);
+	vec->len = len;
+	vec->ref_c = 1;
+	return vec;
+}
+
+//Signed overflow is undefined in C, so the arithmetic goes through unsigned
+#define WRAP_ADD(x, y) ((r_int) ((unsigned long long) (x) + (unsigned long long) (y)))
+#define WRAP_SUB(x, y) ((r_int) ((unsigned long long) (x) - (unsigned long long) (y)))
+#define WRAP_MUL(x, y) ((r_int) ((unsigned long long) (x) * (unsigned long long) (y)))
+
+//A scalar operand is read through a mask of 0, so it's always item 0
+#define SCALAR_LOOP(expr) \
+for(; i < n; i++) { \
+	r_int x = a[i & a_mask], y = b[i & b_mask]; \
+	dst[i] = (expr); \
+}
+
+static void apply_scalar(enum intvec_op op, r_int *dst, const r_int *a, bool a_scalar, const r_int *b, bool b_scalar, size_t i, size_t n) {
+	size_t a_mask = a_scalar ? 0 : (size_t) -1, b_mask = b_scalar ? 0 : (size_t) -1;
+	
+	switch(op) {
+		case INTVEC_ADD: SCALAR_LOOP(WRAP_ADD(x, y)) break;
+		case INTVEC_SUB: SCALAR_LOOP(WRAP_SUB(x, y)) break;
+		case INTVEC_MUL: SCALAR_LOOP(WRAP_MUL(x, y)) break;
+		case INTVEC_LESS: SCALAR_LOOP(x < y) break;
+		case INTVEC_GREATER: SCALAR_LOOP(x > y) break;
+		case INTVEC_EQ: SCALAR_LOOP(x == y) break;
+	}
+}
+
+static r_int sum_scalar(const r_int *a, size_t i, size_t n, r_int sum) {
+	for(; i < n; i++)
+		sum = WRAP_ADD(sum, a[i]);
+	return sum;
+}
+
+static r_int min_scalar(const r_int *a, size_t i, size_t n, r_int min) {
+	for(; i < n; i++)
+		min = a[i] < min ? a[i] : min;
+	return min;
+}
+
+static r_int max_scalar(const r_int *a, size_t i, size_t n, r_int max) {
+	for(; i < n; i++)
+		max = a[i] > max ? a[i] : max;
+	return max;
+}
+
+static void prefix_sum_scalar(r_int *dst, const r_int *a, size_t i, size_t n, r_int sum) {
+	for(; i < n; i++) {
+		sum = WRAP_ADD(sum, a[i]);
+		dst[i] = sum;
+	}
+}
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+
+#include <immintrin.h>
+
+#define AVX2 __attribute__((target("avx2")))
+
+static bool use_avx2() {
+	static int supported = -1;
+	if(supported < 0)
+		supported = __builtin_cpu_supports("avx2");
+	return supported;
+}
+
+static inline AVX2 __m256i load4(const r_int *p) {
+	return _mm256_loadu_si256((const __m256i *) p);
+}
+
+static inline AVX2 void store4(r_int *p, __m256i v) {
+	_mm256_storeu_si256((__m256i *) p, v);
+}
+
+//AVX2 only multiplies 32 bit halves, so the low 64 bits of the product are put together from three of those
+static inline AVX2 __m256i mul64(__m256i x, __m256i y) {
+	__m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(x, 32), y), _mm256_mul_epu32(x, _mm256_srli_epi64(y, 32)));
+	return _mm256_add_epi64(_mm256_mul_epu32(x, y), _mm256_slli_epi64(cross, 32));
+}
+
+//Comparisons set all bits of a lane, which the shift turns into 1
+#define AVX2_LOOP(expr) \
+for(; i + 4 <= n; i += 4) { \
+	__m256i x = a_scalar ? a_all : load4(a + i), y = b_scalar ? b_all : load4(b + i); \
+	store4(dst + i, (expr)); \
+}
+
+static AVX2 size_t apply_avx2(enum intvec_op op, r_int *dst, const r_int *a, bool a_scalar, const r_int *b, bool b_scalar, size_t n) {
+	__m256i a_all = _mm256_set1_epi64x(a[0]), b_all = _mm256_set1_epi64x(b[0]);
+	size_t i = 0;
+	
+	switch(op) {
+		case INTVEC_ADD: AVX2_LOOP(_mm256_add_epi64(x, y)) break;
+		case INTVEC_SUB: AVX2_LOOP(_mm256_sub_epi64(x, y)) break;
+		case INTVEC_MUL: AVX2_LOOP(mul64(x, y)) break;
+		case INTVEC_LESS: AVX2_LOOP(_mm256_srli_epi64(_mm256_cmpgt_epi64(y, x), 63)) break;
+		case INTVEC_GREATER: AVX2_LOOP(_mm256_srli_epi64(_mm256_cmpgt_epi64(x, y), 63)) break;
+		case INTVEC_EQ: AVX2_LOOP(_mm256_srli_epi64(_mm256_cmpeq_epi64(x, y), 63)) break;
+	}
+	
+	return i;
+}
+
+static inline AVX2 r_int lane(__m256i v, unsigned i) {
+	r_int lanes[4];
+	store4(lanes, v);
+	return lanes[i];
+}
+
+static AVX2 r_int sum_avx2(const r_int *a, size_t n) {
+	__m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+	size_t i = 0;
+	
+	//Two accumulators so that consecutive adds don't wait on each other
+	for(; i + 8 <= n; i += 8) {
+		acc0 = _mm256_add_epi64(acc0, load4(a + i));
+		acc1 = _mm256_add_epi64(acc1, load4(a + i + 4));
+	}
+	for(; i + 4 <= n; i += 4)
+		acc0 = _mm256_add_epi64(acc0, load4(a + i));
+	
+	acc0 = _mm256_add_epi64(acc0, acc1);
+	r_int sum = WRAP_ADD(WRAP_ADD(lane(acc0, 0), lane(acc0, 1)), WRAP_ADD(lane(acc0, 2), lane(acc0, 3)));
+	return sum_scalar(a, i, n, sum);
+}
+
+//There is no 64 bit min or max before AVX-512, so they are a compare and a blend
+static AVX2 r_int min_avx2(const r_int *a, size_t n) {
+	__m256i acc = _mm256_set1_epi64x(a[0]);
+	size_t i = 0;
+	for(; i + 4 <= n; i += 4) {
+		__m256i x = load4(a + i);
+		acc = _mm256_blendv_epi8(acc, x, _mm256_cmpgt_epi64(acc, x));
+	}
+	
+	r_int min = lane(acc, 0);
+	for(unsigned l = 1; l < 4; l++)
+		min = lane(acc, l) < min ? lane(acc, l) : min;
+	return min_scalar(a, i, n, min);
+}
+
+static AVX2 r_int max_avx2(const r_int *a, size_t n) {
+	__m256i acc = _mm256_set1_epi64x(a[0]);
+	size_t i = 0;
+	for(; i + 4 <= n; i += 4) {
+		__m256i x = load4(a + i);
+		acc = _mm256_blendv_epi8(acc, x, _mm256_cmpgt_epi64(x, acc));
+	}
+	
+	r_int max = lane(acc, 0);
+	for(unsigned l = 1; l < 4; l++)
+		max = lane(acc, l) > max ? lane(acc, l) : max;
+	return max_scalar(a, i, n, max);
+}
+
+static AVX2 size_t find_avx2(const r_int *a, size_t n, r_int val) {
+	__m256i all = _mm256_set1_epi64x(val);
+	size_t i = 0;
+	for(; i + 4 <= n; i += 4) {
+		int hits = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(load4(a + i), all)));
+		if(hits != 0)
+			return i + __builtin_ctz(hits);
+	}
+	
+	for(; i < n; i++) {
+		if(a[i] == val)
+			break;
+	}
+	return i;
+}
+
+//Within each group of 4 the sum is built in two steps, adding the item one before and then the pair two before
+static AVX2 void prefix_sum_avx2(r_int *dst, const r_int *a, size_t n) {
+	__m256i zero = _mm256_setzero_si256(), carry = zero;
+	size_t i = 0;
+	
+	for(; i + 4 <= n; i += 4) {
+		__m256i x = load4(a + i);
+		x = _mm256_add_epi64(x, _mm256_slli_si256(x, 8));
+		x = _mm256_add_epi64(x, _mm256_blend_epi32(zero, _mm256_permute4x64_epi64(x, _MM_SHUFFLE(1, 1, 1, 1)), 0xF0));
+		x = _mm256_add_epi64(x, carry);
+		store4(dst + i, x);
+		carry = _mm256_permute4x64_epi64(x, _MM_SHUFFLE(3, 3, 3, 3));
+	}
+	
+	prefix_sum_scalar(dst, a, i, n, i > 0 ? dst[i - 1] : 0);
+}
+
+#else
+
+static bool use_avx2() {
+	return false;
+}
+
+#define apply_avx2(op, dst, a, a_scalar, b, b_scalar, n) 0
+#define sum_avx2(a, n) 0
+#define min_avx2(a, n) 0
+#define max_avx2(a, n) 0
+#define find_avx2(a, n, val) 0
+#define prefix_sum_avx2(dst, a, n)
+
+#endif
+
+void int_intvec_apply(enum intvec_op op, r_int *dst, const r_int *a, bool a_scalar, const r_int *b, bool b_scalar, size_t n) {
+	size_t done = n > 0 && use_avx2() ? apply_avx2(op, dst, a, a_scalar, b, b_scalar, n) : 0;
+	apply_scalar(op, dst, a, a_scalar, b, b_scalar, done, n);
+}
+
+r_int int_intvec_sum(const r_int *a, size_t n) {
+	return use_avx2() ? sum_avx2(a, n) : sum_scalar(a, 0, n, 0);
+}
+
+r_int int_intvec_min(const r_int *a, size_t n) {
+	S_ASSERT(n > 0);
+	return use_avx2() ? min_avx2(a, n) : min_scalar(a, 1, n, a[0]);
+}
+
+r_int int_intvec_max(const r_int *a, size_t n) {
+	S_ASSERT(n > 0);
+	return use_avx2() ? max_avx2(a, n) : max_scalar(a, 1, n, a[0]);
+}
+
+size_t int_intvec_argmax(const r_int *a, size_t n) {
+	r_int max = int_intvec_max(a, n);
+	
+	if(use_avx2())
+		return find_avx2(a, n, max);
+	
+	size_t i = 0;
+	while(a[i] != max)
+		i++;
+	return i;
+}
+
+void int_intvec_prefix_sum(r_int *dst, const r_int *a, size_t n) {
+	if(use_avx2())
+		prefix_sum_avx2(dst, a, n);
+	else
+		prefix_sum_scalar(dst, a, 0, n, 0);
+}
+
+//Every item is written and the output position only moves on for the kept ones, so there is no branch to mispredict
+size_t int_intvec_select(r_int *dst, const r_int *a, const r_int *mask, size_t n) {
+	size_t n_out = 0;
+	for(size_t i = 0; i < n; i++) {
+		dst[n_out] = a[i];
+		n_out += mask[i] != 0;
+	}
+	return n_out;
+}
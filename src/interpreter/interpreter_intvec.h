@@ -0,0 +1,46 @@
+#ifndef INTERPRETER_INTVEC_H_INCLUDED
+#define INTERPRETER_INTVEC_H_INCLUDED
+
+#include "interpreter.h"
+
+#include <stddef.h>
+
+/*
+ * Packed integer array: the ints are stored directly, 8 bytes each instead of a 16 byte struct r_val, so the kernels
+ * below can work through them with vector instructions. On x86-64 they use AVX2 when the cpu has it, picked at runtime
+ * so that the build needs no extra flags; everywhere else they are plain loops. Arithmetic wraps around on overflow.
+ */
+
+struct r_intvec {
+	unsigned len, ref_c;
+	r_int items[];
+};
+
+//Reference count of 1, items left for the caller to fill in
+struct r_intvec *int_new_intvec(unsigned len);
+
+enum intvec_op {
+	INTVEC_ADD,
+	INTVEC_SUB,
+	INTVEC_MUL,
+	INTVEC_LESS, //The comparisons give 1 or 0, a mask that select and sum understand
+	INTVEC_GREATER,
+	INTVEC_EQ
+};
+
+//dst[i] = a[i] op b[i]. An operand flagged as scalar has its single value used for every i. dst may be a or b.
+void int_intvec_apply(enum intvec_op op, r_int *dst, const r_int *a, bool a_scalar, const r_int *b, bool b_scalar, size_t n);
+
+r_int int_intvec_sum(const r_int *a, size_t n);
+//These need n > 0; argmax gives the first index holding the largest value
+r_int int_intvec_min(const r_int *a, size_t n);
+r_int int_intvec_max(const r_int *a, size_t n);
+size_t int_intvec_argmax(const r_int *a, size_t n);
+
+//dst[i] = a[0] + ... + a[i]; dst may be a
+void int_intvec_prefix_sum(r_int *dst, const r_int *a, size_t n);
+
+//Copies the items whose mask is non zero to dst and returns how many there were; dst may be a
+size_t int_intvec_select(r_int *dst, const r_int *a, const r_int *mask, size_t n);
+
+#endif
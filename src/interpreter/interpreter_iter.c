@@ -0,0 +1,165 @@
+#include "interpreter_iter.h"
+#include "interpreter_intvec.h"
+#include "interpreter_range.h"
+
+#include "../rlib/rlib.h"
+
+bool int_iter_source_ok(struct r_val val) {
+	return val.type == TYPE_ARRAY || val.type == TYPE_INTVEC || val.type == TYPE_RANGE;
+}
+
+struct r_iter *int_new_iter(unsigned char kind, struct r_val src, struct r_val arg, r_int n) {
+	struct r_iter *iter = SALLOC(struct r_iter);
+	iter->ref_c = 1;
+	iter->kind = kind;
+	iter->src = src;
+	iter->arg = arg;
+	iter->n = n;
+	
+	int_incr_refcount(src);
+	int_incr_refcount(arg);
+	return iter;
+}
+
+void int_free_iter(struct r_iter *iter) {
+	int_decr_refcount(iter->src);
+	int_decr_refcount(iter->arg);
+	s_dealloc(iter);
+}
+
+struct iter_cursor *int_iter_start(const struct r_iter *iter) {
+	struct iter_cursor *cursor = SALLOC(struct iter_cursor);
+	cursor->iter = iter;
+	cursor->pos = 0;
+	cursor->left = iter->n;
+	cursor->inner = iter->kind != ITER_SOURCE ? int_iter_start(iter->src.iter_v) : NULL;
+	cursor->other = iter->kind == ITER_ZIP ? int_iter_start(iter->arg.iter_v) : NULL;
+	return cursor;
+}
+
+void int_iter_end(struct iter_cursor *cursor) {
+	if(cursor->inner != NULL)
+		int_iter_end(cursor->inner);
+	if(cursor->other != NULL)
+		int_iter_end(cursor->other);
+	s_dealloc(cursor);
+}
+
+static bool source_next(struct iter_cursor *cursor, struct r_val *out) {
+	struct r_val src = cursor->iter->src;
+	
+	switch(src.type) {
+		case TYPE_ARRAY:
+			if(cursor->pos >= src.array_v->len)
+				return false;
+			*out = src.array_v->items[cursor->pos++];
+			int_incr_refcount(*out);
+			return true;
+		
+		case TYPE_INTVEC:
+			if(cursor->pos >= src.intvec_v->len)
+				return false;
+			*out = (struct r_val) { .type = TYPE_INT, .int_v = src.intvec_v->items[cursor->pos++] };
+			return true;
+		
+		case TYPE_RANGE:
+			if(cursor->pos >= src.range_v->len)
+				return false;
+			*out = (struct r_val) { .type = TYPE_INT, .int_v = int_range_get(src.range_v, cursor->pos++) };
+			return true;
+		
+		default:
+			return false;
+	}
+}
+
+bool int_iter_next(struct iter_cursor *cursor, struct r_val *out, struct interp_env *env, const char *src_name) {
+	const struct r_iter *iter = cursor->iter;
+	struct r_val item;
+	
+	switch(iter->kind) {
+		case ITER_SOURCE:
+			return source_next(cursor, out);
+		
+		case ITER_MAP:
+			if(!int_iter_next(cursor->inner, &item, env, src_name))
+				return false;
+			
+			*out = int_call_r_fn(iter->arg, &item, 1, env, src_name);
+			int_decr_refcount(item);
+			
+			if(int_interrupted()) {
+				int_decr_refcount(*out);
+				return false;
+			}
+			return true;
+		
+		case ITER_FILTER:
+			while(int_iter_next(cursor->inner, &item, env, src_name)) {
+				struct r_val res = int_call_r_fn(iter->arg, &item, 1, env, src_name);
+				bool keep = r_val_as_bool(res);
+				int_decr_refcount(res);
+				
+				if(int_interrupted()) {
+					int_decr_refcount(item);
+					return false;
+				}
+				if(keep) {
+					*out = item;
+					return true;
+				}
+				int_decr_refcount(item);
+			}
+			return false;
+		
+		case ITER_TAKE:
+			if(cursor->left <= 0)
+				return false;
+			cursor->left--;
+			return int_iter_next(cursor->inner, out, env, src_name);
+		
+		case ITER_ZIP: {
+			struct r_val second;
+			if(!int_iter_next(cursor->inner, &item, env, src_name))
+				return false;
+			if(!int_iter_next(cursor->other, &second, env, src_name)) {
+				int_decr_refcount(item);
+				return false;
+			}
+			
+			struct r_array *pair = int_new_array(2);
+			pair->items[0] = item;
+			pair->items[1] = second;
+			*out = (struct r_val) { .type = TYPE_ARRAY, .array_v = pair };
+			return true;
+		}
+		
+		default:
+			S_ASSERT(false);
+			return false;
+	}
+}
+
+struct r_array *int_iter_collect(const struct r_iter *iter, struct interp_env *env, const char *src_name) {
+	struct r_array *array = int_new_array(0);
+	struct iter_cursor *cursor = int_iter_start(iter);
+	
+	struct r_val item;
+	while(int_iter_next(cursor, &item, env, src_name)) {
+		if(array->len == array->cap)
+			array = int_array_reserve(array, array->len + 1);
+		array->items[array->len++] = item;
+	}
+	
+	int_iter_end(cursor);
+	return array;
+}
+
+struct r_val int_iter_force(struct r_val val, struct interp_env *env, const char *src_name) {
+	if(val.type != TYPE_ITER)
+		return val;
+	
+	struct r_array *array = int_iter_collect(val.iter_v, env, src_name);
+	int_decr_refcount(val);
+	return (struct r_val) { .type = TYPE_ARRAY, .array_v = array };
+}
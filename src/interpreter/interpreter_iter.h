@@ -0,0 +1,54 @@
+#ifndef INTERPRETER_ITER_H_INCLUDED
+#define INTERPRETER_ITER_H_INCLUDED
+
+#include "interpreter.h"
+
+/*
+ * Lazy iterator: a source collection followed by a chain of map, filter, take and zip stages. The value itself never
+ * changes; running it makes a cursor per stage, and each item goes through the whole chain before the next one is read,
+ * so a pipeline needs no intermediate arrays however long its source is.
+ */
+
+enum {
+	ITER_SOURCE, //Over the items of an array, packed int array or range
+	ITER_MAP,
+	ITER_FILTER,
+	ITER_TAKE,
+	ITER_ZIP //Pairs of items as two item arrays, until either side runs out
+};
+
+struct r_iter {
+	unsigned ref_c;
+	unsigned char kind;
+	struct r_val src; //The collection for ITER_SOURCE, the iterator the stage reads from otherwise
+	struct r_val arg; //The function for map and filter, the second iterator for zip
+	r_int n; //For take
+};
+
+struct iter_cursor {
+	const struct r_iter *iter;
+	unsigned long long pos;
+	r_int left;
+	struct iter_cursor *inner, *other;
+};
+
+//Whether iter can take the value as its source
+bool int_iter_source_ok(struct r_val val);
+
+//Takes a reference to src and arg
+struct r_iter *int_new_iter(unsigned char kind, struct r_val src, struct r_val arg, r_int n);
+void int_free_iter(struct r_iter *iter);
+
+//The iterator has to outlive the cursor
+struct iter_cursor *int_iter_start(const struct r_iter *iter);
+void int_iter_end(struct iter_cursor *cursor);
+//Gives the next item, which the caller owns, or false once the iterator is used up or the script was interrupted
+bool int_iter_next(struct iter_cursor *cursor, struct r_val *out, struct interp_env *env, const char *src_name);
+
+struct r_array *int_iter_collect(const struct r_iter *iter, struct interp_env *env, const char *src_name);
+
+//Turns an iterator into an array, for the places that consume values whole (printing, command arguments). Takes over
+//the reference to val; anything else is returned as it is.
+struct r_val int_iter_force(struct r_val val, struct interp_env *env, const char *src_name);
+
+#endif
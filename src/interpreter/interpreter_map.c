@@ -0,0 +1,213 @@
+#include "interpreter_map.h"
+
+#include <string.h>
+
+#define INDEX_EMPTY -1
+#define INDEX_DELETED -2
+
+bool int_map_key_ok(struct r_val key) {
+	return key.type == TYPE_STR || key.type == TYPE_INT;
+}
+
+unsigned long long int_map_hash_key(struct r_val key) {
+	if(key.type == TYPE_STR)
+		return int_string_hash(key.str_v);
+	
+	return hash_bytes(&key.int_v, sizeof(key.int_v), 0);
+}
+
+bool int_map_keys_equal(struct r_val a, struct r_val b) {
+	if(a.type != b.type)
+		return false;
+	
+	if(a.type == TYPE_INT)
+		return a.int_v == b.int_v;
+	
+	return a.str_v->len == b.str_v->len && memcmp(a.str_v->str, b.str_v->str, a.str_v->len) == 0;
+}
+
+static void alloc_index(struct r_map *map, unsigned index_cap) {
+	map->index_cap = index_cap;
+	map->index = NSALLOC(int, index_cap);
+	memset(map->index, 0xFF, sizeof(int) * index_cap); //INDEX_EMPTY
+	map->n_tombstones = 0;
+}
+
+struct r_map *int_new_map(unsigned cap) {
+	struct r_map *map = SALLOC(struct r_map);
+	map->ref_c = 1;
+	map->len = 0;
+	map->n_entries = 0;
+	map->entries_cap = cap > 0 ? cap : 4;
+	map->entries = NSALLOC(struct r_map_entry, map->entries_cap);
+	
+	unsigned index_cap = 8;
+	while(index_cap < map->entries_cap * 2)
+		index_cap *= 2;
+	alloc_index(map, index_cap);
+	
+	return map;
+}
+
+void int_free_map(struct r_map *map) {
+	INT_MAP_FOREACH(map, e) {
+		int_decr_refcount(e->key);
+		int_decr_refcount(e->val);
+	}
+	
+	s_dealloc(map->entries);
+	s_dealloc(map->index);
+	s_dealloc(map);
+}
+
+//Drops deleted entries and rebuilds the index for at least min_cap entries
+static void rebuild(struct r_map *map, unsigned min_cap) {
+	unsigned n = 0;
+	for(unsigned i = 0; i < map->n_entries; i++) {
+		if(map->entries[i].key.type != TYPE_NULL)
+			map->entries[n++] = map->entries[i];
+	}
+	map->n_entries = n;
+	
+	if(min_cap > map->entries_cap) {
+		map->entries_cap = min_cap;
+		map->entries = SREALLOC(struct r_map_entry, map->entries, map->entries_cap);
+	}
+	
+	unsigned index_cap = 8;
+	while(index_cap < map->entries_cap * 2)
+		index_cap *= 2;
+	
+	s_dealloc(map->index);
+	alloc_index(map, index_cap);
+	
+	for(unsigned i = 0; i < map->n_entries; i++) {
+		unsigned slot = map->entries[i].hash & (map->index_cap - 1);
+		while(map->index[slot] != INDEX_EMPTY)
+			slot = (slot + 1) & (map->index_cap - 1);
+		map->index[slot] = i;
+	}
+}
+
+struct r_map *int_copy_map(const struct r_map *map) {
+	struct r_map *copy = int_new_map(map->len);
+	
+	INT_MAP_FOREACH(map, e) {
+		int_incr_refcount(e->key);
+		int_incr_refcount(e->val);
+		copy->entries[copy->n_entries++] = *e;
+	}
+	copy->len = copy->n_entries;
+	
+	rebuild(copy, 0);
+	return copy;
+}
+
+//The index slot holding key, or -1
+static long long find_slot(const struct r_map *map, struct r_val key, unsigned long long hash) {
+	unsigned mask = map->index_cap - 1;
+	
+	for(unsigned slot = hash & mask;; slot = (slot + 1) & mask) {
+		int i = map->index[slot];
+		if(i == INDEX_EMPTY)
+			return -1;
+		
+		if(i != INDEX_DELETED && map->entries[i].hash == hash && int_map_keys_equal(map->entries[i].key, key))
+			return slot;
+	}
+}
+
+struct r_val *int_map_get(struct r_map *map, struct r_val key) {
+	if(!int_map_key_ok(key))
+		return NULL;
+	
+	return int_map_get_hashed(map, key, int_map_hash_key(key));
+}
+
+struct r_val *int_map_get_hashed(struct r_map *map, struct r_val key, unsigned long long hash) {
+	long long slot = find_slot(map, key, hash);
+	return slot >= 0 ? &map->entries[map->index[slot]].val : NULL;
+}
+
+void int_map_set(struct r_map *map, struct r_val key, struct r_val val) {
+	S_ASSERT(int_map_key_ok(key));
+	
+	int_map_set_hashed(map, key, val, int_map_hash_key(key));
+}
+
+void int_map_set_hashed(struct r_map *map, struct r_val key, struct r_val val, unsigned long long hash) {
+	long long slot = find_slot(map, key, hash);
+	if(slot >= 0) {
+		struct r_map_entry *e = &map->entries[map->index[slot]];
+		int_incr_refcount(val);
+		int_decr_refcount(e->val);
+		e->val = val;
+		return;
+	}
+	
+	if(map->n_entries == map->entries_cap || (map->n_entries + map->n_tombstones + 1) * 4 > map->index_cap * 3) {
+		//Only grow if compacting wouldn't free enough room
+		unsigned cap = map->entries_cap;
+		if(map->len + 1 > cap / 2) {
+			cap += 1;
+			cap *= 2;
+		}
+		rebuild(map, cap);
+	}
+	
+	unsigned mask = map->index_cap - 1;
+	unsigned s = hash & mask;
+	while(map->index[s] >= 0)
+		s = (s + 1) & mask;
+	
+	if(map->index[s] == INDEX_DELETED)
+		map->n_tombstones--;
+	
+	int_incr_refcount(key);
+	int_incr_refcount(val);
+	map->entries[map->n_entries] = (struct r_map_entry) { .hash = hash, .key = key, .val = val };
+	map->index[s] = map->n_entries++;
+	map->len++;
+}
+
+#define ADD_KEYS_BLOCK 32
+
+void int_map_add_keys(struct r_map *map, const struct r_val *keys, unsigned n) {
+	if(map->len + n > map->entries_cap)
+		rebuild(map, map->len + n);
+	
+	//Hashing a block at a time keeps the keys in cache until they're inserted, and gives the index slots time to arrive
+	unsigned long long hashes[ADD_KEYS_BLOCK];
+	for(unsigned start = 0; start < n; start += ADD_KEYS_BLOCK) {
+		unsigned block = n - start < ADD_KEYS_BLOCK ? n - start : ADD_KEYS_BLOCK;
+		unsigned mask = map->index_cap - 1;
+		
+		for(unsigned i = 0; i < block; i++) {
+			hashes[i] = int_map_hash_key(keys[start + i]);
+			__builtin_prefetch(&map->index[hashes[i] & mask]);
+		}
+		
+		for(unsigned i = 0; i < block; i++)
+			int_map_set_hashed(map, keys[start + i], (struct r_val) { .type = TYPE_NULL }, hashes[i]);
+	}
+}
+
+bool int_map_del(struct r_map *map, struct r_val key) {
+	if(!int_map_key_ok(key))
+		return false;
+	
+	long long slot = find_slot(map, key, int_map_hash_key(key));
+	if(slot < 0)
+		return false;
+	
+	struct r_map_entry *e = &map->entries[map->index[slot]];
+	int_decr_refcount(e->key);
+	int_decr_refcount(e->val);
+	e->key = (struct r_val) { .type = TYPE_NULL };
+	e->val = (struct r_val) { .type = TYPE_NULL };
+	
+	map->index[slot] = INDEX_DELETED;
+	map->n_tombstones++;
+	map->len--;
+	return true;
+}
@@ -0,0 +1,51 @@
+#ifndef INTERPRETER_MAP_H_INCLUDED
+#define INTERPRETER_MAP_H_INCLUDED
+
+#include "interpreter.h"
+
+/*
+ * Insertion ordered hash map from strings and ints to values. Entries are stored densely in the order they were added
+ * and found through an open addressing index with linear probing, so iterating doesn't have to skip empty slots.
+ * Maps are mutable and shared by reference, like string builders. Sets (TYPE_SET) are maps whose values are all null.
+ */
+
+struct r_map_entry {
+	unsigned long long hash;
+	struct r_val key, val; //A deleted entry has a null key
+};
+
+struct r_map {
+	unsigned ref_c;
+	unsigned len; //Live entries
+	unsigned n_entries, entries_cap;
+	struct r_map_entry *entries;
+	
+	unsigned index_cap; //Power of two
+	unsigned n_tombstones;
+	int *index;
+};
+
+bool int_map_key_ok(struct r_val key);
+bool int_map_keys_equal(struct r_val a, struct r_val b);
+
+struct r_map *int_new_map(unsigned cap);
+void int_free_map(struct r_map *map);
+struct r_map *int_copy_map(const struct r_map *map);
+
+//NULL if the key isn't in the map; the value is still owned by the map
+struct r_val *int_map_get(struct r_map *map, struct r_val key);
+//Takes a reference to both key and value
+void int_map_set(struct r_map *map, struct r_val key, struct r_val val);
+bool int_map_del(struct r_map *map, struct r_val key);
+
+//For callers that hash many keys up front; the hash must come from int_map_hash_key
+unsigned long long int_map_hash_key(struct r_val key);
+struct r_val *int_map_get_hashed(struct r_map *map, struct r_val key, unsigned long long hash);
+void int_map_set_hashed(struct r_map *map, struct r_val key, struct r_val val, unsigned long long hash);
+
+//Adds all the keys with null values, sizing the map once up front; every key must pass int_map_key_ok
+void int_map_add_keys(struct r_map *map, const struct r_val *keys, unsigned n);
+
+#define INT_MAP_FOREACH(map, e) for(struct r_map_entry *e = (map)->entries; e < (map)->entries + (map)->n_entries; e++) if(e->key.type != TYPE_NULL)
+
+#endif
@@ -0,0 +1,342 @@
+#include "interpreter_pmap.h"
+
+#include <string.h>
+
+#define PMAP_BITS 5
+#define MAX_SHIFT 60 //Nodes deeper than this have used up the hash and only hold keys with equal hashes
+
+static unsigned frag_bit(unsigned long long hash, unsigned shift) {
+	return 1u << ((hash >> shift) & ((1 << PMAP_BITS) - 1));
+}
+
+static unsigned index_of(unsigned bitmap, unsigned bit) {
+	return __builtin_popcount(bitmap & (bit - 1));
+}
+
+static unsigned n_children(const struct pmap_node *node) {
+	return __builtin_popcount(node->node_map);
+}
+
+static struct pmap_node *new_node(unsigned n_data, unsigned n_nodes) {
+	struct pmap_node *node = SALLOC(struct pmap_node);
+	node->ref_c = 1;
+	node->data_map = 0;
+	node->node_map = 0;
+	node->n_data = n_data;
+	node->data = n_data > 0 ? NSALLOC(struct r_map_entry, n_data) : NULL;
+	node->nodes = n_nodes > 0 ? NSALLOC(struct pmap_node *, n_nodes) : NULL;
+	return node;
+}
+
+static void release_node(struct pmap_node *node) {
+	if(--node->ref_c > 0)
+		return;
+	
+	for(unsigned i = 0; i < node->n_data; i++) {
+		int_decr_refcount(node->data[i].key);
+		int_decr_refcount(node->data[i].val);
+	}
+	for(unsigned i = 0; i < n_children(node); i++)
+		release_node(node->nodes[i]);
+	
+	s_dealloc(node->data);
+	s_dealloc(node->nodes);
+	s_dealloc(node);
+}
+
+static struct pmap_node *copy_node(const struct pmap_node *node) {
+	unsigned n_nodes = n_children(node);
+	struct pmap_node *copy = new_node(node->n_data, n_nodes);
+	copy->data_map = node->data_map;
+	copy->node_map = node->node_map;
+	
+	for(unsigned i = 0; i < node->n_data; i++) {
+		copy->data[i] = node->data[i];
+		int_incr_refcount(copy->data[i].key);
+		int_incr_refcount(copy->data[i].val);
+	}
+	for(unsigned i = 0; i < n_nodes; i++) {
+		copy->nodes[i] = node->nodes[i];
+		copy->nodes[i]->ref_c++;
+	}
+	
+	return copy;
+}
+
+//These take over the reference held by what they are given or return
+static void add_data(struct pmap_node *node, unsigned bit, struct r_map_entry e) {
+	unsigned i = index_of(node->data_map, bit);
+	node->data = SREALLOC(struct r_map_entry, node->data, node->n_data + 1);
+	memmove(node->data + i + 1, node->data + i, sizeof(struct r_map_entry) * (node->n_data - i));
+	node->data[i] = e;
+	node->n_data++;
+	node->data_map |= bit;
+}
+
+static struct r_map_entry take_data(struct pmap_node *node, unsigned bit) {
+	unsigned i = index_of(node->data_map, bit);
+	struct r_map_entry e = node->data[i];
+	memmove(node->data + i, node->data + i + 1, sizeof(struct r_map_entry) * (node->n_data - i - 1));
+	node->n_data--;
+	node->data_map &= ~bit;
+	return e;
+}
+
+static void add_child(struct pmap_node *node, unsigned bit, struct pmap_node *child) {
+	unsigned i = index_of(node->node_map, bit), n = n_children(node);
+	node->nodes = SREALLOC(struct pmap_node *, node->nodes, n + 1);
+	memmove(node->nodes + i + 1, node->nodes + i, sizeof(struct pmap_node *) * (n - i));
+	node->nodes[i] = child;
+	node->node_map |= bit;
+}
+
+static struct pmap_node *take_child(struct pmap_node *node, unsigned bit) {
+	unsigned i = index_of(node->node_map, bit), n = n_children(node);
+	struct pmap_node *child = node->nodes[i];
+	memmove(node->nodes + i, node->nodes + i + 1, sizeof(struct pmap_node *) * (n - i - 1));
+	node->node_map &= ~bit;
+	return child;
+}
+
+static void replace_val(struct r_map_entry *e, struct r_val val) {
+	int_incr_refcount(val);
+	int_decr_refcount(e->val);
+	e->val = val;
+}
+
+static struct r_map_entry own_entry(struct r_map_entry e) {
+	int_incr_refcount(e.key);
+	int_incr_refcount(e.val);
+	return e;
+}
+
+static bool entry_matches(const struct r_map_entry *e, struct r_val key, unsigned long long hash) {
+	return e->hash == hash && int_map_keys_equal(e->key, key);
+}
+
+//A subtrie for two entries whose hashes agree below shift; takes over both references
+static struct pmap_node *merge(struct r_map_entry a, struct r_map_entry b, unsigned shift) {
+	if(shift > MAX_SHIFT) {
+		struct pmap_node *node = new_node(2, 0);
+		node->data[0] = a;
+		node->data[1] = b;
+		return node;
+	}
+	
+	unsigned bit_a = frag_bit(a.hash, shift), bit_b = frag_bit(b.hash, shift);
+	
+	if(bit_a == bit_b) {
+		struct pmap_node *node = new_node(0, 1);
+		node->node_map = bit_a;
+		node->nodes[0] = merge(a, b, shift + PMAP_BITS);
+		return node;
+	}
+	
+	struct pmap_node *node = new_node(2, 0);
+	node->data_map = bit_a | bit_b;
+	node->data[bit_a < bit_b ? 0 : 1] = a;
+	node->data[bit_a < bit_b ? 1 : 0] = b;
+	return node;
+}
+
+//Returns node itself if it was changed in place, which is only done with in_place set and for nodes nothing else shares
+static struct pmap_node *node_set(struct pmap_node *node, struct r_map_entry e, unsigned shift, bool in_place, bool *added) {
+	in_place = in_place && node->ref_c == 1;
+	
+	if(shift > MAX_SHIFT) {
+		struct pmap_node *edit = in_place ? node : copy_node(node);
+		
+		for(unsigned i = 0; i < edit->n_data; i++) {
+			if(entry_matches(&edit->data[i], e.key, e.hash)) {
+				replace_val(&edit->data[i], e.val);
+				return edit;
+			}
+		}
+		
+		edit->data = SREALLOC(struct r_map_entry, edit->data, edit->n_data + 1);
+		edit->data[edit->n_data++] = own_entry(e);
+		*added = true;
+		return edit;
+	}
+	
+	unsigned bit = frag_bit(e.hash, shift);
+	
+	if(node->node_map & bit) {
+		unsigned i = index_of(node->node_map, bit);
+		struct pmap_node *child = node->nodes[i];
+		struct pmap_node *new_child = node_set(child, e, shift + PMAP_BITS, in_place, added);
+		if(new_child == child)
+			return node;
+		
+		struct pmap_node *edit = in_place ? node : copy_node(node);
+		release_node(edit->nodes[i]);
+		edit->nodes[i] = new_child;
+		return edit;
+	}
+	
+	struct pmap_node *edit = in_place ? node : copy_node(node);
+	
+	if(edit->data_map & bit) {
+		struct r_map_entry *old = &edit->data[index_of(edit->data_map, bit)];
+		if(entry_matches(old, e.key, e.hash)) {
+			replace_val(old, e.val);
+			return edit;
+		}
+		
+		struct r_map_entry moved = take_data(edit, bit);
+		add_child(edit, bit, merge(moved, own_entry(e), shift + PMAP_BITS));
+	} else {
+		add_data(edit, bit, own_entry(e));
+	}
+	
+	*added = true;
+	return edit;
+}
+
+//NULL if the key isn't there. Subtries left with a single entry are folded into their parent, so the trie stays as shallow
+//as if the key had never been added.
+static struct pmap_node *node_del(struct pmap_node *node, struct r_val key, unsigned long long hash, unsigned shift) {
+	if(shift > MAX_SHIFT) {
+		for(unsigned i = 0; i < node->n_data; i++) {
+			if(!entry_matches(&node->data[i], key, hash))
+				continue;
+			
+			struct pmap_node *copy = copy_node(node);
+			int_decr_refcount(copy->data[i].key);
+			int_decr_refcount(copy->data[i].val);
+			memmove(copy->data + i, copy->data + i + 1, sizeof(struct r_map_entry) * (copy->n_data - i - 1));
+			copy->n_data--;
+			return copy;
+		}
+		return NULL;
+	}
+	
+	unsigned bit = frag_bit(hash, shift);
+	
+	if(node->data_map & bit) {
+		if(!entry_matches(&node->data[index_of(node->data_map, bit)], key, hash))
+			return NULL;
+		
+		struct pmap_node *copy = copy_node(node);
+		struct r_map_entry e = take_data(copy, bit);
+		int_decr_refcount(e.key);
+		int_decr_refcount(e.val);
+		return copy;
+	}
+	
+	if(!(node->node_map & bit))
+		return NULL;
+	
+	struct pmap_node *new_child = node_del(node->nodes[index_of(node->node_map, bit)], key, hash, shift + PMAP_BITS);
+	if(new_child == NULL)
+		return NULL;
+	
+	struct pmap_node *copy = copy_node(node);
+	release_node(take_child(copy, bit));
+	
+	if(new_child->node_map == 0 && new_child->n_data <= 1) {
+		if(new_child->n_data == 1)
+			add_data(copy, bit, own_entry(new_child->data[0]));
+		release_node(new_child);
+	} else {
+		add_child(copy, bit, new_child);
+	}
+	
+	return copy;
+}
+
+struct r_pmap *int_new_pmap() {
+	struct r_pmap *map = SALLOC(struct r_pmap);
+	map->ref_c = 1;
+	map->len = 0;
+	map->root = new_node(0, 0);
+	return map;
+}
+
+void int_free_pmap(struct r_pmap *map) {
+	release_node(map->root);
+	s_dealloc(map);
+}
+
+struct r_val *int_pmap_get(const struct r_pmap *map, struct r_val key) {
+	if(!int_map_key_ok(key))
+		return NULL;
+	
+	unsigned long long hash = int_map_hash_key(key);
+	const struct pmap_node *node = map->root;
+	
+	for(unsigned shift = 0; shift <= MAX_SHIFT; shift += PMAP_BITS) {
+		unsigned bit = frag_bit(hash, shift);
+		
+		if(node->data_map & bit) {
+			struct r_map_entry *e = &node->data[index_of(node->data_map, bit)];
+			return entry_matches(e, key, hash) ? &e->val : NULL;
+		}
+		if(!(node->node_map & bit))
+			return NULL;
+		
+		node = node->nodes[index_of(node->node_map, bit)];
+	}
+	
+	for(unsigned i = 0; i < node->n_data; i++) {
+		if(entry_matches(&node->data[i], key, hash))
+			return &node->data[i].val;
+	}
+	return NULL;
+}
+
+struct r_pmap *int_pmap_set(const struct r_pmap *map, struct r_val key, struct r_val val) {
+	S_ASSERT(int_map_key_ok(key));
+	
+	struct r_map_entry e = { .hash = int_map_hash_key(key), .key = key, .val = val };
+	bool added = false;
+	
+	struct r_pmap *res = SALLOC(struct r_pmap);
+	res->ref_c = 1;
+	res->root = node_set(map->root, e, 0, false, &added);
+	res->len = map->len + added;
+	return res;
+}
+
+void int_pmap_set_in_place(struct r_pmap *map, struct r_val key, struct r_val val) {
+	S_ASSERT(int_map_key_ok(key));
+	
+	struct r_map_entry e = { .hash = int_map_hash_key(key), .key = key, .val = val };
+	bool added = false;
+	
+	struct pmap_node *root = node_set(map->root, e, 0, true, &added);
+	if(root != map->root) {
+		release_node(map->root);
+		map->root = root;
+	}
+	map->len += added;
+}
+
+struct r_pmap *int_pmap_del(const struct r_pmap *map, struct r_val key) {
+	struct pmap_node *root = int_map_key_ok(key) ? node_del(map->root, key, int_map_hash_key(key), 0) : NULL;
+	
+	struct r_pmap *res = SALLOC(struct r_pmap);
+	res->ref_c = 1;
+	
+	if(root == NULL) {
+		res->root = map->root;
+		res->root->ref_c++;
+		res->len = map->len;
+	} else {
+		res->root = root;
+		res->len = map->len - 1;
+	}
+	
+	return res;
+}
+
+static void foreach_node(const struct pmap_node *node, void (*fn)(const struct r_map_entry *e, void *ctx), void *ctx) {
+	for(unsigned i = 0; i < node->n_data; i++)
+		fn(&node->data[i], ctx);
+	for(unsigned i = 0; i < n_children(node); i++)
+		foreach_node(node->nodes[i], fn, ctx);
+}
+
+void int_pmap_foreach(const struct r_pmap *map, void (*fn)(const struct r_map_entry *e, void *ctx), void *ctx) {
+	foreach_node(map->root, fn, ctx);
+}
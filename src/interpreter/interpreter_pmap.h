@@ -0,0 +1,41 @@
+#ifndef INTERPRETER_PMAP_H_INCLUDED
+#define INTERPRETER_PMAP_H_INCLUDED
+
+#include "interpreter_map.h"
+
+/*
+ * Persistent hash map: a hash array mapped trie using 5 bits of the key hash per level. A node keeps the entries that end
+ * at it inline and the subtries in a second array, each found through a bitmap. Updates return a new map that shares
+ * every node except those on the path to the change. Keys are the same as for struct r_map.
+ */
+
+struct pmap_node {
+	unsigned ref_c;
+	unsigned data_map, node_map;
+	unsigned n_data; //Only differs from the number of bits in data_map in a collision node, which is past the last level
+	struct r_map_entry *data;
+	struct pmap_node **nodes;
+};
+
+struct r_pmap {
+	unsigned ref_c;
+	unsigned len;
+	struct pmap_node *root;
+};
+
+struct r_pmap *int_new_pmap();
+void int_free_pmap(struct r_pmap *map);
+
+//NULL if the key isn't in the map; the value is still owned by the map
+struct r_val *int_pmap_get(const struct r_pmap *map, struct r_val key);
+
+//New versions of the map; set takes a reference to the key and value
+struct r_pmap *int_pmap_set(const struct r_pmap *map, struct r_val key, struct r_val val);
+struct r_pmap *int_pmap_del(const struct r_pmap *map, struct r_val key);
+
+//Changes the map itself, copying only nodes that other maps share. Only for maps that nothing else can see.
+void int_pmap_set_in_place(struct r_pmap *map, struct r_val key, struct r_val val);
+
+void int_pmap_foreach(const struct r_pmap *map, void (*fn)(const struct r_map_entry *e, void *ctx), void *ctx);
+
+#endif
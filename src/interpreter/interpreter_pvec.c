@@ -0,0 +1,193 @@
+#include "interpreter_pvec.h"
+
+#define PVEC_MASK (PVEC_WIDTH - 1)
+
+static struct pvec_node *new_node(unsigned shift) {
+	struct pvec_node *node = SALLOC(struct pvec_node);
+	node->ref_c = 1;
+	
+	for(unsigned i = 0; i < PVEC_WIDTH; i++) {
+		if(shift == 0)
+			node->items[i] = (struct r_val) { .type = TYPE_NULL };
+		else
+			node->children[i] = NULL;
+	}
+	
+	return node;
+}
+
+static void release_node(struct pvec_node *node, unsigned shift) {
+	if(node == NULL || --node->ref_c > 0)
+		return;
+	
+	for(unsigned i = 0; i < PVEC_WIDTH; i++) {
+		if(shift == 0)
+			int_decr_refcount(node->items[i]);
+		else
+			release_node(node->children[i], shift - PVEC_BITS);
+	}
+	
+	s_dealloc(node);
+}
+
+static struct pvec_node *copy_node(const struct pvec_node *node, unsigned shift) {
+	struct pvec_node *copy = SALLOC(struct pvec_node);
+	*copy = *node;
+	copy->ref_c = 1;
+	
+	for(unsigned i = 0; i < PVEC_WIDTH; i++) {
+		if(shift == 0)
+			int_incr_refcount(copy->items[i]);
+		else if(copy->children[i] != NULL)
+			copy->children[i]->ref_c++;
+	}
+	
+	return copy;
+}
+
+//Index of the first item in the tail
+static unsigned tail_offset(const struct r_pvec *vec) {
+	return vec->len < PVEC_WIDTH ? 0 : ((vec->len - 1) >> PVEC_BITS) << PVEC_BITS;
+}
+
+static struct r_pvec *new_header(const struct r_pvec *vec) {
+	struct r_pvec *res = SALLOC(struct r_pvec);
+	*res = *vec;
+	res->ref_c = 1;
+	return res;
+}
+
+struct r_pvec *int_new_pvec(const struct r_val *items, unsigned n) {
+	struct r_pvec *vec = SALLOC(struct r_pvec);
+	vec->ref_c = 1;
+	vec->len = 0;
+	vec->shift = PVEC_BITS;
+	vec->root = new_node(PVEC_BITS);
+	vec->tail = new_node(0);
+	
+	for(unsigned i = 0; i < n; i++) {
+		//Nothing else has seen the vector yet, so a tail with room left can be filled in place
+		if(vec->len - tail_offset(vec) < PVEC_WIDTH) {
+			vec->tail->items[vec->len++ & PVEC_MASK] = items[i];
+			int_incr_refcount(items[i]);
+		} else {
+			struct r_pvec *next = int_pvec_push(vec, items[i]);
+			int_free_pvec(vec);
+			vec = next;
+		}
+	}
+	
+	return vec;
+}
+
+void int_free_pvec(struct r_pvec *vec) {
+	release_node(vec->root, vec->shift);
+	release_node(vec->tail, 0);
+	s_dealloc(vec);
+}
+
+struct r_val int_pvec_get(const struct r_pvec *vec, unsigned i) {
+	S_ASSERT(i < vec->len);
+	
+	if(i >= tail_offset(vec))
+		return vec->tail->items[i & PVEC_MASK];
+	
+	const struct pvec_node *node = vec->root;
+	for(unsigned shift = vec->shift; shift > 0; shift -= PVEC_BITS)
+		node = node->children[(i >> shift) & PVEC_MASK];
+	
+	return node->items[i & PVEC_MASK];
+}
+
+static struct pvec_node *new_path(unsigned shift, struct pvec_node *leaf) {
+	if(shift == 0)
+		return leaf;
+	
+	struct pvec_node *node = new_node(shift);
+	node->children[0] = new_path(shift - PVEC_BITS, leaf);
+	return node;
+}
+
+//Copies the path to where the full tail goes; last is the index of the tails last item
+static struct pvec_node *push_tail(const struct pvec_node *node, unsigned shift, unsigned last, struct pvec_node *leaf) {
+	struct pvec_node *copy = copy_node(node, shift);
+	unsigned sub = (last >> shift) & PVEC_MASK;
+	struct pvec_node *child = copy->children[sub];
+	
+	if(shift == PVEC_BITS) {
+		copy->children[sub] = leaf;
+	} else if(child != NULL) {
+		copy->children[sub] = push_tail(child, shift - PVEC_BITS, last, leaf);
+		child->ref_c--; //Taken by the copy, and never the last reference since the original node still has it
+	} else {
+		copy->children[sub] = new_path(shift - PVEC_BITS, leaf);
+	}
+	
+	return copy;
+}
+
+struct r_pvec *int_pvec_push(const struct r_pvec *vec, struct r_val val) {
+	struct r_pvec *res = new_header(vec);
+	res->len++;
+	
+	if(vec->len - tail_offset(vec) < PVEC_WIDTH) {
+		res->tail = copy_node(vec->tail, 0);
+		res->tail->items[vec->len & PVEC_MASK] = val;
+		int_incr_refcount(val);
+		res->root->ref_c++;
+		return res;
+	}
+	
+	//The tail is full and moves into the trie, which gets another level once the root has no room left
+	struct pvec_node *leaf = vec->tail;
+	leaf->ref_c++;
+	
+	if((vec->len >> PVEC_BITS) > (1u << vec->shift)) {
+		res->root = new_node(vec->shift + PVEC_BITS);
+		res->root->children[0] = vec->root;
+		vec->root->ref_c++;
+		res->root->children[1] = new_path(vec->shift, leaf);
+		res->shift += PVEC_BITS;
+	} else {
+		res->root = push_tail(vec->root, vec->shift, vec->len - 1, leaf);
+	}
+	
+	res->tail = new_node(0);
+	res->tail->items[0] = val;
+	int_incr_refcount(val);
+	
+	return res;
+}
+
+static struct pvec_node *set_item(const struct pvec_node *node, unsigned shift, unsigned i, struct r_val val) {
+	struct pvec_node *copy = copy_node(node, shift);
+	
+	if(shift == 0) {
+		int_decr_refcount(copy->items[i & PVEC_MASK]);
+		copy->items[i & PVEC_MASK] = val;
+		int_incr_refcount(val);
+	} else {
+		unsigned sub = (i >> shift) & PVEC_MASK;
+		struct pvec_node *child = copy->children[sub];
+		copy->children[sub] = set_item(child, shift - PVEC_BITS, i, val);
+		child->ref_c--;
+	}
+	
+	return copy;
+}
+
+struct r_pvec *int_pvec_set(const struct r_pvec *vec, unsigned i, struct r_val val) {
+	S_ASSERT(i < vec->len);
+	
+	struct r_pvec *res = new_header(vec);
+	
+	if(i >= tail_offset(vec)) {
+		res->root->ref_c++;
+		res->tail = set_item(vec->tail, 0, i, val);
+	} else {
+		res->tail->ref_c++;
+		res->root = set_item(vec->root, vec->shift, i, val);
+	}
+	
+	return res;
+}
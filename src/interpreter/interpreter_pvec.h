@@ -0,0 +1,40 @@
+#ifndef INTERPRETER_PVEC_H_INCLUDED
+#define INTERPRETER_PVEC_H_INCLUDED
+
+#include "interpreter.h"
+
+/*
+ * Persistent vector: a 32 way trie of leaves holding the items, plus a tail holding the items after the last full leaf.
+ * Updates never change a vector, they return a new one that shares every node except those on the path to the change,
+ * so keeping many versions around costs O(log32 n) per update. Nodes are reference counted and shared between versions.
+ */
+
+#define PVEC_BITS 5
+#define PVEC_WIDTH (1 << PVEC_BITS)
+
+struct pvec_node {
+	unsigned ref_c;
+	union {
+		struct pvec_node *children[PVEC_WIDTH]; //NULL past the last child
+		struct r_val items[PVEC_WIDTH]; //Null past the last item
+	};
+};
+
+struct r_pvec {
+	unsigned ref_c;
+	unsigned len;
+	unsigned shift; //Of the root, PVEC_BITS when its children are leaves
+	struct pvec_node *root, *tail;
+};
+
+struct r_pvec *int_new_pvec(const struct r_val *items, unsigned n);
+void int_free_pvec(struct r_pvec *vec);
+
+//The item stays owned by the vector
+struct r_val int_pvec_get(const struct r_pvec *vec, unsigned i);
+
+//New versions of the vector; they take a reference to the item
+struct r_pvec *int_pvec_push(const struct r_pvec *vec, struct r_val val);
+struct r_pvec *int_pvec_set(const struct r_pvec *vec, unsigned i, struct r_val val);
+
+#endif
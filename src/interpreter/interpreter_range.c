@@ -0,0 +1,20 @@
+#include "interpreter_range.h"
+
+struct r_range *int_new_range(r_int start, r_int stop, r_int step) {
+	if(step == 0)
+		return NULL;
+	
+	struct r_range *range = SALLOC(struct r_range);
+	range->ref_c = 1;
+	range->start = start;
+	range->stop = stop;
+	range->step = step;
+	
+	//Worked out in unsigned so that ranges spanning most of the int type don't overflow
+	if(step > 0)
+		range->len = stop > start ? ((unsigned long long) stop - start - 1) / step + 1 : 0;
+	else
+		range->len = start > stop ? ((unsigned long long) start - stop - 1) / -(unsigned long long) step + 1 : 0;
+	
+	return range;
+}
@@ -0,0 +1,20 @@
+#ifndef INTERPRETER_RANGE_H_INCLUDED
+#define INTERPRETER_RANGE_H_INCLUDED
+
+#include "interpreter.h"
+
+//The ints from start up to (not including) stop, step apart; only the bounds are stored, so any length costs the same
+struct r_range {
+	unsigned ref_c;
+	r_int start, stop, step; //step is never 0
+	unsigned long long len;
+};
+
+//NULL if step is 0
+struct r_range *int_new_range(r_int start, r_int stop, r_int step);
+
+static inline r_int int_range_get(const struct r_range *range, unsigned long long i) {
+	return (r_int) ((unsigned long long) range->start + i * (unsigned long long) range->step);
+}
+
+#endif
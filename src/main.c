@@ -15,10 +15,21 @@
 #include "rlib/rlib_basic.h"
 #include "rlib/rlib_strutils.h"
 #include "rlib/rlib_extra.h"
+#include "rlib/rlib_proc.h"
+#include "rlib/rlib_build.h"
+#include "rlib/rlib_regex.h"
+#include "rlib/rlib_map.h"
+#include "rlib/rlib_array.h"
+#include "rlib/rlib_persistent.h"
+#include "rlib/rlib_intvec.h"
+#include "rlib/rlib_iter.h"
+#include "rlib/rlib_sort.h"
+#include "rlib/rlib_fold.h"
 
 #include "colour_defs.h"
 
 #include <string.h>
+#include <errno.h>
 
 #include "tui/tui_system.h"
 
@@ -62,6 +73,11 @@ static size_t read_line(FILE *f, char *to_buff, size_t buff_len, bool *eof) {
 	
 	int c;
 	while( (c = getc(f)) != '\n' ) {
+		if(c == EOF && ferror(f) && errno == EINTR) { //Interrupted by a signal, the line is discarded
+			clearerr(f);
+			putchar('\n');
+			return 0;
+		}
 		if(c == EOF) {
 			if(chars_read == 0) {
 				*eof = true;
@@ -95,21 +111,38 @@ static void print_prompt_line(FILE *f) {
 }
 
 static void handle_signals(int signal_n) {
-	putchar('\n');
-	print_prompt_line(stdout);
-	fflush(stdout);
-	return;
+	//Only async-signal-safe calls may be made from here; the evaluator notices the request at its next call or loop boundary
+	int_request_interrupt();
+}
+
+static void install_signal_handlers() {
+	struct sigaction action = { .sa_handler = handle_signals };
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = 0; //Without SA_RESTART, so that a read blocking at the prompt returns and the prompt can be redrawn
+	sigaction(SIGINT, &action, NULL);
+	
+	int_set_job_control(true);
 }
 
 static void put_libs(struct interp_env *env) {
 	rlib_basic_put(env);
 	rlib_strutils_put(env);
 	rlib_extra_put(env);
+	rlib_proc_put(env);
+	rlib_build_put(env);
+	rlib_regex_put(env);
+	rlib_map_put(env);
+	rlib_array_put(env);
+	rlib_persistent_put(env);
+	rlib_intvec_put(env);
+	rlib_iter_put(env);
+	rlib_sort_put(env);
+	rlib_fold_put(env);
 }
 
 static void run_prompt() {
 	
-	signal(SIGINT, handle_signals);
+	install_signal_handlers();
 	
 	print_prompt_msg(stdout);
 	
@@ -139,6 +172,9 @@ static void run_prompt() {
 		if(cmp_len_strs(line_buff, n_read, "quit", 4) || (n_read == 1 && line_buff[0] == 'q'))
 			break;
 		
+		if(int_take_interrupt())
+			continue;
+		
 		struct parse_node *expr = par_parse("stdin", line_buff, parse_region, symbol_region);
 		
 		if(expr != NULL) {
@@ -216,6 +252,8 @@ static void draw_line_wrapper(const char *prompt_msg, const char *line, unsigned
 static void run_tui_prompt() {
 	memory_region *region = NEW_REGION();
 	
+	install_signal_handlers();
+	
 	print_prompt_msg(stdout);
 	
 	struct interp_env *env = int_new_env();
@@ -291,15 +329,10 @@ static int run_script(struct interp_env *opt_env, memory_region *r, const char *
 	}
 	
 	S_ASSERT(argc > 0);
-	struct r_array *arg_array = s_alloc(sizeof(struct r_array) + sizeof(struct r_val) * argc);
-	arg_array->len = argc;
+	struct r_array *arg_array = int_new_array(argc);
 	arg_array->ref_c = 0; //The reference count is incremented to 1 when its set to a variable in the env struct
 	for(int i = 0; i < argc; i++) {
-		unsigned arg_len = strlen(argv[i]);
-		struct r_string *arg = s_alloc(sizeof(struct r_string) + arg_len);
-		memcpy((char *) arg->str, argv[i], arg_len);
-		arg->len = arg_len;
-		arg->ref_c = 1;
+		struct r_string *arg = int_new_string(argv[i], strlen(argv[i]));
 		arg_array->items[i] = (struct r_val) { .type = TYPE_STR, .str_v = arg };
 	}
 	int_env_set(opt_env, LSTRING("argv"), (struct r_val) { .type = TYPE_ARRAY, .array_v = arg_array }, 1, 1);
@@ -328,6 +361,16 @@ static void load_libs() {
 	rlib_basic_load();
 	rlib_strutils_load();
 	rlib_extra_load();
+	rlib_proc_load();
+	rlib_build_load();
+	rlib_regex_load();
+	rlib_map_load();
+	rlib_array_load();
+	rlib_persistent_load();
+	rlib_intvec_load();
+	rlib_iter_load();
+	rlib_sort_load();
+	rlib_fold_load();
 }
 
 #include "interpreter/interpreter_config.h"
@@ -343,7 +386,8 @@ static int handle_arguments(int argc, char **argv) {
 	int src_file_arg = -1;
 	
 	struct int_config interp_conf = {
-		.user_approve_commands = SETTING_APPROVE_COMMANDS
+		.user_approve_commands = SETTING_APPROVE_COMMANDS,
+		.profile_commands = false
 	};
 	
 	for(int i = 1; i < argc; i++) {
@@ -359,6 +403,14 @@ static int handle_arguments(int argc, char **argv) {
 			interp_conf.user_approve_commands = 1;
 		else if(strcmp(argv[i], "--no-manual-approve") == 0)
 			interp_conf.user_approve_commands = 0;
+		else if(strcmp(argv[i], "--profile-commands") == 0)
+			interp_conf.profile_commands = 1;
+		#ifdef BENCHMARKS
+		else if(strcmp(argv[i], "--benchmark") == 0) {
+			do_benchmarks();
+			exit(0);
+		}
+		#endif
 		else if(strcmp(argv[i], "--terminal-rich") == 0)
 			rich_terminal = 1;
 		else if(strcmp(argv[i], "--terminal-basic") == 0)
@@ -381,6 +433,9 @@ int main(int argc, char **argv) {
 
 	load_libs();
 	
+	//A write to a coprocess or pipe that has gone away should fail with EPIPE instead of ending the interpreter
+	signal(SIGPIPE, SIG_IGN);
+	
 	DO_TESTS();
 	
 	int status = 0;
@@ -396,6 +451,10 @@ int main(int argc, char **argv) {
 		status = run_script(NULL, NULL, argv[src_file_arg], argv + src_file_arg, argc - src_file_arg);
 	}
 	
+	if(interpreter_get_config()->profile_commands)
+		int_print_exec_profile(stderr);
+	int_clear_exec_profile();
+	
 	int_clear_extern_fns();
 
 	return status;
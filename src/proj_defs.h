@@ -5,10 +5,22 @@ typedef long long r_int;
 typedef double r_float;
 typedef unsigned long long symbol_i;
 
+//Set lazily by int_string_hash, int_string_is_ascii and int_string_is_utf8; whatever changes the bytes of a string must clear them
+enum {
+	R_STRING_HASHED = 1,
+	R_STRING_SCANNED = 2,
+	R_STRING_ASCII = 4,
+	R_STRING_UTF8 = 8
+};
+
 struct r_string {
 	unsigned ref_c;
 	unsigned len;
-	const char str[];
+	const char *str; //Points to data, or into the parents data for a slice
+	struct r_string *parent; //The string a slice references, kept alive by the slice. Always an owning string, never a slice itself.
+	unsigned long long hash;
+	unsigned char flags;
+	char data[];
 };
 /*
 struct r_list {
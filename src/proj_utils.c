@@ -258,6 +258,39 @@ char *read_alloc_file(FILE *f, bool cstr) {
 	return buff;
 }
 
+//---------------------------- Hashing
+
+static unsigned long long hash_mix(unsigned long long x) { //The splitmix64 finaliser
+	x ^= x >> 30;
+	x *= 0xBF58476D1CE4E5B9ULL;
+	x ^= x >> 27;
+	x *= 0x94D049BB133111EBULL;
+	x ^= x >> 31;
+	return x;
+}
+
+#define HASH_MUL 0x9E3779B97F4A7C15ULL
+
+unsigned long long hash_bytes(const void *data, size_t len, unsigned long long seed) {
+	const unsigned char *p = data;
+	unsigned long long h = seed ^ (len * HASH_MUL);
+	
+	for(; len >= 8; len -= 8, p += 8) {
+		unsigned long long w;
+		memcpy(&w, p, 8);
+		h = (h ^ hash_mix(w)) * HASH_MUL;
+		h = (h << 31) | (h >> 33);
+	}
+	
+	if(len != 0) {
+		unsigned long long w = 0;
+		memcpy(&w, p, len);
+		h = (h ^ hash_mix(w)) * HASH_MUL;
+	}
+	
+	return hash_mix(h);
+}
+
 //---------------------------- lstring
 
 bool lstring_cmp(lstring *a, lstring *b) {
@@ -91,6 +91,9 @@ bool lstring_cmp(lstring *a, lstring *b);
 
 char *lstring_to_cstr(lstring str, memory_region *opt_region);
 
+//Fast non-cryptographic hash; chaining calls through the seed hashes a sequence of buffers
+unsigned long long hash_bytes(const void *data, size_t len, unsigned long long seed);
+
 bool y_or_n_prompt(FILE *out, FILE *in, const char *msg);
 
 char *read_alloc_file(FILE *f, bool cstr);
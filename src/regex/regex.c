@@ -0,0 +1,942 @@
+#define _GNU_SOURCE //memmem
+
+#include "regex.h"
+
+#include "../proj_utils.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#define MAX_REPEAT 1000
+#define MAX_NFA_STATES 100000
+#define MAX_DFA_STATES 2048
+#define MAX_PREFIX_LEN 64
+#define MAX_GROUP_DEPTH 256
+
+typedef struct {
+	unsigned char bits[32];
+} byte_set;
+
+static void set_add(byte_set *set, unsigned char c) {
+	set->bits[c >> 3] |= 1 << (c & 7);
+}
+
+static void set_add_range(byte_set *set, unsigned char lo, unsigned char hi) {
+	for(unsigned c = lo; c <= hi; c++)
+		set_add(set, c);
+}
+
+static bool set_has(const byte_set *set, unsigned char c) {
+	return (set->bits[c >> 3] >> (c & 7)) & 1;
+}
+
+static void set_invert(byte_set *set) {
+	for(unsigned i = 0; i < sizeof(set->bits); i++)
+		set->bits[i] = ~set->bits[i];
+}
+
+//-------------- Parsing
+
+enum {
+	RE_SET,
+	RE_CAT,
+	RE_ALT,
+	RE_STAR,
+	RE_PLUS,
+	RE_QUEST,
+	RE_REPEAT,
+	RE_EMPTY,
+	RE_BOL,
+	RE_EOL
+};
+
+struct re_node {
+	unsigned char type;
+	struct re_node *a, *b;
+	int min, max; //RE_REPEAT, max is -1 when unbounded
+	int set_i; //Index of the set once it has been added to the NFA
+	byte_set set;
+};
+
+struct re_parser {
+	const char *p, *end;
+	memory_region *region;
+	const char *err;
+	unsigned depth;
+};
+
+static struct re_node *new_node(struct re_parser *ps, unsigned char type, struct re_node *a, struct re_node *b) {
+	struct re_node *n = ralloc(ps->region, struct re_node);
+	memset(n, 0, sizeof(struct re_node));
+	n->type = type;
+	n->a = a;
+	n->b = b;
+	n->set_i = -1;
+	return n;
+}
+
+static unsigned char escape_char(char c) {
+	switch(c) {
+		case 'n': return '\n';
+		case 't': return '\t';
+		case 'r': return '\r';
+		case 'f': return '\f';
+		case 'v': return '\v';
+		default: return c;
+	}
+}
+
+//Adds the class for \d, \w, \s and their negations, false if c isn't one of those
+static bool escape_class(char c, byte_set *set) {
+	byte_set class;
+	memset(&class, 0, sizeof(class));
+	
+	switch(c) {
+		case 'd':
+		case 'D':
+			set_add_range(&class, '0', '9');
+			break;
+		
+		case 'w':
+		case 'W':
+			set_add_range(&class, '0', '9');
+			set_add_range(&class, 'a', 'z');
+			set_add_range(&class, 'A', 'Z');
+			set_add(&class, '_');
+			break;
+		
+		case 's':
+		case 'S':
+			set_add(&class, ' ');
+			set_add_range(&class, '\t', '\r');
+			break;
+		
+		default:
+			return false;
+	}
+	
+	if(c == 'D' || c == 'W' || c == 'S')
+		set_invert(&class);
+	
+	for(unsigned i = 0; i < sizeof(set->bits); i++)
+		set->bits[i] |= class.bits[i];
+	return true;
+}
+
+static struct re_node *parse_alt(struct re_parser *ps);
+
+static struct re_node *parse_class(struct re_parser *ps) {
+	struct re_node *n = new_node(ps, RE_SET, NULL, NULL);
+	
+	bool negate = false;
+	if(ps->p < ps->end && *ps->p == '^') {
+		negate = true;
+		ps->p++;
+	}
+	
+	for(bool first = true;; first = false) {
+		if(ps->p >= ps->end) {
+			ps->err = "missing ]";
+			return NULL;
+		}
+		
+		char c = *(ps->p++);
+		if(c == ']' && !first)
+			break;
+		
+		unsigned char lo = c;
+		if(c == '\\') {
+			if(ps->p >= ps->end) {
+				ps->err = "trailing backslash";
+				return NULL;
+			}
+			char e = *(ps->p++);
+			if(escape_class(e, &n->set))
+				continue;
+			lo = escape_char(e);
+		}
+		
+		if(ps->p + 1 < ps->end && *ps->p == '-' && ps->p[1] != ']') {
+			ps->p++;
+			unsigned char hi = *(ps->p++);
+			if(hi == '\\') {
+				if(ps->p >= ps->end) {
+					ps->err = "trailing backslash";
+					return NULL;
+				}
+				hi = escape_char(*(ps->p++));
+			}
+			
+			if(hi < lo) {
+				ps->err = "invalid range in class";
+				return NULL;
+			}
+			set_add_range(&n->set, lo, hi);
+		} else {
+			set_add(&n->set, lo);
+		}
+	}
+	
+	if(negate)
+		set_invert(&n->set);
+	
+	return n;
+}
+
+static struct re_node *parse_atom(struct re_parser *ps) {
+	char c = *(ps->p++);
+	
+	switch(c) {
+		case '(': {
+			if(ps->end - ps->p >= 2 && ps->p[0] == '?' && ps->p[1] == ':')
+				ps->p += 2;
+			
+			if(++ps->depth > MAX_GROUP_DEPTH) {
+				ps->err = "groups nested too deeply";
+				return NULL;
+			}
+			
+			struct re_node *n = parse_alt(ps);
+			if(ps->err)
+				return NULL;
+			
+			if(ps->p >= ps->end || *ps->p != ')') {
+				ps->err = "missing )";
+				return NULL;
+			}
+			ps->p++;
+			ps->depth--;
+			return n;
+		}
+		
+		case '[':
+			return parse_class(ps);
+		
+		case '.': {
+			struct re_node *n = new_node(ps, RE_SET, NULL, NULL);
+			set_add(&n->set, '\n');
+			set_invert(&n->set);
+			return n;
+		}
+		
+		case '^':
+			return new_node(ps, RE_BOL, NULL, NULL);
+		
+		case '$':
+			return new_node(ps, RE_EOL, NULL, NULL);
+		
+		case '*':
+		case '+':
+		case '?':
+			ps->err = "nothing to repeat";
+			return NULL;
+		
+		case '\\': {
+			if(ps->p >= ps->end) {
+				ps->err = "trailing backslash";
+				return NULL;
+			}
+			
+			struct re_node *n = new_node(ps, RE_SET, NULL, NULL);
+			char e = *(ps->p++);
+			if(!escape_class(e, &n->set))
+				set_add(&n->set, escape_char(e));
+			return n;
+		}
+		
+		default: {
+			struct re_node *n = new_node(ps, RE_SET, NULL, NULL);
+			set_add(&n->set, c);
+			return n;
+		}
+	}
+}
+
+static bool is_digit(char c) {
+	return c >= '0' && c <= '9';
+}
+
+static int parse_count(struct re_parser *ps) {
+	int v = 0;
+	while(ps->p < ps->end && is_digit(*ps->p)) {
+		v = v * 10 + (*(ps->p++) - '0');
+		if(v > MAX_REPEAT)
+			return -1;
+	}
+	return v;
+}
+
+//Parses {m}, {m,} or {m,n} after the '{'
+static bool parse_braces(struct re_parser *ps, int *min, int *max) {
+	*min = parse_count(ps);
+	*max = *min;
+	
+	if(ps->p < ps->end && *ps->p == ',') {
+		ps->p++;
+		*max = (ps->p < ps->end && is_digit(*ps->p)) ? parse_count(ps) : -2;
+	}
+	
+	if(*min < 0 || *max == -1) {
+		ps->err = "repetition count too large";
+		return false;
+	}
+	if(ps->p >= ps->end || *ps->p != '}') {
+		ps->err = "missing }";
+		return false;
+	}
+	ps->p++;
+	
+	if(*max == -2)
+		*max = -1;
+	else if(*max < *min) {
+		ps->err = "invalid repetition count";
+		return false;
+	}
+	return true;
+}
+
+static struct re_node *parse_repeat(struct re_parser *ps) {
+	struct re_node *n = parse_atom(ps);
+	
+	while(!ps->err && ps->p < ps->end) {
+		char c = *ps->p;
+		
+		if(c == '*') {
+			n = new_node(ps, RE_STAR, n, NULL);
+		} else if(c == '+') {
+			n = new_node(ps, RE_PLUS, n, NULL);
+		} else if(c == '?') {
+			n = new_node(ps, RE_QUEST, n, NULL);
+		} else if(c == '{' && ps->p + 1 < ps->end && is_digit(ps->p[1])) {
+			ps->p++;
+			int min, max;
+			if(!parse_braces(ps, &min, &max))
+				return NULL;
+			
+			n = new_node(ps, RE_REPEAT, n, NULL);
+			n->min = min;
+			n->max = max;
+			continue;
+		} else {
+			break;
+		}
+		
+		ps->p++;
+	}
+	
+	return ps->err ? NULL : n;
+}
+
+static struct re_node *parse_cat(struct re_parser *ps) {
+	struct re_node *n = NULL;
+	
+	while(ps->p < ps->end && *ps->p != '|' && *ps->p != ')') {
+		struct re_node *r = parse_repeat(ps);
+		if(ps->err)
+			return NULL;
+		
+		n = n != NULL ? new_node(ps, RE_CAT, n, r) : r;
+	}
+	
+	return n != NULL ? n : new_node(ps, RE_EMPTY, NULL, NULL);
+}
+
+static struct re_node *parse_alt(struct re_parser *ps) {
+	struct re_node *n = parse_cat(ps);
+	
+	while(!ps->err && ps->p < ps->end && *ps->p == '|') {
+		ps->p++;
+		struct re_node *r = parse_cat(ps);
+		if(ps->err)
+			return NULL;
+		
+		n = new_node(ps, RE_ALT, n, r);
+	}
+	
+	return ps->err ? NULL : n;
+}
+
+//-------------- NFA
+
+enum {
+	NFA_CHAR,
+	NFA_SPLIT,
+	NFA_BOL,
+	NFA_EOL,
+	NFA_MATCH
+};
+
+struct nfa_state {
+	unsigned char type;
+	unsigned out, out1;
+	unsigned set;
+};
+
+struct dfa_state {
+	unsigned *nfa;
+	unsigned n_nfa;
+	bool accept;
+	int *next; //Per byte class plus end of text, -1 until computed
+};
+
+struct dfa {
+	bool unanchored; //Restarts the pattern at every position, for finding a match anywhere in one pass
+	struct { struct dfa_state *items; unsigned len, cap; } states;
+	int *table;
+	unsigned table_cap;
+	int start[2]; //Not at / at the start of the text
+	unsigned flushes;
+};
+
+struct regex {
+	struct { struct nfa_state *items; unsigned len, cap; } states;
+	struct { byte_set *items; unsigned len, cap; } sets;
+	unsigned start;
+	bool too_big;
+	
+	unsigned char classes[256];
+	unsigned char class_byte[256]; //A byte from each class
+	unsigned n_classes; //The end of the text is class n_classes
+	
+	bool anchored_begin;
+	char prefix[MAX_PREFIX_LEN];
+	size_t prefix_len;
+	bool use_first_bytes;
+	bool first_bytes[256];
+	
+	unsigned *stack, *list, *marks;
+	unsigned mark_gen;
+	
+	struct dfa anchored, unanchored;
+};
+
+static unsigned add_state(struct regex *re, unsigned char type, unsigned out, unsigned out1) {
+	if(re->states.len >= MAX_NFA_STATES) {
+		re->too_big = true;
+		return 0;
+	}
+	
+	if(re->states.len == re->states.cap) {
+		re->states.cap += 1;
+		re->states.cap *= 2;
+		re->states.items = SREALLOC(struct nfa_state, re->states.items, re->states.cap);
+	}
+	
+	re->states.items[re->states.len] = (struct nfa_state) { .type = type, .out = out, .out1 = out1 };
+	return re->states.len++;
+}
+
+static unsigned add_set(struct regex *re, const byte_set *set) {
+	if(re->sets.len == re->sets.cap) {
+		re->sets.cap += 1;
+		re->sets.cap *= 2;
+		re->sets.items = SREALLOC(byte_set, re->sets.items, re->sets.cap);
+	}
+	
+	re->sets.items[re->sets.len] = *set;
+	return re->sets.len++;
+}
+
+//Emits the states for n, continuing to next, and returns the entry state. Built back to front so no patching is needed.
+static unsigned emit(struct regex *re, struct re_node *n, unsigned next) {
+	if(re->too_big)
+		return next;
+	
+	switch(n->type) {
+		case RE_SET: {
+			if(n->set_i < 0)
+				n->set_i = add_set(re, &n->set);
+			
+			unsigned s = add_state(re, NFA_CHAR, next, 0);
+			if(!re->too_big)
+				re->states.items[s].set = n->set_i;
+			return s;
+		}
+		
+		case RE_CAT:
+			return emit(re, n->a, emit(re, n->b, next));
+		
+		case RE_ALT: {
+			unsigned a = emit(re, n->a, next);
+			unsigned b = emit(re, n->b, next);
+			return add_state(re, NFA_SPLIT, a, b);
+		}
+		
+		case RE_QUEST:
+			return add_state(re, NFA_SPLIT, emit(re, n->a, next), next);
+		
+		case RE_STAR:
+		case RE_PLUS: {
+			unsigned loop = add_state(re, NFA_SPLIT, 0, next);
+			unsigned body = emit(re, n->a, loop);
+			if(!re->too_big)
+				re->states.items[loop].out = body;
+			return n->type == RE_STAR ? loop : body;
+		}
+		
+		case RE_REPEAT: {
+			unsigned cur = next;
+			
+			if(n->max < 0) {
+				unsigned loop = add_state(re, NFA_SPLIT, 0, next);
+				unsigned body = emit(re, n->a, loop);
+				if(!re->too_big)
+					re->states.items[loop].out = body;
+				cur = loop;
+			} else {
+				for(int i = n->min; i < n->max; i++)
+					cur = add_state(re, NFA_SPLIT, emit(re, n->a, cur), next);
+			}
+			
+			for(int i = 0; i < n->min; i++)
+				cur = emit(re, n->a, cur);
+			return cur;
+		}
+		
+		case RE_BOL:
+			return add_state(re, NFA_BOL, next, 0);
+		
+		case RE_EOL:
+			return add_state(re, NFA_EOL, next, 0);
+		
+		default:
+			return next;
+	}
+}
+
+//Collects the literal bytes every match has to start with; returns whether all of n was literal
+static bool collect_prefix(const struct re_node *n, char *prefix, size_t *len) {
+	switch(n->type) {
+		case RE_SET: {
+			int byte = -1;
+			for(unsigned c = 0; c < 256; c++) {
+				if(set_has(&n->set, c)) {
+					if(byte >= 0)
+						return false;
+					byte = c;
+				}
+			}
+			
+			if(byte < 0 || *len == MAX_PREFIX_LEN)
+				return false;
+			prefix[(*len)++] = byte;
+			return true;
+		}
+		
+		case RE_CAT:
+			return collect_prefix(n->a, prefix, len) && collect_prefix(n->b, prefix, len);
+		
+		default:
+			return false;
+	}
+}
+
+//Splits the bytes into classes that no set tells apart, so DFA rows only need one column per class
+static void compute_classes(struct regex *re) {
+	memset(re->classes, 0, sizeof(re->classes));
+	unsigned n_classes = 1;
+	
+	for(unsigned i = 0; i < re->sets.len; i++) {
+		short remap[2][256];
+		memset(remap, -1, sizeof(remap));
+		
+		unsigned n_new = 0;
+		for(unsigned c = 0; c < 256; c++) {
+			bool in = set_has(&re->sets.items[i], c);
+			if(remap[in][re->classes[c]] < 0)
+				remap[in][re->classes[c]] = n_new++;
+			re->classes[c] = remap[in][re->classes[c]];
+		}
+		n_classes = n_new;
+	}
+	
+	re->n_classes = n_classes;
+	for(unsigned c = 0; c < 256; c++)
+		re->class_byte[re->classes[c]] = c;
+}
+
+//-------------- Lazy DFA
+
+//Adds the states reachable from s without consuming input to re->list, skipping ones already marked
+static void add_closure(struct regex *re, unsigned s, bool at_begin, bool at_end, unsigned *n_list) {
+	unsigned top = 0;
+	re->stack[top++] = s;
+	
+	while(top > 0) {
+		s = re->stack[--top];
+		if(re->marks[s] == re->mark_gen)
+			continue;
+		re->marks[s] = re->mark_gen;
+		
+		const struct nfa_state *st = &re->states.items[s];
+		switch(st->type) {
+			case NFA_SPLIT:
+				re->stack[top++] = st->out1;
+				re->stack[top++] = st->out;
+				break;
+			
+			case NFA_BOL:
+				if(at_begin)
+					re->stack[top++] = st->out;
+				break;
+			
+			case NFA_EOL:
+				if(at_end)
+					re->stack[top++] = st->out;
+				else
+					re->list[(*n_list)++] = s;
+				break;
+			
+			default:
+				re->list[(*n_list)++] = s;
+				break;
+		}
+	}
+}
+
+static int cmp_unsigned(const void *a, const void *b) {
+	unsigned x = *(const unsigned *) a, y = *(const unsigned *) b;
+	return (x > y) - (x < y);
+}
+
+static void dfa_init(struct dfa *dfa, bool unanchored) {
+	dfa->unanchored = unanchored;
+	dfa->states.items = NULL;
+	dfa->states.len = dfa->states.cap = 0;
+	dfa->table_cap = 64;
+	dfa->table = NSALLOC(int, dfa->table_cap);
+	memset(dfa->table, -1, sizeof(int) * dfa->table_cap);
+	dfa->start[0] = dfa->start[1] = -1;
+	dfa->flushes = 0;
+}
+
+static void dfa_clear(struct dfa *dfa) {
+	for(unsigned i = 0; i < dfa->states.len; i++) {
+		s_dealloc(dfa->states.items[i].nfa);
+		s_dealloc(dfa->states.items[i].next);
+	}
+	dfa->states.len = 0;
+	memset(dfa->table, -1, sizeof(int) * dfa->table_cap);
+	dfa->start[0] = dfa->start[1] = -1;
+	dfa->flushes++;
+}
+
+static void dfa_free(struct dfa *dfa) {
+	dfa_clear(dfa);
+	s_dealloc(dfa->states.items);
+	s_dealloc(dfa->table);
+}
+
+static unsigned long long hash_nfa_list(const unsigned *list, unsigned n) {
+	return hash_bytes(list, sizeof(unsigned) * n, 0);
+}
+
+static void dfa_grow_table(struct dfa *dfa) {
+	s_dealloc(dfa->table);
+	dfa->table_cap *= 2;
+	dfa->table = NSALLOC(int, dfa->table_cap);
+	memset(dfa->table, -1, sizeof(int) * dfa->table_cap);
+	
+	for(unsigned i = 0; i < dfa->states.len; i++) {
+		const struct dfa_state *d = &dfa->states.items[i];
+		unsigned slot = hash_nfa_list(d->nfa, d->n_nfa) & (dfa->table_cap - 1);
+		while(dfa->table[slot] >= 0)
+			slot = (slot + 1) & (dfa->table_cap - 1);
+		dfa->table[slot] = i;
+	}
+}
+
+//Finds or adds the DFA state for the set of NFA states in re->list. When the cache is full it is flushed and starts over.
+static int dfa_get_state(struct regex *re, struct dfa *dfa, unsigned n_list) {
+	qsort(re->list, n_list, sizeof(unsigned), cmp_unsigned);
+	
+	unsigned long long h = hash_nfa_list(re->list, n_list);
+	unsigned slot = h & (dfa->table_cap - 1);
+	
+	for(; dfa->table[slot] >= 0; slot = (slot + 1) & (dfa->table_cap - 1)) {
+		const struct dfa_state *d = &dfa->states.items[dfa->table[slot]];
+		if(d->n_nfa == n_list && memcmp(d->nfa, re->list, sizeof(unsigned) * n_list) == 0)
+			return dfa->table[slot];
+	}
+	
+	if(dfa->states.len >= MAX_DFA_STATES) {
+		dfa_clear(dfa);
+		slot = h & (dfa->table_cap - 1);
+	}
+	
+	if(dfa->states.len == dfa->states.cap) {
+		dfa->states.cap += 1;
+		dfa->states.cap *= 2;
+		dfa->states.items = SREALLOC(struct dfa_state, dfa->states.items, dfa->states.cap);
+	}
+	
+	struct dfa_state *d = &dfa->states.items[dfa->states.len];
+	d->n_nfa = n_list;
+	d->nfa = NSALLOC(unsigned, n_list > 0 ? n_list : 1);
+	memcpy(d->nfa, re->list, sizeof(unsigned) * n_list);
+	
+	d->accept = false;
+	for(unsigned i = 0; i < n_list; i++) {
+		if(re->states.items[re->list[i]].type == NFA_MATCH)
+			d->accept = true;
+	}
+	
+	d->next = NSALLOC(int, re->n_classes + 1);
+	memset(d->next, -1, sizeof(int) * (re->n_classes + 1));
+	
+	int id = dfa->states.len++;
+	dfa->table[slot] = id;
+	
+	if(dfa->states.len * 2 >= dfa->table_cap)
+		dfa_grow_table(dfa);
+	
+	return id;
+}
+
+static int dfa_start(struct regex *re, struct dfa *dfa, bool at_begin) {
+	if(dfa->start[at_begin] >= 0)
+		return dfa->start[at_begin];
+	
+	unsigned n_list = 0;
+	re->mark_gen++;
+	add_closure(re, re->start, at_begin, false, &n_list);
+	
+	int id = dfa_get_state(re, dfa, n_list);
+	dfa->start[at_begin] = id;
+	return id;
+}
+
+static int dfa_step(struct regex *re, struct dfa *dfa, int state, unsigned class) {
+	int next = dfa->states.items[state].next[class];
+	if(next >= 0)
+		return next;
+	
+	unsigned n_list = 0;
+	re->mark_gen++;
+	
+	const struct dfa_state *d = &dfa->states.items[state];
+	bool at_end = class == re->n_classes;
+	
+	for(unsigned i = 0; i < d->n_nfa; i++) {
+		const struct nfa_state *st = &re->states.items[d->nfa[i]];
+		
+		if(at_end) {
+			if(st->type == NFA_EOL)
+				add_closure(re, st->out, false, true, &n_list);
+		} else if(st->type == NFA_CHAR && set_has(&re->sets.items[st->set], re->class_byte[class])) {
+			add_closure(re, st->out, false, false, &n_list);
+		}
+	}
+	
+	if(dfa->unanchored)
+		add_closure(re, re->start, false, at_end, &n_list);
+	
+	unsigned flushes = dfa->flushes;
+	next = dfa_get_state(re, dfa, n_list);
+	
+	//If the cache was flushed the state we came from is gone
+	if(dfa->flushes == flushes)
+		dfa->states.items[state].next[class] = next;
+	
+	return next;
+}
+
+//-------------- Matching
+
+//The first position at or after pos where a match could start, or len + 1 if there is none
+static size_t next_candidate(const struct regex *re, const char *str, size_t len, size_t pos) {
+	if(re->prefix_len > 0) {
+		if(pos >= len)
+			return len + 1;
+		
+		const char *p = memmem(str + pos, len - pos, re->prefix, re->prefix_len);
+		return p != NULL ? (size_t) (p - str) : len + 1;
+	}
+	
+	if(re->use_first_bytes) {
+		for(; pos < len; pos++) {
+			if(re->first_bytes[(unsigned char) str[pos]])
+				return pos;
+		}
+		return len + 1;
+	}
+	
+	return pos;
+}
+
+static bool dfa_scan_any(struct regex *re, struct dfa *dfa, const char *str, size_t len, size_t pos) {
+	int state = dfa_start(re, dfa, pos == 0);
+	
+	for(; pos < len; pos++) {
+		if(dfa->states.items[state].accept)
+			return true;
+		
+		state = dfa_step(re, dfa, state, re->classes[(unsigned char) str[pos]]);
+		if(dfa->states.items[state].n_nfa == 0)
+			return false;
+	}
+	
+	if(dfa->states.items[state].accept)
+		return true;
+	
+	state = dfa_step(re, dfa, state, re->n_classes);
+	return dfa->states.items[state].accept;
+}
+
+//The end of the longest match starting at pos, or -1
+static long long dfa_longest(struct regex *re, const char *str, size_t len, size_t pos) {
+	struct dfa *dfa = &re->anchored;
+	int state = dfa_start(re, dfa, pos == 0);
+	long long last = dfa->states.items[state].accept ? (long long) pos : -1;
+	
+	for(; pos < len; pos++) {
+		state = dfa_step(re, dfa, state, re->classes[(unsigned char) str[pos]]);
+		if(dfa->states.items[state].n_nfa == 0)
+			return last;
+		if(dfa->states.items[state].accept)
+			last = pos + 1;
+	}
+	
+	state = dfa_step(re, dfa, state, re->n_classes);
+	if(dfa->states.items[state].accept)
+		last = len;
+	
+	return last;
+}
+
+static bool scan_from(struct regex *re, const char *str, size_t len, size_t from) {
+	if(re->anchored_begin)
+		return from == 0 && dfa_scan_any(re, &re->anchored, str, len, 0);
+	
+	size_t pos = next_candidate(re, str, len, from);
+	if(pos > len)
+		return false;
+	
+	return dfa_scan_any(re, &re->unanchored, str, len, pos);
+}
+
+bool regex_is_match(struct regex *re, const char *str, size_t len) {
+	return scan_from(re, str, len, 0);
+}
+
+bool regex_find(struct regex *re, const char *str, size_t len, size_t from, size_t *start, size_t *end) {
+	if(from > len || !scan_from(re, str, len, from))
+		return false;
+	
+	//A match exists, so find where the leftmost one starts and how far it goes
+	for(size_t pos = from; pos <= len; pos++) {
+		pos = next_candidate(re, str, len, pos);
+		if(pos > len)
+			break;
+		
+		long long e = dfa_longest(re, str, len, pos);
+		if(e >= 0) {
+			*start = pos;
+			*end = e;
+			return true;
+		}
+		
+		if(re->anchored_begin)
+			break;
+	}
+	
+	return false;
+}
+
+//-------------- Compilation
+
+static void compute_first_bytes(struct regex *re) {
+	//Passing '^' only adds states, so this covers candidates at and after the start of the text
+	unsigned n_list = 0;
+	re->mark_gen++;
+	add_closure(re, re->start, true, false, &n_list);
+	
+	memset(re->first_bytes, 0, sizeof(re->first_bytes));
+	re->use_first_bytes = false;
+	
+	for(unsigned i = 0; i < n_list; i++) {
+		const struct nfa_state *st = &re->states.items[re->list[i]];
+		if(st->type != NFA_CHAR)
+			return; //Can match the empty string, or only at the end
+		
+		for(unsigned c = 0; c < 256; c++) {
+			if(set_has(&re->sets.items[st->set], c))
+				re->first_bytes[c] = true;
+		}
+	}
+	
+	for(unsigned c = 0; c < 256; c++) {
+		if(!re->first_bytes[c]) {
+			re->use_first_bytes = true;
+			break;
+		}
+	}
+}
+
+struct regex *regex_compile(const char *pattern, size_t len, const char **err) {
+	memory_region *region = NEW_REGION();
+	
+	struct re_parser ps = { .p = pattern, .end = pattern + len, .region = region, .err = NULL, .depth = 0 };
+	struct re_node *root = parse_alt(&ps);
+	if(ps.err == NULL && ps.p < ps.end)
+		ps.err = "unmatched )";
+	
+	if(ps.err != NULL) {
+		free_memory_region(region);
+		*err = ps.err;
+		return NULL;
+	}
+	
+	struct regex *re = SALLOC(struct regex);
+	memset(re, 0, sizeof(struct regex));
+	
+	unsigned match = add_state(re, NFA_MATCH, 0, 0);
+	re->start = emit(re, root, match);
+	
+	if(re->too_big) {
+		free_memory_region(region);
+		s_dealloc(re->states.items);
+		s_dealloc(re->sets.items);
+		s_dealloc(re);
+		*err = "pattern too large";
+		return NULL;
+	}
+	
+	const struct re_node *leftmost = root;
+	while(leftmost->type == RE_CAT)
+		leftmost = leftmost->a;
+	re->anchored_begin = leftmost->type == RE_BOL;
+	
+	if(!re->anchored_begin)
+		collect_prefix(root, re->prefix, &re->prefix_len);
+	
+	free_memory_region(region);
+	
+	compute_classes(re);
+	
+	unsigned n = re->states.len;
+	re->stack = NSALLOC(unsigned, n * 2 + 2);
+	re->list = NSALLOC(unsigned, n);
+	re->marks = NSALLOC(unsigned, n);
+	memset(re->marks, 0, sizeof(unsigned) * n);
+	re->mark_gen = 0;
+	
+	compute_first_bytes(re);
+	
+	dfa_init(&re->anchored, false);
+	dfa_init(&re->unanchored, true);
+	
+	return re;
+}
+
+void regex_free(struct regex *re) {
+	dfa_free(&re->anchored);
+	dfa_free(&re->unanchored);
+	
+	s_dealloc(re->states.items);
+	s_dealloc(re->sets.items);
+	s_dealloc(re->stack);
+	s_dealloc(re->list);
+	s_dealloc(re->marks);
+	s_dealloc(re);
+}
@@ -0,0 +1,28 @@
+#ifndef REGEX_H_INCLUDED
+#define REGEX_H_INCLUDED
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Byte oriented regular expressions, compiled to an NFA which is turned into a DFA lazily while matching.
+ * Supported: literals, '.', [classes] with ranges and negation, \d \w \s (and \D \W \S), groups, '|',
+ * '*', '+', '?', {m}, {m,} and {m,n}, and the anchors '^' and '$' (start and end of the whole text).
+ * Matches are leftmost, then longest. There are no capture groups.
+ *
+ * A compiled regex caches DFA states as it runs, so it must not be shared between threads.
+ */
+
+struct regex;
+
+//Returns NULL and sets err to a static description if the pattern is invalid
+struct regex *regex_compile(const char *pattern, size_t len, const char **err);
+void regex_free(struct regex *re);
+
+//Whether the pattern matches anywhere in str
+bool regex_is_match(struct regex *re, const char *str, size_t len);
+
+//Finds the leftmost-longest match starting at or after from; the match is [*start, *end)
+bool regex_find(struct regex *re, const char *str, size_t len, size_t from, size_t *start, size_t *end);
+
+#endif
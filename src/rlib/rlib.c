@@ -1,5 +1,80 @@
 #include "rlib.h"
 
+#include <string.h>
+
+#include "../interpreter/interpreter_map.h"
+#include "../interpreter/interpreter_pvec.h"
+#include "../interpreter/interpreter_pmap.h"
+#include "../interpreter/interpreter_intvec.h"
+#include "../interpreter/interpreter_iter.h"
+#include "../interpreter/interpreter_range.h"
+
+struct r_val rlib_op_result(struct r_val val) {
+	switch(val.type) {
+		case TYPE_STR:
+			val.str_v->ref_c--;
+			break;
+		
+		case TYPE_ARRAY:
+			val.array_v->ref_c--;
+			break;
+		
+		case TYPE_STRBUILDER:
+			val.builder_v->ref_c--;
+			break;
+		
+		case TYPE_REGEX:
+			val.regex_v->ref_c--;
+			break;
+		
+		case TYPE_MAP:
+		case TYPE_SET:
+			val.map_v->ref_c--;
+			break;
+		
+		case TYPE_PVEC:
+			val.pvec_v->ref_c--;
+			break;
+		
+		case TYPE_PMAP:
+			val.pmap_v->ref_c--;
+			break;
+		
+		case TYPE_INTVEC:
+			val.intvec_v->ref_c--;
+			break;
+		
+		case TYPE_ITER:
+			val.iter_v->ref_c--;
+			break;
+		
+		case TYPE_RANGE:
+			val.range_v->ref_c--;
+			break;
+	}
+	
+	return val;
+}
+
+bool rlib_is_unique(struct r_val val) {
+	switch(val.type) {
+		case TYPE_STR: //Slices share their bytes with the parent
+			return val.str_v->ref_c == 1 && val.str_v->parent == NULL;
+		
+		case TYPE_ARRAY: //A slice's items belong to its parent
+			return val.array_v->ref_c == 1 && val.array_v->parent == NULL;
+		
+		case TYPE_PMAP:
+			return val.pmap_v->ref_c == 1;
+		
+		case TYPE_INTVEC:
+			return val.intvec_v->ref_c == 1;
+		
+		default:
+			return false;
+	}
+}
+
 int r_val_as_bool(struct r_val val) {
 	switch(val.type) {
 		
@@ -25,11 +100,12 @@ int cmp_r_vals(struct r_val a, struct r_val b) {
 		case TYPE_STR:
 			if(a.str_v->len != b.str_v->len)
 				return 0;
-			for(unsigned i = 0; i < a.str_v->len; i++) {
-				if(a.str_v->str[i] != b.str_v->str[i])
-					return 0;
-			}
-			return 1;
+			if(a.str_v->str == b.str_v->str)
+				return 1;
+			//Only use hashes that are already known, computing one costs as much as comparing
+			if((a.str_v->flags & b.str_v->flags & R_STRING_HASHED) && a.str_v->hash != b.str_v->hash)
+				return 0;
+			return memcmp(a.str_v->str, b.str_v->str, a.str_v->len) == 0;
 		
 		case TYPE_FN:
 			return a.fn == b.fn;
@@ -42,30 +118,79 @@ int cmp_r_vals(struct r_val a, struct r_val b) {
 	}
 }
 
-int r_vals_less(struct r_val a, struct r_val b) {
+static bool is_number(struct r_val val) {
+	return val.type == TYPE_INT || val.type == TYPE_FLOAT;
+}
+
+static r_float as_float(struct r_val val) {
+	return val.type == TYPE_INT ? (r_float) val.int_v : val.float_v;
+}
+
+//Numbers sort before strings, and strings before arrays
+static unsigned type_rank(unsigned char type) {
+	switch(type) {
+		case TYPE_NULL:
+			return 0;
+		case TYPE_INT:
+		case TYPE_FLOAT:
+			return 1;
+		case TYPE_STR:
+			return 2;
+		case TYPE_ARRAY:
+			return 3;
+		default:
+			return 4 + type;
+	}
+}
+
+int r_vals_order(struct r_val a, struct r_val b) {
+	if(a.type == TYPE_INT && b.type == TYPE_INT)
+		return a.int_v < b.int_v ? -1 : a.int_v > b.int_v;
+	
+	if(is_number(a) && is_number(b)) {
+		r_float fa = as_float(a), fb = as_float(b);
+		return fa < fb ? -1 : fa > fb;
+	}
+	
 	if(a.type != b.type)
-		return 0;
+		return type_rank(a.type) < type_rank(b.type) ? -1 : type_rank(a.type) > type_rank(b.type);
 	
 	switch(a.type) {
-		case TYPE_INT:
-			return a.int_v < b.int_v;
+		case TYPE_STR: {
+			unsigned len = a.str_v->len < b.str_v->len ? a.str_v->len : b.str_v->len;
+			int res = memcmp(a.str_v->str, b.str_v->str, len);
+			if(res != 0)
+				return res < 0 ? -1 : 1;
+			return a.str_v->len < b.str_v->len ? -1 : a.str_v->len > b.str_v->len;
+		}
+		
+		case TYPE_ARRAY: {
+			struct r_array *x = a.array_v, *y = b.array_v;
+			for(unsigned i = 0; i < x->len && i < y->len; i++) {
+				int res = r_vals_order(x->items[i], y->items[i]);
+				if(res != 0)
+					return res;
+			}
+			return x->len < y->len ? -1 : x->len > y->len;
+		}
 		
 		default:
 			return 0;
 	}
 }
 
+int r_vals_less(struct r_val a, struct r_val b) {
+	if(a.type != b.type)
+		return 0;
+	
+	return r_vals_order(a, b) < 0;
+}
+
 int r_vals_greater(struct r_val a, struct r_val b) {
 	if(a.type != b.type)
 		return 0;
 	
-	switch(a.type) {
-		case TYPE_INT:
-			return a.int_v > b.int_v;
-		
-		default:
-			return 0;
-	}
+	return r_vals_order(a, b) > 0;
 }
 
 #include <string.h>
@@ -79,12 +204,35 @@ char *r_string_to_cstr(const struct r_string *str) {
 }
 
 struct r_string *cstr_to_rstring(const char *str) {
-	unsigned len = strlen(str);
-	struct r_string *res = s_alloc(sizeof(struct r_string) + len);
-	res->len = len;
-	res->ref_c = 1;
+	return int_new_string(str, strlen(str));
+}
+
+struct r_string *read_r_string_line(FILE *f) {
+	char *buff, *end, *top;
+	buff = s_alloc(8);
+	top = buff;
+	end = buff + 8;
+	
+	int res;
+	while( (res = fgetc(f)) != EOF) {
+		if(res == '\n')
+			break;
+		
+		if(top == end) {
+			size_t cap = end - buff;
+			buff = s_realloc(buff, cap * 2);
+			end = buff + cap * 2;
+			top = buff + cap;
+		}
+		*(top++) = res;
+	}
+	if(res == EOF && top == buff) { //If nothing was read from the file/stream and an end of file was returned
+		s_dealloc(buff);
+		return NULL;
+	}
 	
-	memcpy( (char *) res->str, str, len);
+	struct r_string *str = int_new_string(buff, top - buff);
+	s_dealloc(buff);
 	
-	return res;
+	return str;
 }
@@ -38,19 +38,33 @@ for(int i = 0; i < sizeof(array)/sizeof(array[0]); i++) { \
 		array[i].fn_v = int_register_extern_fn(array[i].fn, array[i].arity); \
 	else if(array[i].type == 1) \
 		array[i].fn_v = int_register_extern_runtime_fn(array[i].runtime_fn, array[i].arity); \
-	else if(array[i].type == 2) \
+	else if(array[i].type == 2 && i > 0) \
 		array[i].fn_v = array[i - 1].fn_v; \
 }
 
 #define PUT_RLIB(array, env) for(int i = 0; i < sizeof(array)/sizeof(array[0]); i++) { S_ASSERT(array[i].loaded); int_env_set(env, array[i].sym_name, array[i].fn_v, 1, 1); }
 
+//int_call_fn takes its own reference to what non-runtime builtins return, so a value such a builtin creates is returned through this
+struct r_val rlib_op_result(struct r_val val);
+
+//Whether a runtime builtin may reuse an argument's storage for its result: the argument buffer holds the only reference,
+//so the value is a temporary that would be freed right after the call. The result still needs its own reference.
+bool rlib_is_unique(struct r_val val);
+
 int r_val_as_bool(struct r_val val);
 
 int cmp_r_vals(struct r_val a, struct r_val b);
+//A total order for sorting: ints and floats by value, strings by their bytes, arrays item by item. Values of different
+//types order by type, except ints and floats which compare as numbers.
+int r_vals_order(struct r_val a, struct r_val b);
+//Only true for values of the same type
 int r_vals_less(struct r_val a, struct r_val b);
 int r_vals_greater(struct r_val a, struct r_val b);
 
 char *r_string_to_cstr(const struct r_string *str);
 struct r_string *cstr_to_rstring(const char *str);
 
+//Reads a line (without the trailing newline) from f. Returns NULL if the stream was already at its end.
+struct r_string *read_r_string_line(FILE *f);
+
 #endif
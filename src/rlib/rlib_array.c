@@ -0,0 +1,190 @@
+#include "rlib_array.h"
+
+#include "rlib.h"
+
+#include <string.h>
+
+/*
+ * push, pop, extend and insert change the array held by a variable: in place if nothing else references it, otherwise
+ * the variable gets a modified copy so that the array never changes under its other owners. They evaluate to the new length
+ * (or the popped item) rather than to the array, since keeping the result around, e.g in the output of map, would be
+ * another reference and force the next call to copy.
+ *
+ * slice makes a view of part of an array without copying its items. The view keeps the whole array it came from alive, and
+ * is copied by the first of the above to change it.
+ */
+
+//Takes over one reference to the array and returns a singly referenced one with room for extra more items
+static struct r_array *make_writable(struct r_array *array, unsigned extra) {
+	if(array->ref_c == 1 && array->parent == NULL)
+		return int_array_reserve(array, array->len + extra);
+	
+	struct r_array *copy = int_new_array(array->len);
+	copy = int_array_reserve(copy, array->len + extra);
+	for(unsigned i = 0; i < array->len; i++) {
+		copy->items[i] = array->items[i];
+		int_incr_refcount(copy->items[i]);
+	}
+	
+	int_decr_refcount((struct r_val) { .type = TYPE_ARRAY, .array_v = array }); //Only frees a slice
+	return copy;
+}
+
+//The other arguments have to be evaluated before this, since evaluating them could change the variable
+static struct r_array *get_target(struct parse_node *node, unsigned extra, struct interp_env *env) {
+	if(node->type != PNODE_VAR)
+		return NULL;
+	
+	struct r_val *var = int_env_get_mut(env, node->str);
+	if(var == NULL || var->type != TYPE_ARRAY)
+		return NULL;
+	
+	var->array_v = make_writable(var->array_v, extra);
+	return var->array_v;
+}
+
+#define LEN_RESULT(array) ((struct r_val) { .type = TYPE_INT, .int_v = (array)->len })
+
+static void free_vals(struct r_val *vals, unsigned n) {
+	for(unsigned i = 0; i < n; i++)
+		int_decr_refcount(vals[i]);
+	s_dealloc(vals);
+}
+
+//(push @array item ...) appends the items
+DECL_OP(push) {
+	unsigned n = n_args - 1;
+	struct r_val *vals = NSALLOC(struct r_val, n);
+	for(unsigned i = 0; i < n; i++)
+		vals[i] = int_eval_expr(args[i + 1], env, src_name);
+	
+	struct r_array *array = get_target(args[0], n, env);
+	if(array == NULL) {
+		free_vals(vals, n);
+		return (struct r_val) { .type = TYPE_NULL };
+	}
+	
+	memcpy(array->items + array->len, vals, sizeof(struct r_val) * n);
+	array->len += n;
+	s_dealloc(vals);
+	
+	return LEN_RESULT(array);
+}
+
+//(extend @array array ...) appends the items of the other arrays
+DECL_OP(extend) {
+	unsigned n = n_args - 1, n_items = 0;
+	struct r_val *vals = NSALLOC(struct r_val, n);
+	for(unsigned i = 0; i < n; i++) {
+		vals[i] = int_eval_expr(args[i + 1], env, src_name);
+		if(vals[i].type != TYPE_ARRAY) {
+			free_vals(vals, i + 1);
+			return (struct r_val) { .type = TYPE_NULL };
+		}
+		n_items += vals[i].array_v->len;
+	}
+	
+	struct r_array *array = get_target(args[0], n_items, env);
+	if(array == NULL) {
+		free_vals(vals, n);
+		return (struct r_val) { .type = TYPE_NULL };
+	}
+	
+	for(unsigned i = 0; i < n; i++) {
+		struct r_array *src = vals[i].array_v;
+		for(unsigned j = 0; j < src->len; j++) {
+			array->items[array->len++] = src->items[j];
+			int_incr_refcount(src->items[j]);
+		}
+	}
+	free_vals(vals, n);
+	
+	return LEN_RESULT(array);
+}
+
+//(insert @array index item ...) inserts the items before index; a negative index counts from the end
+DECL_OP(insert) {
+	struct r_val index = int_eval_expr(args[1], env, src_name);
+	if(index.type != TYPE_INT) {
+		int_decr_refcount(index);
+		return (struct r_val) { .type = TYPE_NULL };
+	}
+	
+	unsigned n = n_args - 2;
+	struct r_val *vals = NSALLOC(struct r_val, n);
+	for(unsigned i = 0; i < n; i++)
+		vals[i] = int_eval_expr(args[i + 2], env, src_name);
+	
+	struct r_array *array = get_target(args[0], n, env);
+	if(array == NULL) {
+		free_vals(vals, n);
+		return (struct r_val) { .type = TYPE_NULL };
+	}
+	
+	r_int i = index.int_v;
+	if(i < 0)
+		i = i + array->len < 0 ? 0 : i + array->len;
+	if(i > array->len)
+		i = array->len;
+	
+	memmove(array->items + i + n, array->items + i, sizeof(struct r_val) * (array->len - i));
+	memcpy(array->items + i, vals, sizeof(struct r_val) * n);
+	array->len += n;
+	s_dealloc(vals);
+	
+	return LEN_RESULT(array);
+}
+
+//(pop @array) removes the last item and evaluates to it
+DECL_OP(pop) {
+	struct r_array *array = get_target(args[0], 0, env);
+	if(array == NULL || array->len == 0)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	return rlib_op_result(array->items[--array->len]);
+}
+
+//(slice array start [len]) a view of len items from start, or of the rest of the array. A negative start counts from the end,
+//and the range is clamped to the array.
+DECL_R_OP(slice) {
+	if(n_args > 3 || args[0].type != TYPE_ARRAY || args[1].type != TYPE_INT || (n_args == 3 && args[2].type != TYPE_INT))
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	r_int len = args[0].array_v->len;
+	
+	r_int start = args[1].int_v;
+	if(start < 0)
+		start = start + len < 0 ? 0 : start + len;
+	if(start > len)
+		start = len;
+	
+	r_int n = n_args == 3 ? args[2].int_v : len - start;
+	if(n < 0)
+		n = 0;
+	if(n > len - start)
+		n = len - start;
+	
+	return (struct r_val) { .type = TYPE_ARRAY, .array_v = int_array_slice(args[0].array_v, start, n) };
+}
+
+static struct rlib_op ops[] = {
+	DEF_OP(push, "push", -3),
+	DEF_OP(pop, "pop", 1),
+	DEF_OP(extend, "extend", -3),
+	DEF_OP(insert, "insert", -4),
+	DEF_R_OP(slice, "slice", -3)
+};
+
+static char loaded = 0;
+
+void rlib_array_load() {
+	if(loaded)
+		return;
+	
+	loaded = 1;
+	LOAD_RLIB(ops);
+}
+
+void rlib_array_put(struct interp_env *env) {
+	PUT_RLIB(ops, env);
+}
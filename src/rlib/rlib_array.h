@@ -0,0 +1,10 @@
+#ifndef RLIB_ARRAY_H_INCLUDED
+#define RLIB_ARRAY_H_INCLUDED
+
+#include "../interpreter/interpreter.h"
+
+void rlib_array_load();
+
+void rlib_array_put(struct interp_env *env);
+
+#endif
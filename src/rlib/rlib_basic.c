@@ -6,12 +6,19 @@
 #include <string.h>
 #include <errno.h>
 
+#include "rlib_intvec.h"
+
+#include "../interpreter/interpreter_iter.h"
+#include "../interpreter/interpreter_range.h"
+#include "../interpreter/interpreter_pvec.h"
+
 #include "../interpreter/interpreter_config.h"
 #include "../interpreter/interpreter_utils.h"
 
 #include "../parser/parser_fmt.h"
 
 #include <stdlib.h>
+#include <limits.h>
 
 DECL_OP(let) {
 	S_ASSERT(n_args == 2);
@@ -32,6 +39,16 @@ DECL_OP(let) {
 	return assign_val;
 }
 
+//Once a packed int array turns up, the remaining operands are applied to it element-wise
+static struct r_val arith_rest(enum intvec_op op, struct r_val acc, struct parse_node **args, unsigned n_args, struct interp_env *env, const char *src_name) {
+	for(unsigned i = 0; i < n_args && acc.type != TYPE_NULL; i++)
+		acc = rlib_intvec_arith(op, acc, int_eval_expr(args[i], env, src_name));
+	
+	return rlib_op_result(acc);
+}
+
+#define INT_VAL(v) ((struct r_val) { .type = TYPE_INT, .int_v = (v) })
+
 DECL_OP(add) {
 	r_int int_sum = 0;
 	
@@ -40,6 +57,8 @@ DECL_OP(add) {
 		
 		if(arg_v.type == TYPE_INT)
 			int_sum += arg_v.int_v;
+		else if(arg_v.type == TYPE_INTVEC)
+			return arith_rest(INTVEC_ADD, rlib_intvec_arith(INTVEC_ADD, INT_VAL(int_sum), arg_v), args + i + 1, n_args - i - 1, env, src_name);
 		else {
 			int_decr_refcount(arg_v);
 			return (struct r_val) { .type = TYPE_NULL };
@@ -57,7 +76,7 @@ DECL_OP(print) {
 	
 	for(unsigned i = 0; i < n_args; i++) {
 		
-		struct r_val val = int_eval_expr(args[i], env, src_name);
+		struct r_val val = int_iter_force(int_eval_expr(args[i], env, src_name), env, src_name);
 		fmt_print_r_val(to_file, val);
 		int_decr_refcount(val);
 		
@@ -88,6 +107,13 @@ DECL_OP(sub) {
 	r_int int_diff;
 	
 	struct r_val first = int_eval_expr(args[0], env, src_name);
+	
+	if(first.type == TYPE_INTVEC) {
+		if(n_args == 1)
+			return rlib_op_result(rlib_intvec_arith(INTVEC_SUB, INT_VAL(0), first));
+		return arith_rest(INTVEC_SUB, first, args + 1, n_args - 1, env, src_name);
+	}
+	
 	int_decr_refcount(first);
 	
 	if(first.type != TYPE_INT)
@@ -103,6 +129,8 @@ DECL_OP(sub) {
 		
 		if(val.type == TYPE_INT) {
 			int_diff -= val.int_v;
+		} else if(val.type == TYPE_INTVEC) {
+			return arith_rest(INTVEC_SUB, rlib_intvec_arith(INTVEC_SUB, INT_VAL(int_diff), val), args + i + 1, n_args - i - 1, env, src_name);
 		} else {
 			int_decr_refcount(val);
 			return (struct r_val) { .type = TYPE_NULL };
@@ -120,6 +148,8 @@ DECL_OP(mul) {
 
 		if(val.type == TYPE_INT)
 			int_prod *= val.int_v;
+		else if(val.type == TYPE_INTVEC)
+			return arith_rest(INTVEC_MUL, rlib_intvec_arith(INTVEC_MUL, INT_VAL(int_prod), val), args + i + 1, n_args - i - 1, env, src_name);
 		else {
 			int_decr_refcount(val);
 			return (struct r_val) { .type = TYPE_NULL };
@@ -158,45 +188,160 @@ DECL_OP(div) {
 	return (struct r_val) { .type = TYPE_INT, .int_v = int_res };
 }
 
-DECL_OP(printf) {
-	struct r_val fstr = int_eval_expr(args[0], env, src_name);
+/*
+ * Format strings are compiled into a list of literal runs and argument references. Literal format strings are
+ * cached by their parse node, together with a copy of the text since parse nodes are reused once the prompt
+ * frees a line.
+ */
+
+enum {
+	FMT_SEG_LITERAL,
+	FMT_SEG_ARG,
+	FMT_SEG_NEWLINE
+};
+
+struct fmt_segment {
+	unsigned char kind, arg;
+	unsigned start, len;
+};
+
+struct compiled_fmt {
+	const struct parse_node *node;
+	char *text;
+	unsigned text_len;
 	
-	struct r_val *arg_v = NSALLOC(struct r_val, n_args - 1);
+	struct fmt_segment *segs;
+	unsigned n_segs;
+};
+
+#define FMT_CACHE_SIZE 64
+
+static struct compiled_fmt fmt_cache[FMT_CACHE_SIZE];
+
+static void compile_fmt(struct compiled_fmt *fmt, const char *str, unsigned len) {
+	struct { struct fmt_segment *items; unsigned len, cap; } segs = { .len = 0, .cap = 4 };
+	segs.items = NSALLOC(struct fmt_segment, segs.cap);
 	
-	for(unsigned i = 0; i < n_args - 1; i++) {
-		arg_v[i] = int_eval_expr(args[i + 1], env, src_name);
+	unsigned lit_start = 0;
+	for(unsigned i = 0; i <= len; i++) {
+		if(i < len && str[i] != '%')
+			continue;
+		
+		if(segs.len + 2 > segs.cap) {
+			segs.cap += 1;
+			segs.cap *= 2;
+			segs.items = SREALLOC(struct fmt_segment, segs.items, segs.cap);
+		}
+		
+		if(i != lit_start)
+			segs.items[segs.len++] = (struct fmt_segment) { .kind = FMT_SEG_LITERAL, .start = lit_start, .len = i - lit_start };
+		
+		if(++i >= len) {
+			if(i == len) //A lone '%' at the end is kept as it is
+				segs.items[segs.len++] = (struct fmt_segment) { .kind = FMT_SEG_LITERAL, .start = len - 1, .len = 1 };
+			break;
+		}
+		
+		if(str[i] >= '0' && str[i] <= '9')
+			segs.items[segs.len++] = (struct fmt_segment) { .kind = FMT_SEG_ARG, .arg = str[i] - '0' };
+		else if(str[i] == 'n')
+			segs.items[segs.len++] = (struct fmt_segment) { .kind = FMT_SEG_NEWLINE };
+		
+		lit_start = i + 1;
 	}
 	
-	if(fstr.type != TYPE_STR)
-		goto EXIT;
+	fmt->segs = segs.items;
+	fmt->n_segs = segs.len;
+}
+
+static void free_compiled_fmt(struct compiled_fmt *fmt) {
+	s_dealloc(fmt->text);
+	s_dealloc(fmt->segs);
+}
+
+static const struct compiled_fmt *get_cached_fmt(const struct parse_node *node, const struct r_string *str) {
+	struct compiled_fmt *fmt = &fmt_cache[hash_bytes(&node, sizeof(node), 0) % FMT_CACHE_SIZE];
+	
+	if(fmt->node == node && fmt->text_len == str->len && memcmp(fmt->text, str->str, str->len) == 0)
+		return fmt;
 	
-	FILE *to_file = int_get_stdout(env);
+	if(fmt->node != NULL)
+		free_compiled_fmt(fmt);
 	
-	const char *buff = fstr.str_v->str;
-	for(const char *c = fstr.str_v->str, *end = fstr.str_v->str + fstr.str_v->len; c < end; c++) {
-		if(*c == '%') {
-			if(buff != c) {
-				print_len_str(to_file, buff, c - buff);
-			}
-			c++;
-			if(c == end)
+	fmt->node = node;
+	fmt->text_len = str->len;
+	fmt->text = s_alloc(str->len);
+	memcpy(fmt->text, str->str, str->len);
+	compile_fmt(fmt, fmt->text, fmt->text_len);
+	
+	return fmt;
+}
+
+//Sizes the output exactly, then renders it in one pass
+static struct r_string *render_fmt(const struct compiled_fmt *fmt, const char *text, struct r_val *arg_v, unsigned n_arg_v) {
+	size_t len = 0;
+	for(unsigned i = 0; i < fmt->n_segs; i++) {
+		const struct fmt_segment *seg = &fmt->segs[i];
+		switch(seg->kind) {
+			case FMT_SEG_LITERAL:
+				len += seg->len;
+				break;
+			case FMT_SEG_ARG:
+				if(seg->arg < n_arg_v)
+					len += fmt_r_val_len(arg_v[seg->arg]);
+				break;
+			case FMT_SEG_NEWLINE:
+				len++;
 				break;
-			int arg = *c - '0';
-			if(arg < n_args - 1 && arg >= 0) {
-				fmt_print_r_val(to_file, arg_v[arg]);
-			} else if(*c == 'n') {
-				putchar('\n');
-			}
-			
-			buff = c + 1;
 		}
 	}
 	
-	if(buff < fstr.str_v->str + fstr.str_v->len) {
-		print_len_str(to_file, buff, fstr.str_v->len - (buff - fstr.str_v->str));
+	struct r_string *res = int_new_string(NULL, len);
+	char *top = res->data;
+	
+	for(unsigned i = 0; i < fmt->n_segs; i++) {
+		const struct fmt_segment *seg = &fmt->segs[i];
+		switch(seg->kind) {
+			case FMT_SEG_LITERAL:
+				memcpy(top, text + seg->start, seg->len);
+				top += seg->len;
+				break;
+			case FMT_SEG_ARG:
+				if(seg->arg < n_arg_v)
+					top = fmt_write_r_val(top, arg_v[seg->arg]);
+				break;
+			case FMT_SEG_NEWLINE:
+				*(top++) = '\n';
+				break;
+		}
+	}
+	
+	return res;
+}
+
+//NULL if the format isn't a string
+static struct r_string *eval_format(struct parse_node **args, unsigned n_args, struct interp_env *env, const char *src_name) {
+	struct r_val fstr = int_eval_expr(args[0], env, src_name);
+	
+	struct r_val *arg_v = NSALLOC(struct r_val, n_args - 1);
+	
+	for(unsigned i = 0; i < n_args - 1; i++) {
+		arg_v[i] = int_eval_expr(args[i + 1], env, src_name);
 	}
 	
-	EXIT:
+	struct r_string *res = NULL;
+	
+	if(fstr.type == TYPE_STR) {
+		if(args[0]->type == PNODE_SYM) {
+			const struct compiled_fmt *fmt = get_cached_fmt(args[0], fstr.str_v);
+			res = render_fmt(fmt, fmt->text, arg_v, n_args - 1);
+		} else {
+			struct compiled_fmt fmt;
+			compile_fmt(&fmt, fstr.str_v->str, fstr.str_v->len);
+			res = render_fmt(&fmt, fstr.str_v->str, arg_v, n_args - 1);
+			s_dealloc(fmt.segs);
+		}
+	}
 	
 	for(unsigned i = 0; i < n_args - 1; i++)
 		int_decr_refcount(arg_v[i]);
@@ -204,6 +349,25 @@ DECL_OP(printf) {
 	s_dealloc(arg_v);
 	
 	int_decr_refcount(fstr);
+	return res;
+}
+
+DECL_OP(format) {
+	struct r_string *res = eval_format(args, n_args, env, src_name);
+	if(res == NULL)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	return rlib_op_result((struct r_val) { .type = TYPE_STR, .str_v = res });
+}
+
+DECL_OP(printf) {
+	struct r_string *res = eval_format(args, n_args, env, src_name);
+	if(res == NULL)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	print_len_str(int_get_stdout(env), res->str, res->len);
+	
+	int_decr_refcount((struct r_val) { .type = TYPE_STR, .str_v = res });
 	return (struct r_val) { .type = TYPE_NULL };
 }
 
@@ -236,7 +400,21 @@ DECL_OP(if) {
 	}
 }
 
+//With a packed int array on either side, (< a b), (> a b) and (= a b) compare item by item and give a mask
+static bool is_mask_compare(struct r_val *args, unsigned n_args) {
+	return n_args == 2 && (args[0].type == TYPE_INTVEC || args[1].type == TYPE_INTVEC);
+}
+
+static struct r_val compare_mask(enum intvec_op op, struct r_val *args) {
+	int_incr_refcount(args[0]);
+	int_incr_refcount(args[1]);
+	return rlib_intvec_arith(op, args[0], args[1]);
+}
+
 DECL_R_OP(eq) {
+	if(is_mask_compare(args, n_args))
+		return compare_mask(INTVEC_EQ, args);
+	
 	for(unsigned i = 1; i < n_args; i++) {
 		if(!cmp_r_vals(args[0], args[i]))
 			return (struct r_val) { .type = TYPE_INT, .int_v = 0 };
@@ -246,6 +424,9 @@ DECL_R_OP(eq) {
 }
 
 DECL_R_OP(less) {
+	if(is_mask_compare(args, n_args))
+		return compare_mask(INTVEC_LESS, args);
+	
 	for(unsigned i = 1; i < n_args; i++) {
 		if(!r_vals_less(args[i-1], args[i]))
 			return (struct r_val) { .type = TYPE_INT, .int_v = 0 };
@@ -255,6 +436,9 @@ DECL_R_OP(less) {
 }
 
 DECL_R_OP(greater) {
+	if(is_mask_compare(args, n_args))
+		return compare_mask(INTVEC_GREATER, args);
+	
 	for(unsigned i = 1; i < n_args; i++) {
 		if(!r_vals_greater(args[i-1], args[i]))
 			return (struct r_val) { .type = TYPE_INT, .int_v = 0 };
@@ -273,10 +457,86 @@ DECL_OP(do) {
 	return val;
 }
 
+//Takes over the reference to val
+static void set_slot(struct r_val *slot, struct r_val val) {
+	int_decr_refcount(*slot);
+	*slot = val;
+}
+
+//(for name collection body) evaluates body with the variable set to each item in turn. The variable's slot is looked up
+//once and written directly by every step, and a range is counted through by adding its step, so looping over one
+//costs no allocation or lookup per item.
+DECL_OP(for) {
+	if(args[0]->type != PNODE_SYM) {
+		fmt_blame_parse_node(int_get_errout(env), "Expected symbol as variable name, got %.", args[0], get_static_src(), src_name);
+		return (struct r_val) { .type = TYPE_NULL };
+	}
+	
+	struct r_val coll = int_eval_expr(args[1], env, src_name);
+	
+	if(coll.type != TYPE_RANGE && coll.type != TYPE_INTVEC && coll.type != TYPE_ARRAY && coll.type != TYPE_PVEC && coll.type != TYPE_ITER) {
+		fmt_blame_parse_node(int_get_errout(env), "Expected an array, pvec, packed int array, range or iterator to loop over, got %.", args[1], get_static_src(), src_name);
+		int_decr_refcount(coll);
+		return (struct r_val) { .type = TYPE_NULL };
+	}
+	
+	if(int_env_set(env, args[0]->str, (struct r_val) { .type = TYPE_NULL }, 1, 0) != 1) {
+		int_decr_refcount(coll);
+		return (struct r_val) { .type = TYPE_NULL };
+	}
+	struct r_val *slot = int_env_get_mut(env, args[0]->str);
+	
+	switch(coll.type) {
+		case TYPE_RANGE: {
+			r_int next = coll.range_v->start;
+			for(unsigned long long i = 0; i < coll.range_v->len && !int_interrupted(); i++) {
+				set_slot(slot, INT_VAL(next));
+				int_decr_refcount(int_eval_expr(args[2], env, src_name));
+				next = (r_int) ((unsigned long long) next + coll.range_v->step);
+			}
+		} break;
+		
+		case TYPE_INTVEC:
+			for(unsigned i = 0; i < coll.intvec_v->len && !int_interrupted(); i++) {
+				set_slot(slot, INT_VAL(coll.intvec_v->items[i]));
+				int_decr_refcount(int_eval_expr(args[2], env, src_name));
+			}
+			break;
+		
+		case TYPE_ARRAY:
+			for(unsigned i = 0; i < coll.array_v->len && !int_interrupted(); i++) {
+				int_incr_refcount(coll.array_v->items[i]);
+				set_slot(slot, coll.array_v->items[i]);
+				int_decr_refcount(int_eval_expr(args[2], env, src_name));
+			}
+			break;
+		
+		case TYPE_PVEC:
+			for(unsigned i = 0; i < coll.pvec_v->len && !int_interrupted(); i++) {
+				struct r_val item = int_pvec_get(coll.pvec_v, i);
+				int_incr_refcount(item);
+				set_slot(slot, item);
+				int_decr_refcount(int_eval_expr(args[2], env, src_name));
+			}
+			break;
+		
+		case TYPE_ITER: {
+			struct iter_cursor *cursor = int_iter_start(coll.iter_v);
+			struct r_val item;
+			while(int_iter_next(cursor, &item, env, src_name)) {
+				set_slot(slot, item);
+				int_decr_refcount(int_eval_expr(args[2], env, src_name));
+			}
+			int_iter_end(cursor);
+		} break;
+	}
+	
+	int_decr_refcount(coll);
+	return (struct r_val) { .type = TYPE_NULL };
+}
+
 DECL_R_OP(array) {
-	struct r_array *array = s_alloc(sizeof(struct r_array) + sizeof(struct r_val) * n_args);
-	array->len = n_args;
-	array->ref_c = 1;
+	struct r_array *array = int_new_array(n_args);
 	
 	for(unsigned i = 0; i < n_args; i++) {
 		int_incr_refcount(args[i]);
@@ -286,50 +546,148 @@ DECL_R_OP(array) {
 	return (struct r_val) { .type = TYPE_ARRAY, .array_v = array };
 }
 
+//The ints of a packed array, or of a range when items is NULL, which are worked out by adding step rather than stored
+struct int_seq {
+	const r_int *items;
+	r_int start, step;
+	unsigned len;
+};
+
+static struct int_seq int_seq_of(struct r_val val) {
+	if(val.type == TYPE_RANGE)
+		return (struct int_seq) { .items = NULL, .start = val.range_v->start, .step = val.range_v->step, .len = val.range_v->len };
+	
+	return (struct int_seq) { .items = val.intvec_v->items, .len = val.intvec_v->len };
+}
+
+//The results stay packed for as long as they are all ints
+static struct r_val map_ints(struct int_seq src, struct r_val fn, struct interp_env *env, const char *src_name) {
+	struct r_intvec *ints = int_new_intvec(src.len);
+	struct r_array *array = NULL;
+	r_int next = src.start;
+	
+	for(unsigned i = 0; i < src.len; i++) {
+		struct r_val res = { .type = TYPE_NULL };
+		struct r_val fn_arg = INT_VAL(src.items != NULL ? src.items[i] : next);
+		next = (r_int) ((unsigned long long) next + src.step);
+		if(!int_interrupted())
+			res = int_call_r_fn(fn, &fn_arg, 1, env, src_name);
+		
+		if(array == NULL && res.type == TYPE_INT) {
+			ints->items[i] = res.int_v;
+			continue;
+		}
+		
+		if(array == NULL) {
+			array = int_new_array(src.len);
+			for(unsigned j = 0; j < i; j++)
+				array->items[j] = INT_VAL(ints->items[j]);
+		}
+		array->items[i] = res;
+	}
+	
+	if(array == NULL)
+		return (struct r_val) { .type = TYPE_INTVEC, .intvec_v = ints };
+	
+	s_dealloc(ints);
+	return (struct r_val) { .type = TYPE_ARRAY, .array_v = array };
+}
+
+static struct r_val filter_ints(struct int_seq src, struct r_val fn, struct interp_env *env, const char *src_name) {
+	struct r_intvec *out = int_new_intvec(src.len);
+	out->len = 0;
+	r_int next = src.start;
+	
+	for(unsigned i = 0; i < src.len && !int_interrupted(); i++) {
+		struct r_val fn_arg = INT_VAL(src.items != NULL ? src.items[i] : next);
+		next = (r_int) ((unsigned long long) next + src.step);
+		struct r_val res = int_call_r_fn(fn, &fn_arg, 1, env, src_name);
+		if(r_val_as_bool(res))
+			out->items[out->len++] = fn_arg.int_v;
+		int_decr_refcount(res);
+	}
+	
+	return (struct r_val) { .type = TYPE_INTVEC, .intvec_v = out };
+}
+
 DECL_R_OP(map) { //NOTE TO SELF: Remember that the args array might not remain intact if another function is called via int_call_r_fn or such.
+	if(args[0].type == TYPE_ITER)
+		return (struct r_val) { .type = TYPE_ITER, .iter_v = int_new_iter(ITER_MAP, args[0], args[1], 0) };
+	
+	if(args[0].type == TYPE_INTVEC || (args[0].type == TYPE_RANGE && args[0].range_v->len <= UINT_MAX))
+		return map_ints(int_seq_of(args[0]), args[1], env, src_name);
+	
 	if(args[0].type != TYPE_ARRAY)
 		return (struct r_val) { .type = TYPE_NULL };
 	
 	struct r_array *src_array = args[0].array_v;
 	struct r_val fn = args[1];
 	
-	struct r_array *array = s_alloc(sizeof(struct r_array) + sizeof(struct r_val) * src_array->len);
-	array->len = src_array->len;
-	array->ref_c = 1;
+	//A temporary array gets the results written over its items
+	bool in_place = rlib_is_unique(args[0]);
+	struct r_array *array = in_place ? src_array : int_new_array(src_array->len);
 	
 	for(unsigned i = 0; i < array->len; i++) {
+		struct r_val res = { .type = TYPE_NULL }; //The remaining items are left as Null after an interrupt
 		struct r_val fn_arg = src_array->items[i];
-		struct r_val res = int_call_r_fn(fn, &fn_arg, 1, env, src_name);
+		if(!int_interrupted())
+			res = int_call_r_fn(fn, &fn_arg, 1, env, src_name);
+		
+		if(in_place)
+			int_decr_refcount(fn_arg);
 		array->items[i] = res;
 	}
 	
+	if(in_place)
+		array->ref_c++;
+	
 	return (struct r_val) { .type = TYPE_ARRAY, .array_v = array };
 }
 
 DECL_R_OP(filter) {
+	if(args[0].type == TYPE_ITER)
+		return (struct r_val) { .type = TYPE_ITER, .iter_v = int_new_iter(ITER_FILTER, args[0], args[1], 0) };
+	
+	if(args[0].type == TYPE_INTVEC || (args[0].type == TYPE_RANGE && args[0].range_v->len <= UINT_MAX))
+		return filter_ints(int_seq_of(args[0]), args[1], env, src_name);
+	
 	if(args[0].type != TYPE_ARRAY)
 		return (struct r_val) { .type = TYPE_NULL };
 	
 	struct r_array *src_array = args[0].array_v;
-	struct r_val *buffer = s_alloc(sizeof(struct r_val) * src_array->len);
-	unsigned n_out = 0;
-	
 	struct r_val fn = args[1];
 	
-	for(int i = 0; i < src_array->len; i++) {
+	//A temporary array is compacted in place, otherwise the kept items are collected in a buffer
+	bool in_place = rlib_is_unique(args[0]);
+	struct r_val *buffer = in_place ? src_array->items : s_alloc(sizeof(struct r_val) * src_array->len);
+	unsigned n_out = 0;
+	
+	unsigned i;
+	for(i = 0; i < src_array->len && !int_interrupted(); i++) {
 		struct r_val fn_arg = src_array->items[i];
 		struct r_val res = int_call_r_fn(fn, &fn_arg, 1, env, src_name);
-		if(r_val_as_bool(res)) {
+		bool keep = r_val_as_bool(res);
+		int_decr_refcount(res);
+		
+		if(keep) {
 			buffer[n_out++] = fn_arg;
-			int_incr_refcount(fn_arg);
+			if(!in_place)
+				int_incr_refcount(fn_arg);
+		} else if(in_place) {
+			int_decr_refcount(fn_arg);
 		}
-		int_decr_refcount(res);
 	}
 	
-	struct r_array *out_array = s_alloc(sizeof(struct r_array) + sizeof(struct r_val) * n_out);
-	out_array->len = n_out;
-	out_array->ref_c = 1;
+	if(in_place) {
+		for(; i < src_array->len; i++)
+			int_decr_refcount(src_array->items[i]);
+		
+		src_array->len = n_out;
+		src_array->ref_c++;
+		return (struct r_val) { .type = TYPE_ARRAY, .array_v = src_array };
+	}
 	
+	struct r_array *out_array = int_new_array(n_out);
 	memcpy(out_array->items, buffer, sizeof(struct r_val) * n_out);
 	
 	s_dealloc(buffer);
@@ -440,36 +798,9 @@ DECL_R_OP(readline) {
 	}
 	//int_decr_refcount(args[0]);
 	
-	char *buff, *end, *top;
-	buff = s_alloc(8);
-	top = buff;
-	end = buff + 8;
-	
-	int res;
-	while( (res = fgetc(from_file)) != EOF) {
-		if(res == '\n')
-			break;
-		
-		if(top == end) {
-			size_t cap = end - buff;
-			buff = s_realloc(buff, cap * 2);
-			end = buff + cap * 2;
-			top = buff + cap;
-		}
-		*(top++) = res;
-	}
-	if(res == EOF && top == buff) { //If nothing was read from the file/stream and an end of file was returned
-		s_dealloc(buff);
+	struct r_string *str = read_r_string_line(from_file);
+	if(str == NULL)
 		return (struct r_val) { .type = TYPE_NULL };
-	}
-	
-	unsigned len = top - buff;
-	struct r_string *str = s_alloc(sizeof(struct r_string) + len);
-	memcpy((char *) str->str, buff, len);
-	s_dealloc(buff);
-	
-	str->len = len;
-	str->ref_c = 1;
 	
 	return (struct r_val) { .type = TYPE_STR, .str_v = str };
 }
@@ -482,11 +813,7 @@ static int record_dir_file_entry(const char *path, const struct stat *sb, int ty
 	if(typeflag != FTW_F)
 		return 0;
 	
-	unsigned str_len = strlen(path);
-	struct r_string *path_str = s_alloc(sizeof(struct r_string) + str_len);
-	path_str->len = str_len;
-	path_str->ref_c = 1;
-	memcpy( (char *) path_str->str, path, str_len);
+	struct r_string *path_str = int_new_string(path, strlen(path));
 	
 	if(file_paths.len == file_paths.cap) {
 		file_paths.cap *= 2;
@@ -513,9 +840,7 @@ DECL_R_OP(indir) {
 	if(ftw(dir_path, record_dir_file_entry, 8) == -1)
 		goto ERR;
 	
-	struct r_array *array = s_alloc(sizeof(struct r_array) + sizeof(struct r_val) * file_paths.len);
-	array->len = file_paths.len;
-	array->ref_c = 1;
+	struct r_array *array = int_new_array(file_paths.len);
 	for(unsigned i = 0; i < array->len; i++) {
 		array->items[i] = (struct r_val) { .type = TYPE_STR, .str_v = file_paths.paths[i] };
 	}
@@ -548,11 +873,7 @@ DECL_R_OP(getenv) {
 	if(val == NULL)
 		return (struct r_val) { .type = TYPE_NULL };
 	
-	unsigned val_len = strlen(val);
-	struct r_string *str_res = s_alloc(sizeof(struct r_string) + val_len);
-	str_res->len = val_len;
-	memcpy( (char *) str_res->str, val, val_len);
-	str_res->ref_c = 1;
+	struct r_string *str_res = int_new_string(val, strlen(val));
 	
 	return (struct r_val) { .type = TYPE_STR, .str_v = str_res };
 }
@@ -579,7 +900,28 @@ DECL_R_OP(setenv) {
 	return args[1];
 }
 
+static struct r_val index_ints(struct r_intvec *vec, r_int i) {
+	if(i < -(r_int) vec->len || i >= (r_int) vec->len)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	return INT_VAL(vec->items[i < 0 ? vec->len + i : i]);
+}
+
+static struct r_val index_range(struct r_range *range, r_int i) {
+	unsigned long long pos = i < 0 ? range->len - -(unsigned long long) i : (unsigned long long) i;
+	if(pos >= range->len) //Also catches negative indices past the start, which wrap around to large ones
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	return INT_VAL(int_range_get(range, pos));
+}
+
 DECL_R_OP(index) {
+	if(args[0].type == TYPE_INTVEC && args[1].type == TYPE_INT)
+		return index_ints(args[0].intvec_v, args[1].int_v);
+	
+	if(args[0].type == TYPE_RANGE && args[1].type == TYPE_INT)
+		return index_range(args[0].range_v, args[1].int_v);
+	
 	if(args[0].type != TYPE_ARRAY || args[1].type != TYPE_INT)
 		return (struct r_val) { .type = TYPE_NULL };
 	
@@ -593,6 +935,7 @@ DECL_R_OP(index) {
 		i = (a->len + i) % a->len; //I.e index -1 is the same as len - 1
 	}
 	S_ASSERT(i >= 0 && i < a->len);
+	int_incr_refcount(a->items[i]);
 	return a->items[i];
 }
 
@@ -614,6 +957,7 @@ static struct rlib_op ops[] = { //TODO: Change +, print, -, *, / and printf to b
 	DEF_R_OP(cd, "cd", 1),
 	
 	DEF_OP(printf, "printf", -2),
+	DEF_OP(format, "format", -2),
 	
 	DEF_OP(if, "if", -3),
 	
@@ -622,6 +966,7 @@ static struct rlib_op ops[] = { //TODO: Change +, print, -, *, / and printf to b
 	DEF_R_OP(greater, ">", -3),
 	
 	DEF_OP(do, "do", -1),
+	DEF_OP(for, "for", 3),
 	
 	DEF_R_OP(array, "array", -1),
 	DEF_R_OP(map, "map", 2),
@@ -652,3 +997,23 @@ void rlib_basic_load() {
 void rlib_basic_put(struct interp_env *env) {
 	PUT_RLIB(ops, env);
 }
+
+int rlib_basic_arith_op(struct r_val fn) {
+	if(fn.type != TYPE_EXT_FN)
+		return -1;
+	
+	for(unsigned i = 0; i < sizeof(ops) / sizeof(ops[0]); i++) {
+		if(!ops[i].loaded || ops[i].type != 0 || ops[i].fn_v.ext_fn != fn.ext_fn)
+			continue;
+		
+		if(ops[i].fn == add_rlib_callback)
+			return INTVEC_ADD;
+		if(ops[i].fn == sub_rlib_callback)
+			return INTVEC_SUB;
+		if(ops[i].fn == mul_rlib_callback)
+			return INTVEC_MUL;
+		return -1;
+	}
+	
+	return -1;
+}
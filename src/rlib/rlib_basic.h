@@ -7,6 +7,10 @@ void rlib_basic_load();
 
 void rlib_basic_put(struct interp_env *env);
 
+//+, - and * can't be called with values through int_call_r_fn; this gives the enum intvec_op that fn stands for so that
+//callers can apply it themselves, or -1 if fn isn't one of them
+int rlib_basic_arith_op(struct r_val fn);
+
 //void rlib_basic_lambda
 
 #endif
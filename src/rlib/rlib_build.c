@@ -0,0 +1,455 @@
+#include "rlib_build.h"
+
+#include "rlib.h"
+
+#include "../proj_utils.h"
+#include "../interpreter/interpreter_config.h"
+#include "../interpreter/interpreter_fmt.h"
+
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+/*
+(build jobs rules goals...) brings the goals (or every target, if none are given) up to date, like make. Each rule is an array of
+a target path, an array of dependency paths and a function that is called as (fn target deps) to rebuild the target.
+
+A target is out of date if it doesn't exist, if any of its dependencies is newer or if any dependency was rebuilt during this run.
+Out of date targets are scheduled from a ready queue as soon as all of their dependencies are done, with up to jobs of them
+running at once (0 means one per online cpu, and no more than MAX_BUILD_JOBS are run either way). Every rule runs in a forked
+copy of the interpreter and fails if any external command it runs fails. After the first failure nothing new is started, and
+build evaluates to 0 once the running rules are done; on success it evaluates to 1.
+*/
+
+#define MAX_BUILD_JOBS 256
+
+struct build_rule {
+	struct r_string *target;
+	struct r_val *deps;
+	unsigned n_deps;
+	struct r_val fn;
+	
+	struct { unsigned *items; unsigned len, cap; } dependents;
+	unsigned n_waiting; //Dependencies with rules that aren't done yet
+	
+	enum { VISIT_NONE, VISIT_ACTIVE, VISIT_DONE } visit;
+	bool needed, rebuilt;
+	
+	pid_t pid;
+	int done_fd; //Read end of a pipe that the rules process holds the write end of; it hangs up once the process exits
+};
+
+struct build_graph {
+	struct build_rule *rules;
+	unsigned n;
+	
+	//Open addressing table from target to rule index + 1 (0 marks an empty slot)
+	unsigned *index;
+	unsigned index_cap;
+};
+
+static unsigned long long target_hash(const char *str, unsigned len) {
+	return hash_bytes(str, len, 0);
+}
+
+static int find_rule(struct build_graph *graph, const char *str, unsigned len) {
+	unsigned mask = graph->index_cap - 1;
+	for(unsigned i = target_hash(str, len) & mask; graph->index[i] != 0; i = (i + 1) & mask) {
+		struct r_string *target = graph->rules[graph->index[i] - 1].target;
+		if(cmp_len_strs(target->str, target->len, str, len))
+			return graph->index[i] - 1;
+	}
+	
+	return -1;
+}
+
+static bool index_rule(struct build_graph *graph, unsigned rule_i) {
+	struct r_string *target = graph->rules[rule_i].target;
+	if(find_rule(graph, target->str, target->len) != -1)
+		return false;
+	
+	unsigned mask = graph->index_cap - 1;
+	unsigned i = target_hash(target->str, target->len) & mask;
+	while(graph->index[i] != 0)
+		i = (i + 1) & mask;
+	
+	graph->index[i] = rule_i + 1;
+	return true;
+}
+
+static void free_build_graph(struct build_graph *graph) {
+	for(unsigned i = 0; i < graph->n; i++)
+		s_dealloc(graph->rules[i].dependents.items);
+	
+	s_dealloc(graph->rules);
+	s_dealloc(graph->index);
+}
+
+static void add_dependent(struct build_rule *rule, unsigned dependent) {
+	if(rule->dependents.len == rule->dependents.cap) {
+		rule->dependents.cap += 1;
+		rule->dependents.cap *= 2;
+		rule->dependents.items = SREALLOC(unsigned, rule->dependents.items, rule->dependents.cap);
+	}
+	
+	rule->dependents.items[rule->dependents.len++] = dependent;
+}
+
+static bool read_rule(struct build_rule *rule, struct r_val v) {
+	if(v.type != TYPE_ARRAY || v.array_v->len != 3)
+		return false;
+	
+	struct r_val *fields = v.array_v->items;
+	if(fields[0].type != TYPE_STR || (fields[2].type != TYPE_FN && fields[2].type != TYPE_EXT_FN))
+		return false;
+	
+	*rule = (struct build_rule) { .target = fields[0].str_v, .fn = fields[2], .pid = -1, .done_fd = -1 };
+	
+	if(fields[1].type == TYPE_STR) {
+		rule->deps = &fields[1];
+		rule->n_deps = 1;
+	} else if(fields[1].type == TYPE_ARRAY) {
+		rule->deps = fields[1].array_v->items;
+		rule->n_deps = fields[1].array_v->len;
+		for(unsigned i = 0; i < rule->n_deps; i++) {
+			if(rule->deps[i].type != TYPE_STR)
+				return false;
+		}
+	} else {
+		return false;
+	}
+	
+	return true;
+}
+
+//Marks the rule and everything it depends on as needed; false if there is a dependency cycle
+static bool mark_needed(struct build_graph *graph, unsigned rule_i, FILE *err) {
+	struct build_rule *rule = &graph->rules[rule_i];
+	
+	if(rule->visit == VISIT_DONE)
+		return true;
+	
+	if(rule->visit == VISIT_ACTIVE) {
+		fputs("build: dependency cycle through '", err);
+		print_len_str(err, rule->target->str, rule->target->len);
+		fputs("'\n", err);
+		return false;
+	}
+	
+	rule->visit = VISIT_ACTIVE;
+	rule->needed = true;
+	
+	for(unsigned i = 0; i < rule->n_deps; i++) {
+		struct r_string *dep = rule->deps[i].str_v;
+		int dep_i = find_rule(graph, dep->str, dep->len);
+		if(dep_i == -1)
+			continue;
+		
+		if(!mark_needed(graph, dep_i, err))
+			return false;
+		
+		rule->n_waiting++;
+		add_dependent(&graph->rules[dep_i], rule_i);
+	}
+	
+	rule->visit = VISIT_DONE;
+	return true;
+}
+
+static bool stat_path(struct r_string *path, struct stat *st) {
+	char *c_path = r_string_to_cstr(path);
+	int res = stat(c_path, st);
+	s_dealloc(c_path);
+	return res == 0;
+}
+
+static bool newer(const struct stat *a, const struct stat *b) {
+	if(a->st_mtim.tv_sec != b->st_mtim.tv_sec)
+		return a->st_mtim.tv_sec > b->st_mtim.tv_sec;
+	return a->st_mtim.tv_nsec > b->st_mtim.tv_nsec;
+}
+
+//1 if the rules target has to be rebuilt, 0 if it is up to date and -1 if a dependency is missing
+static int out_of_date(struct build_graph *graph, struct build_rule *rule, FILE *err) {
+	struct stat target_st;
+	bool target_exists = stat_path(rule->target, &target_st);
+	int res = target_exists ? 0 : 1;
+	
+	for(unsigned i = 0; i < rule->n_deps; i++) {
+		struct r_string *dep = rule->deps[i].str_v;
+		int dep_i = find_rule(graph, dep->str, dep->len);
+		
+		if(dep_i != -1 && graph->rules[dep_i].rebuilt)
+			res = 1;
+		
+		struct stat dep_st;
+		if(!stat_path(dep, &dep_st)) {
+			if(dep_i != -1) { //A rule that doesn't produce its target is always considered to have changed
+				res = 1;
+				continue;
+			}
+			
+			fputs("build: no rule to make '", err);
+			print_len_str(err, dep->str, dep->len);
+			fputs("', needed by '", err);
+			print_len_str(err, rule->target->str, rule->target->len);
+			fputs("'\n", err);
+			return -1;
+		}
+		
+		if(target_exists && newer(&dep_st, &target_st))
+			res = 1;
+	}
+	
+	return res;
+}
+
+static int start_rule(struct build_rule *rule, struct interp_env *env, const char *src_name) {
+	int fds[2];
+	if(pipe(fds))
+		return -1;
+	
+	fflush(NULL); //Otherwise anything buffered would be written once by each process
+	
+	pid_t pid = fork();
+	switch(pid) {
+		case -1:
+			close(fds[0]);
+			close(fds[1]);
+			return -1;
+		
+		case 0: {
+			close(fds[0]);
+			fcntl(fds[1], F_SETFD, FD_CLOEXEC); //Commands run by the rule shouldn't keep it open
+			
+			//Several rules may run at once, so none of them can take over the terminal
+			int_set_job_control(false);
+			
+			struct r_array *deps = int_new_array(rule->n_deps);
+			for(unsigned i = 0; i < rule->n_deps; i++) {
+				deps->items[i] = rule->deps[i];
+				int_incr_refcount(deps->items[i]);
+			}
+			struct r_val fn_args[2] = {
+				{ .type = TYPE_STR, .str_v = rule->target },
+				{ .type = TYPE_ARRAY, .array_v = deps }
+			};
+			
+			unsigned long long failed_before = int_count_failed_execs(env);
+			struct r_val res = int_call_r_fn(rule->fn, fn_args, 2, env, src_name);
+			int_decr_refcount(res);
+			
+			bool ok = int_count_failed_execs(env) == failed_before && !int_interrupted();
+			
+			fflush(NULL);
+			_exit(ok ? 0 : 1);
+		}
+		
+		default:
+			close(fds[1]);
+			rule->pid = pid;
+			rule->done_fd = fds[0];
+			return 0;
+	}
+}
+
+static int finish_rule(struct build_rule *rule) {
+	close(rule->done_fd);
+	rule->done_fd = -1;
+	
+	int status;
+	while(waitpid(rule->pid, &status, 0) == -1) {
+		if(errno != EINTR)
+			return -1;
+	}
+	rule->pid = -1;
+	
+	if(WIFEXITED(status))
+		return WEXITSTATUS(status);
+	return -2;
+}
+
+static void rule_done(struct build_graph *graph, struct build_rule *rule, unsigned *queue, unsigned *queue_end) {
+	for(unsigned i = 0; i < rule->dependents.len; i++) {
+		unsigned dependent = rule->dependents.items[i];
+		if(--graph->rules[dependent].n_waiting == 0)
+			queue[(*queue_end)++] = dependent;
+	}
+}
+
+DECL_R_OP(build) {
+	FILE *err = int_get_errout(env);
+	
+	if(args[0].type != TYPE_INT || args[0].int_v < 0 || args[1].type != TYPE_ARRAY) {
+		fputs("build: expected a job count and an array of rules\n", err);
+		return (struct r_val) { .type = TYPE_NULL };
+	}
+	
+	r_int jobs_v = args[0].int_v;
+	if(jobs_v == 0) {
+		long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		jobs_v = n_cpus > 0 ? n_cpus : 1;
+	}
+	unsigned jobs = jobs_v < MAX_BUILD_JOBS ? jobs_v : MAX_BUILD_JOBS; //Sizes the running and poll arrays
+	if(interpreter_get_config()->user_approve_commands) //Approval prompts from several processes would be interleaved
+		jobs = 1;
+	
+	struct r_array *rule_array = args[1].array_v;
+	
+	struct build_graph graph = { .n = rule_array->len };
+	graph.rules = NSALLOC(struct build_rule, graph.n + 1);
+	graph.index_cap = 8;
+	while(graph.index_cap < graph.n * 2)
+		graph.index_cap *= 2;
+	graph.index = NSALLOC(unsigned, graph.index_cap);
+	memset(graph.index, 0, sizeof(unsigned) * graph.index_cap);
+	
+	unsigned *queue = NSALLOC(unsigned, graph.n + 1);
+	unsigned queue_start = 0, queue_end = 0;
+	
+	struct build_rule **running = NSALLOC(struct build_rule *, jobs);
+	struct pollfd *poll_fds = NSALLOC(struct pollfd, jobs);
+	unsigned n_running = 0;
+	
+	bool failed = false;
+	
+	for(unsigned i = 0; i < graph.n; i++) {
+		if(!read_rule(&graph.rules[i], rule_array->items[i])) {
+			fprintf(err, "build: rule %u should be an array of a target, an array of dependencies and a function\n", i);
+			graph.n = i; //Only the rules read so far have anything to free
+			failed = true;
+			goto END;
+		}
+		
+		if(!index_rule(&graph, i)) {
+			fputs("build: more than one rule for '", err);
+			print_len_str(err, graph.rules[i].target->str, graph.rules[i].target->len);
+			fputs("'\n", err);
+			graph.n = i + 1;
+			failed = true;
+			goto END;
+		}
+	}
+	
+	if(n_args == 2) {
+		for(unsigned i = 0; i < graph.n && !failed; i++)
+			failed = !mark_needed(&graph, i, err);
+	} else {
+		for(unsigned i = 2; i < n_args && !failed; i++) {
+			int rule_i = args[i].type == TYPE_STR ? find_rule(&graph, args[i].str_v->str, args[i].str_v->len) : -1;
+			if(rule_i == -1) {
+				fputs("build: no rule for goal '", err);
+				fmt_print_r_val(err, args[i]);
+				fputs("'\n", err);
+				failed = true;
+				break;
+			}
+			failed = !mark_needed(&graph, rule_i, err);
+		}
+	}
+	
+	if(failed)
+		goto END;
+	
+	for(unsigned i = 0; i < graph.n; i++) {
+		if(graph.rules[i].needed && graph.rules[i].n_waiting == 0)
+			queue[queue_end++] = i;
+	}
+	
+	while(true) {
+		while(!failed && n_running < jobs && queue_start < queue_end && !int_interrupted()) {
+			struct build_rule *rule = &graph.rules[queue[queue_start++]];
+			
+			int stale = out_of_date(&graph, rule, err);
+			if(stale == -1) {
+				failed = true;
+				break;
+			}
+			
+			if(!stale) {
+				rule_done(&graph, rule, queue, &queue_end);
+				continue;
+			}
+			
+			if(start_rule(rule, env, src_name)) {
+				fprintf(err, "build: unable to start rule: %s\n", strerror(errno));
+				failed = true;
+				break;
+			}
+			
+			running[n_running++] = rule;
+		}
+		
+		if(n_running == 0)
+			break;
+		
+		for(unsigned i = 0; i < n_running; i++)
+			poll_fds[i] = (struct pollfd) { .fd = running[i]->done_fd, .events = POLLIN };
+		
+		if(poll(poll_fds, n_running, -1) == -1) {
+			if(errno == EINTR)
+				continue;
+			fprintf(err, "build: poll failed: %s\n", strerror(errno));
+			failed = true;
+			break;
+		}
+		
+		//Iterating backwards, since finished rules are removed by moving the last running rule into their place
+		for(unsigned i = n_running; i-- > 0; ) {
+			if(poll_fds[i].revents == 0)
+				continue;
+			
+			struct build_rule *rule = running[i];
+			running[i] = running[--n_running];
+			
+			int status = finish_rule(rule);
+			if(status != 0) {
+				fputs("build: '", err);
+				print_len_str(err, rule->target->str, rule->target->len);
+				fprintf(err, "' failed (%i)\n", status);
+				failed = true;
+				continue;
+			}
+			
+			rule->rebuilt = true;
+			rule_done(&graph, rule, queue, &queue_end);
+		}
+	}
+	
+	for(unsigned i = 0; i < n_running; i++) //Only left over if poll failed
+		finish_rule(running[i]);
+	
+	if(int_interrupted())
+		failed = true;
+	
+	END:
+	
+	s_dealloc(running);
+	s_dealloc(poll_fds);
+	s_dealloc(queue);
+	free_build_graph(&graph);
+	
+	return (struct r_val) { .type = TYPE_INT, .int_v = !failed };
+}
+
+static struct rlib_op ops[] = {
+	DEF_R_OP(build, "build", -3)
+};
+
+static char loaded = 0;
+
+void rlib_build_load() {
+	if(loaded)
+		return;
+	
+	loaded = 1;
+	LOAD_RLIB(ops);
+}
+
+void rlib_build_put(struct interp_env *env) {
+	PUT_RLIB(ops, env);
+}
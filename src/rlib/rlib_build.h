@@ -0,0 +1,10 @@
+#ifndef RLIB_BUILD_H_INCLUDED
+#define RLIB_BUILD_H_INCLUDED
+
+#include "../interpreter/interpreter.h"
+
+void rlib_build_load();
+
+void rlib_build_put(struct interp_env *env);
+
+#endif
@@ -0,0 +1,348 @@
+#include "rlib_fold.h"
+
+#include "rlib.h"
+#include "rlib_basic.h"
+#include "rlib_intvec.h"
+
+#include "../interpreter/interpreter_iter.h"
+#include "../interpreter/interpreter_range.h"
+
+/*
+ * Aggregates over arrays, packed int arrays, ranges and iterators: (reduce coll fn), (fold coll init fn) and sum, count,
+ * min, max, mean, any and all. None of them builds an array of the items, and iterators are read one item at a time.
+ * reduce and fold apply +, - and * themselves instead of calling back into the interpreter, and a sum of a packed array
+ * or range needs no loop over the items at all.
+ */
+
+#define NULL_VAL ((struct r_val) { .type = TYPE_NULL })
+#define INT_VAL(v) ((struct r_val) { .type = TYPE_INT, .int_v = (v) })
+
+struct items {
+	struct r_val coll;
+	unsigned long long pos;
+	struct iter_cursor *cursor;
+	struct r_val held; //The last item read from an iterator, released when the next one is read
+};
+
+static bool items_start(struct items *it, struct r_val coll) {
+	if(coll.type != TYPE_ITER && !int_iter_source_ok(coll))
+		return false;
+	
+	it->coll = coll;
+	it->pos = 0;
+	it->cursor = coll.type == TYPE_ITER ? int_iter_start(coll.iter_v) : NULL;
+	it->held = NULL_VAL;
+	return true;
+}
+
+static void items_end(struct items *it) {
+	int_decr_refcount(it->held);
+	if(it->cursor != NULL)
+		int_iter_end(it->cursor);
+}
+
+//The item is borrowed, and only valid until the next call
+static inline bool items_next(struct items *it, struct r_val *out, struct interp_env *env, const char *src_name) {
+	switch(it->coll.type) {
+		case TYPE_ARRAY:
+			if(it->pos >= it->coll.array_v->len)
+				return false;
+			*out = it->coll.array_v->items[it->pos++];
+			return true;
+		
+		case TYPE_INTVEC:
+			if(it->pos >= it->coll.intvec_v->len)
+				return false;
+			*out = INT_VAL(it->coll.intvec_v->items[it->pos++]);
+			return true;
+		
+		case TYPE_RANGE:
+			if(it->pos >= it->coll.range_v->len)
+				return false;
+			*out = INT_VAL(int_range_get(it->coll.range_v, it->pos++));
+			return true;
+		
+		default:
+			int_decr_refcount(it->held);
+			it->held = NULL_VAL;
+			if(!int_iter_next(it->cursor, &it->held, env, src_name))
+				return false;
+			*out = it->held;
+			return true;
+	}
+}
+
+//The sum of a packed array or range without reading it item by item; false for other collections
+static bool packed_sum(struct r_val coll, r_int *out) {
+	if(coll.type == TYPE_INTVEC) {
+		*out = int_intvec_sum(coll.intvec_v->items, coll.intvec_v->len);
+		return true;
+	}
+	
+	if(coll.type == TYPE_RANGE) {
+		//len * start + step * len * (len - 1) / 2, wrapping like the sum of the items would
+		const struct r_range *range = coll.range_v;
+		unsigned long long len = range->len, pairs = len % 2 == 0 ? len / 2 * (len - 1) : (len - 1) / 2 * len;
+		*out = (r_int) (len * (unsigned long long) range->start + pairs * (unsigned long long) range->step);
+		return true;
+	}
+	
+	return false;
+}
+
+//Counts the items too; false if one of them isn't an int, or if checked is set and the sum doesn't fit in an r_int
+static bool sum_items(struct r_val coll, bool checked, r_int *sum, unsigned long long *count, struct interp_env *env, const char *src_name) {
+	if(!checked && packed_sum(coll, sum)) {
+		*count = coll.type == TYPE_INTVEC ? coll.intvec_v->len : coll.range_v->len;
+		return true;
+	}
+	
+	struct items it;
+	if(!items_start(&it, coll))
+		return false;
+	
+	bool ok = true;
+	r_int total = 0;
+	struct r_val item;
+	for(*count = 0; ok && items_next(&it, &item, env, src_name); (*count)++) {
+		ok = item.type == TYPE_INT;
+		if(ok && checked)
+			ok = !__builtin_add_overflow(total, item.int_v, &total);
+		else if(ok)
+			total = (r_int) ((unsigned long long) total + (unsigned long long) item.int_v);
+	}
+	
+	items_end(&it);
+	*sum = total;
+	return ok && !int_interrupted();
+}
+
+//Null if an item isn't an int
+DECL_R_OP(sum) {
+	r_int sum;
+	unsigned long long count;
+	return sum_items(args[0], false, &sum, &count, env, src_name) ? INT_VAL(sum) : NULL_VAL;
+}
+
+//Rounded towards zero like /, Null for an empty collection or if the sum overflows
+DECL_R_OP(mean) {
+	r_int sum;
+	unsigned long long count;
+	if(!sum_items(args[0], true, &sum, &count, env, src_name) || count == 0)
+		return NULL_VAL;
+	
+	return INT_VAL(sum / (r_int) count);
+}
+
+//Whether fn, if given, is true for item; the item itself otherwise
+static bool test_item(struct r_val item, struct r_val *fn, struct interp_env *env, const char *src_name) {
+	if(fn == NULL)
+		return r_val_as_bool(item);
+	
+	struct r_val res = int_call_r_fn(*fn, &item, 1, env, src_name);
+	bool truth = r_val_as_bool(res);
+	int_decr_refcount(res);
+	return truth;
+}
+
+//(count coll) or (count coll fn), the number of items fn is true for
+DECL_R_OP(count) {
+	if(n_args > 2)
+		return NULL_VAL;
+	
+	if(n_args == 1 && args[0].type != TYPE_ITER) {
+		switch(args[0].type) {
+			case TYPE_ARRAY:
+				return INT_VAL(args[0].array_v->len);
+			case TYPE_INTVEC:
+				return INT_VAL(args[0].intvec_v->len);
+			case TYPE_RANGE:
+				return INT_VAL(args[0].range_v->len);
+			default:
+				return NULL_VAL;
+		}
+	}
+	
+	struct items it;
+	if(!items_start(&it, args[0]))
+		return NULL_VAL;
+	
+	r_int count = 0;
+	struct r_val item;
+	while(items_next(&it, &item, env, src_name) && !int_interrupted()) {
+		if(n_args == 1 || test_item(item, &args[1], env, src_name))
+			count++;
+	}
+	
+	items_end(&it);
+	return INT_VAL(count);
+}
+
+//(any coll) or (any coll fn), stopping at the first item that is true
+static struct r_val find_truth(struct r_val *args, unsigned n_args, bool want, struct interp_env *env, const char *src_name) {
+	struct items it;
+	if(n_args > 2 || !items_start(&it, args[0]))
+		return NULL_VAL;
+	
+	bool found = false;
+	struct r_val item;
+	while(!found && items_next(&it, &item, env, src_name) && !int_interrupted())
+		found = test_item(item, n_args == 2 ? &args[1] : NULL, env, src_name) == want;
+	
+	items_end(&it);
+	return INT_VAL(found);
+}
+
+DECL_R_OP(any) {
+	return find_truth(args, n_args, true, env, src_name);
+}
+
+DECL_R_OP(all) {
+	struct r_val res = find_truth(args, n_args, false, env, src_name);
+	return res.type == TYPE_INT ? INT_VAL(!res.int_v) : res;
+}
+
+//The smallest or largest item by r_vals_order, Null for an empty collection
+static struct r_val extreme(struct r_val coll, int sign, struct interp_env *env, const char *src_name) {
+	if(coll.type == TYPE_INTVEC) {
+		const struct r_intvec *vec = coll.intvec_v;
+		if(vec->len == 0)
+			return NULL_VAL;
+		return INT_VAL(sign < 0 ? int_intvec_min(vec->items, vec->len) : int_intvec_max(vec->items, vec->len));
+	}
+	
+	if(coll.type == TYPE_RANGE) {
+		const struct r_range *range = coll.range_v;
+		if(range->len == 0)
+			return NULL_VAL;
+		r_int first = range->start, last = int_range_get(range, range->len - 1);
+		return INT_VAL((range->step > 0) == (sign < 0) ? first : last);
+	}
+	
+	struct items it;
+	if(!items_start(&it, coll))
+		return NULL_VAL;
+	
+	struct r_val best = NULL_VAL, item;
+	bool first = true;
+	while(items_next(&it, &item, env, src_name)) {
+		if(first || r_vals_order(item, best) * sign > 0) {
+			int_decr_refcount(best);
+			best = item;
+			int_incr_refcount(best);
+			first = false;
+		}
+	}
+	
+	items_end(&it);
+	return best;
+}
+
+DECL_R_OP(min) {
+	return extreme(args[0], -1, env, src_name);
+}
+
+DECL_R_OP(max) {
+	return extreme(args[0], 1, env, src_name);
+}
+
+//Wrapping, as the builtins are
+static inline r_int apply_op(int op, r_int a, r_int b) {
+	unsigned long long x = a, y = b;
+	switch(op) {
+		case INTVEC_ADD:
+			return (r_int) (x + y);
+		case INTVEC_SUB:
+			return (r_int) (x - y);
+		default:
+			return (r_int) (x * y);
+	}
+}
+
+//Takes over acc. +, - and * are applied here, everything else is called.
+static struct r_val fold_items(struct items *it, struct r_val acc, struct r_val fn, struct interp_env *env, const char *src_name) {
+	int op = rlib_basic_arith_op(fn);
+	
+	r_int sum;
+	if(op == INTVEC_ADD && acc.type == TYPE_INT && it->pos == 0 && packed_sum(it->coll, &sum))
+		return INT_VAL((r_int) ((unsigned long long) acc.int_v + (unsigned long long) sum));
+	
+	struct r_val item;
+	while(items_next(it, &item, env, src_name)) {
+		if(op >= 0 && acc.type == TYPE_INT && item.type == TYPE_INT) {
+			acc.int_v = apply_op(op, acc.int_v, item.int_v);
+			continue;
+		}
+		
+		if(op >= 0) {
+			int_incr_refcount(item);
+			acc = rlib_intvec_arith(op, acc, item);
+		} else {
+			struct r_val call_args[2] = { acc, item };
+			struct r_val res = int_call_r_fn(fn, call_args, 2, env, src_name);
+			int_decr_refcount(acc);
+			acc = res;
+		}
+		
+		if(int_interrupted()) {
+			int_decr_refcount(acc);
+			return NULL_VAL;
+		}
+	}
+	
+	return acc;
+}
+
+//(fold coll init fn) calls (fn acc item) for each item, starting from init
+DECL_R_OP(fold) {
+	struct items it;
+	if(!items_start(&it, args[0]))
+		return NULL_VAL;
+	
+	int_incr_refcount(args[1]);
+	struct r_val res = fold_items(&it, args[1], args[2], env, src_name);
+	items_end(&it);
+	return res;
+}
+
+//(reduce coll fn) folds from the first item, Null for an empty collection
+DECL_R_OP(reduce) {
+	struct items it;
+	if(!items_start(&it, args[0]))
+		return NULL_VAL;
+	
+	struct r_val first, res = NULL_VAL;
+	if(items_next(&it, &first, env, src_name)) {
+		int_incr_refcount(first);
+		res = fold_items(&it, first, args[1], env, src_name);
+	}
+	
+	items_end(&it);
+	return res;
+}
+
+static struct rlib_op ops[] = {
+	DEF_R_OP(reduce, "reduce", 2),
+	DEF_R_OP(fold, "fold", 3),
+	DEF_R_OP(sum, "sum", 1),
+	DEF_R_OP(count, "count", -2),
+	DEF_R_OP(min, "min", 1),
+	DEF_R_OP(max, "max", 1),
+	DEF_R_OP(mean, "mean", 1),
+	DEF_R_OP(any, "any", -2),
+	DEF_R_OP(all, "all", -2)
+};
+
+static char loaded = 0;
+
+void rlib_fold_load() {
+	if(loaded)
+		return;
+	
+	loaded = 1;
+	LOAD_RLIB(ops);
+}
+
+void rlib_fold_put(struct interp_env *env) {
+	PUT_RLIB(ops, env);
+}
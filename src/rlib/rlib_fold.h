@@ -0,0 +1,10 @@
+#ifndef RLIB_FOLD_H_INCLUDED
+#define RLIB_FOLD_H_INCLUDED
+
+#include "../interpreter/interpreter.h"
+
+void rlib_fold_load();
+
+void rlib_fold_put(struct interp_env *env);
+
+#endif
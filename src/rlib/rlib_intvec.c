@@ -0,0 +1,197 @@
+#include "rlib_intvec.h"
+
+#include "rlib.h"
+
+#include "../interpreter/interpreter_range.h"
+
+#include <string.h>
+#include <limits.h>
+
+/*
+ * Packed int arrays are made with ints, from ints, numeric strings, ranges and arrays of those, or by +, -, * and the
+ * comparisons when one of their operands is one. argmax, prefix-sum and select work on them without unpacking the
+ * items, as do the aggregates in rlib_fold.
+ */
+
+#define NULL_VAL ((struct r_val) { .type = TYPE_NULL })
+#define INT_VAL(v) ((struct r_val) { .type = TYPE_INT, .int_v = (v) })
+
+//Decimal with an optional sign; surrounding whitespace is skipped, such as the \r left on lines split from a file
+static bool parse_int(const struct r_string *str, r_int *out) {
+	const char *c = str->str, *end = str->str + str->len;
+	while(c < end && (*c == ' ' || *c == '\t' || *c == '\r' || *c == '\n'))
+		c++;
+	while(end > c && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r' || end[-1] == '\n'))
+		end--;
+	
+	bool negative = c < end && *c == '-';
+	if(c < end && (*c == '-' || *c == '+'))
+		c++;
+	if(c == end)
+		return false;
+	
+	//The magnitude of the most negative r_int is one more than that of the largest
+	unsigned long long v = 0, limit = negative ? (unsigned long long) LLONG_MAX + 1 : LLONG_MAX;
+	for(; c < end; c++) {
+		if(*c < '0' || *c > '9')
+			return false;
+		
+		unsigned digit = *c - '0';
+		if(v > (limit - digit) / 10)
+			return false;
+		v = v * 10 + digit;
+	}
+	
+	*out = negative ? (r_int) (0 - v) : (r_int) v;
+	return true;
+}
+
+static bool to_int(struct r_val val, r_int *out) {
+	if(val.type == TYPE_INT) {
+		*out = val.int_v;
+		return true;
+	}
+	
+	return val.type == TYPE_STR && parse_int(val.str_v, out);
+}
+
+//(ints item ...) where the items are ints, numeric strings, arrays of those, ranges or packed arrays, which are all flattened
+DECL_R_OP(ints) {
+	unsigned len = 0;
+	for(unsigned i = 0; i < n_args; i++) {
+		if(args[i].type == TYPE_ARRAY)
+			len += args[i].array_v->len;
+		else if(args[i].type == TYPE_INTVEC)
+			len += args[i].intvec_v->len;
+		else if(args[i].type == TYPE_RANGE && args[i].range_v->len <= UINT_MAX - len)
+			len += args[i].range_v->len;
+		else if(args[i].type == TYPE_RANGE)
+			return NULL_VAL;
+		else
+			len++;
+	}
+	
+	struct r_intvec *vec = int_new_intvec(len);
+	r_int *out = vec->items;
+	
+	for(unsigned i = 0; i < n_args; i++) {
+		if(args[i].type == TYPE_INTVEC) {
+			memcpy(out, args[i].intvec_v->items, sizeof(r_int) * args[i].intvec_v->len);
+			out += args[i].intvec_v->len;
+		} else if(args[i].type == TYPE_RANGE) {
+			for(unsigned j = 0; j < args[i].range_v->len; j++)
+				*(out++) = int_range_get(args[i].range_v, j);
+		} else if(args[i].type == TYPE_ARRAY) {
+			struct r_array *array = args[i].array_v;
+			for(unsigned j = 0; j < array->len; j++) {
+				if(!to_int(array->items[j], out++))
+					goto ERR;
+			}
+		} else if(!to_int(args[i], out++)) {
+			goto ERR;
+		}
+	}
+	
+	return (struct r_val) { .type = TYPE_INTVEC, .intvec_v = vec };
+	
+	ERR:
+	s_dealloc(vec);
+	return NULL_VAL;
+}
+
+struct r_val rlib_intvec_arith(enum intvec_op op, struct r_val a, struct r_val b) {
+	struct r_val res = NULL_VAL;
+	bool a_vec = a.type == TYPE_INTVEC, b_vec = b.type == TYPE_INTVEC;
+	
+	if((!a_vec && a.type != TYPE_INT) || (!b_vec && b.type != TYPE_INT))
+		goto EXIT;
+	if(a_vec && b_vec && a.intvec_v->len != b.intvec_v->len)
+		goto EXIT;
+	
+	if(!a_vec && !b_vec) {
+		res = INT_VAL(0);
+		int_intvec_apply(op, &res.int_v, &a.int_v, true, &b.int_v, true, 1);
+		goto EXIT;
+	}
+	
+	//A temporary operand gets the result written over it, so a chain like (+ (* @v 3) 1) allocates once
+	struct r_intvec *out;
+	if(a_vec && rlib_is_unique(a)) {
+		out = a.intvec_v;
+		out->ref_c++;
+	} else if(b_vec && rlib_is_unique(b)) {
+		out = b.intvec_v;
+		out->ref_c++;
+	} else {
+		out = int_new_intvec(a_vec ? a.intvec_v->len : b.intvec_v->len);
+	}
+	
+	const r_int *a_items = a_vec ? a.intvec_v->items : &a.int_v, *b_items = b_vec ? b.intvec_v->items : &b.int_v;
+	int_intvec_apply(op, out->items, a_items, !a_vec, b_items, !b_vec, out->len);
+	res = (struct r_val) { .type = TYPE_INTVEC, .intvec_v = out };
+	
+	EXIT:
+	int_decr_refcount(a);
+	int_decr_refcount(b);
+	return res;
+}
+
+//Null for an empty array
+DECL_R_OP(argmax) {
+	if(args[0].type != TYPE_INTVEC || args[0].intvec_v->len == 0)
+		return NULL_VAL;
+	
+	return INT_VAL(int_intvec_argmax(args[0].intvec_v->items, args[0].intvec_v->len));
+}
+
+//Reuses the argument if it is a temporary
+static struct r_intvec *result_for(struct r_val arg, unsigned len) {
+	if(rlib_is_unique(arg)) {
+		arg.intvec_v->ref_c++;
+		return arg.intvec_v;
+	}
+	
+	return int_new_intvec(len);
+}
+
+DECL_R_OP(prefix_sum) {
+	if(args[0].type != TYPE_INTVEC)
+		return NULL_VAL;
+	
+	struct r_intvec *vec = args[0].intvec_v, *out = result_for(args[0], vec->len);
+	int_intvec_prefix_sum(out->items, vec->items, vec->len);
+	
+	return (struct r_val) { .type = TYPE_INTVEC, .intvec_v = out };
+}
+
+//(select array mask) the items where the mask, e.g from (> @array 100), is non zero
+DECL_R_OP(select) {
+	if(args[0].type != TYPE_INTVEC || args[1].type != TYPE_INTVEC || args[0].intvec_v->len != args[1].intvec_v->len)
+		return NULL_VAL;
+	
+	struct r_intvec *vec = args[0].intvec_v, *out = result_for(args[0], vec->len);
+	out->len = int_intvec_select(out->items, vec->items, args[1].intvec_v->items, vec->len);
+	
+	return (struct r_val) { .type = TYPE_INTVEC, .intvec_v = out };
+}
+
+static struct rlib_op ops[] = {
+	DEF_R_OP(ints, "ints", -1),
+	DEF_R_OP(argmax, "argmax", 1),
+	DEF_R_OP(prefix_sum, "prefix-sum", 1),
+	DEF_R_OP(select, "select", 2)
+};
+
+static char loaded = 0;
+
+void rlib_intvec_load() {
+	if(loaded)
+		return;
+	
+	loaded = 1;
+	LOAD_RLIB(ops);
+}
+
+void rlib_intvec_put(struct interp_env *env) {
+	PUT_RLIB(ops, env);
+}
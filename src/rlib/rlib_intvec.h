@@ -0,0 +1,15 @@
+#ifndef RLIB_INTVEC_H_INCLUDED
+#define RLIB_INTVEC_H_INCLUDED
+
+#include "../interpreter/interpreter.h"
+#include "../interpreter/interpreter_intvec.h"
+
+void rlib_intvec_load();
+
+void rlib_intvec_put(struct interp_env *env);
+
+//a op b for ints and packed int arrays, a scalar applying to every item. Takes over both references; Null if the operands
+//aren't numbers or the arrays differ in length.
+struct r_val rlib_intvec_arith(enum intvec_op op, struct r_val a, struct r_val b);
+
+#endif
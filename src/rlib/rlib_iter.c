@@ -0,0 +1,112 @@
+#include "rlib_iter.h"
+
+#include "rlib.h"
+
+#include "../interpreter/interpreter_iter.h"
+#include "../interpreter/interpreter_range.h"
+
+/*
+ * (iter collection) starts a lazy pipeline: map and filter given an iterator add a stage to it rather than building an
+ * array, and take and zip make stages too. Nothing runs until the iterator is collected, printed or passed to a command.
+ * Ranges are lazy in themselves: length, index, map, filter and for work from their bounds without making the items.
+ */
+
+#define NULL_VAL ((struct r_val) { .type = TYPE_NULL })
+#define ITER_VAL(it) ((struct r_val) { .type = TYPE_ITER, .iter_v = (it) })
+
+//Arrays are wrapped in a source stage; the caller gets its own reference
+static struct r_iter *as_iter(struct r_val val) {
+	if(val.type == TYPE_ITER) {
+		val.iter_v->ref_c++;
+		return val.iter_v;
+	}
+	
+	if(int_iter_source_ok(val))
+		return int_new_iter(ITER_SOURCE, val, NULL_VAL, 0);
+	
+	return NULL;
+}
+
+DECL_R_OP(iter) {
+	struct r_iter *iter = as_iter(args[0]);
+	return iter != NULL ? ITER_VAL(iter) : NULL_VAL;
+}
+
+//(take collection n) the first n items
+DECL_R_OP(take) {
+	if(args[1].type != TYPE_INT)
+		return NULL_VAL;
+	
+	struct r_iter *src = as_iter(args[0]);
+	if(src == NULL)
+		return NULL_VAL;
+	
+	struct r_iter *iter = int_new_iter(ITER_TAKE, ITER_VAL(src), NULL_VAL, args[1].int_v);
+	src->ref_c--;
+	return ITER_VAL(iter);
+}
+
+//(zip a b) pairs of the items at the same position, as long as the shorter collection
+DECL_R_OP(zip) {
+	struct r_iter *first = as_iter(args[0]), *second = as_iter(args[1]);
+	
+	struct r_val res = NULL_VAL;
+	if(first != NULL && second != NULL)
+		res = ITER_VAL(int_new_iter(ITER_ZIP, ITER_VAL(first), ITER_VAL(second), 0));
+	
+	if(first != NULL)
+		int_decr_refcount(ITER_VAL(first));
+	if(second != NULL)
+		int_decr_refcount(ITER_VAL(second));
+	return res;
+}
+
+//(range stop), (range start stop) or (range start stop step)
+DECL_R_OP(range) {
+	if(n_args > 3)
+		return NULL_VAL;
+	for(unsigned i = 0; i < n_args; i++) {
+		if(args[i].type != TYPE_INT)
+			return NULL_VAL;
+	}
+	
+	r_int start = n_args > 1 ? args[0].int_v : 0, stop = n_args > 1 ? args[1].int_v : args[0].int_v;
+	struct r_range *range = int_new_range(start, stop, n_args == 3 ? args[2].int_v : 1);
+	
+	return range != NULL ? (struct r_val) { .type = TYPE_RANGE, .range_v = range } : NULL_VAL;
+}
+
+//Iterators and ranges become arrays, anything else is returned as it is
+DECL_R_OP(collect) {
+	if(args[0].type == TYPE_ITER || args[0].type == TYPE_RANGE) {
+		struct r_iter *iter = as_iter(args[0]);
+		struct r_array *array = int_iter_collect(iter, env, src_name);
+		int_decr_refcount(ITER_VAL(iter));
+		return (struct r_val) { .type = TYPE_ARRAY, .array_v = array };
+	}
+	
+	int_incr_refcount(args[0]);
+	return args[0];
+}
+
+static struct rlib_op ops[] = {
+	DEF_R_OP(iter, "iter", 1),
+	DEF_R_OP(take, "take", 2),
+	DEF_R_OP(zip, "zip", 2),
+	DEF_R_OP(collect, "collect", 1),
+	DEF_R_OP(range, "range", -2)
+};
+
+static char loaded = 0;
+
+void rlib_iter_load() {
+	if(loaded)
+		return;
+	
+	loaded = 1;
+	LOAD_RLIB(ops);
+}
+
+void rlib_iter_put(struct interp_env *env) {
+	PUT_RLIB(ops, env);
+}
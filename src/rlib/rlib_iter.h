@@ -0,0 +1,10 @@
+#ifndef RLIB_ITER_H_INCLUDED
+#define RLIB_ITER_H_INCLUDED
+
+#include "../interpreter/interpreter.h"
+
+void rlib_iter_load();
+
+void rlib_iter_put(struct interp_env *env);
+
+#endif
@@ -0,0 +1,378 @@
+#include "rlib_map.h"
+
+#include "rlib.h"
+
+#include "../interpreter/interpreter_map.h"
+#include "../interpreter/interpreter_pvec.h"
+#include "../interpreter/interpreter_pmap.h"
+#include "../interpreter/interpreter_iter.h"
+
+//(hashmap key value key value ...)
+DECL_R_OP(hashmap) {
+	if(n_args % 2 != 0)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	for(unsigned i = 0; i < n_args; i += 2) {
+		if(!int_map_key_ok(args[i]))
+			return (struct r_val) { .type = TYPE_NULL };
+	}
+	
+	struct r_map *map = int_new_map(n_args / 2);
+	for(unsigned i = 0; i < n_args; i += 2)
+		int_map_set(map, args[i], args[i + 1]);
+	
+	return (struct r_val) { .type = TYPE_MAP, .map_v = map };
+}
+
+//(get map key [default]), also for persistent maps and vectors
+DECL_R_OP(get) {
+	if(n_args > 3)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	struct r_val *val = NULL;
+	switch(args[0].type) {
+		case TYPE_MAP:
+			val = int_map_get(args[0].map_v, args[1]);
+			break;
+		
+		case TYPE_PMAP:
+			val = int_pmap_get(args[0].pmap_v, args[1]);
+			break;
+		
+		case TYPE_PVEC: {
+			struct r_pvec *vec = args[0].pvec_v;
+			if(args[1].type == TYPE_INT && args[1].int_v >= 0 && args[1].int_v < vec->len) {
+				struct r_val item = int_pvec_get(vec, args[1].int_v);
+				int_incr_refcount(item);
+				return item;
+			}
+		} break;
+		
+		default:
+			return (struct r_val) { .type = TYPE_NULL };
+	}
+	
+	struct r_val res = val != NULL ? *val : n_args == 3 ? args[2] : (struct r_val) { .type = TYPE_NULL };
+	
+	int_incr_refcount(res);
+	return res;
+}
+
+struct reach_ctx {
+	const struct r_map *map;
+	bool found;
+};
+
+static bool reaches(struct r_val val, const struct r_map *map);
+
+static void reach_pmap_entry(const struct r_map_entry *e, void *ctx) {
+	struct reach_ctx *r = ctx;
+	r->found = r->found || reaches(e->val, r->map);
+}
+
+//Whether map is val or can be got to from it. Keys can't hold a map, so only values are followed.
+static bool reaches(struct r_val val, const struct r_map *map) {
+	switch(val.type) {
+		case TYPE_MAP:
+			if(val.map_v == map)
+				return true;
+			INT_MAP_FOREACH(val.map_v, e) {
+				if(reaches(e->val, map))
+					return true;
+			}
+			return false;
+		
+		case TYPE_ARRAY:
+			for(unsigned i = 0; i < val.array_v->len; i++) {
+				if(reaches(val.array_v->items[i], map))
+					return true;
+			}
+			return false;
+		
+		case TYPE_PVEC:
+			for(unsigned i = 0; i < val.pvec_v->len; i++) {
+				if(reaches(int_pvec_get(val.pvec_v, i), map))
+					return true;
+			}
+			return false;
+		
+		case TYPE_PMAP: {
+			struct reach_ctx ctx = { .map = map, .found = false };
+			int_pmap_foreach(val.pmap_v, reach_pmap_entry, &ctx);
+			return ctx.found;
+		}
+		
+		case TYPE_ITER:
+			return reaches(val.iter_v->src, map) || reaches(val.iter_v->arg, map);
+		
+		default:
+			return false;
+	}
+}
+
+//(put map key value) sets the key in place and evaluates to the map. Null if the value holds the map itself, as the
+//cycle could never be freed or printed.
+DECL_R_OP(put) {
+	if(args[0].type != TYPE_MAP || !int_map_key_ok(args[1]) || reaches(args[2], args[0].map_v))
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	int_map_set(args[0].map_v, args[1], args[2]);
+	
+	int_incr_refcount(args[0]);
+	return args[0];
+}
+
+DECL_R_OP(del) {
+	if(args[0].type != TYPE_MAP && args[0].type != TYPE_SET)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	return (struct r_val) { .type = TYPE_INT, .int_v = int_map_del(args[0].map_v, args[1]) };
+}
+
+DECL_R_OP(has) {
+	if(args[0].type == TYPE_PMAP)
+		return (struct r_val) { .type = TYPE_INT, .int_v = int_pmap_get(args[0].pmap_v, args[1]) != NULL };
+	if(args[0].type != TYPE_MAP && args[0].type != TYPE_SET)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	return (struct r_val) { .type = TYPE_INT, .int_v = int_map_get(args[0].map_v, args[1]) != NULL };
+}
+
+static struct r_val map_to_array(struct r_map *map, bool keys) {
+	struct r_array *array = int_new_array(map->len);
+	
+	unsigned i = 0;
+	INT_MAP_FOREACH(map, e) {
+		array->items[i] = keys ? e->key : e->val;
+		int_incr_refcount(array->items[i++]);
+	}
+	
+	return (struct r_val) { .type = TYPE_ARRAY, .array_v = array };
+}
+
+struct pmap_collect {
+	struct r_array *array;
+	bool keys;
+};
+
+static void collect_pmap_entry(const struct r_map_entry *e, void *ctx) {
+	struct pmap_collect *c = ctx;
+	struct r_val v = c->keys ? e->key : e->val;
+	int_incr_refcount(v);
+	c->array->items[c->array->len++] = v;
+}
+
+static struct r_val pmap_to_array(struct r_pmap *map, bool keys) {
+	struct pmap_collect c = { .array = int_new_array(map->len), .keys = keys };
+	c.array->len = 0;
+	int_pmap_foreach(map, collect_pmap_entry, &c);
+	return (struct r_val) { .type = TYPE_ARRAY, .array_v = c.array };
+}
+
+DECL_R_OP(keys) {
+	if(args[0].type == TYPE_PMAP)
+		return pmap_to_array(args[0].pmap_v, true);
+	if(args[0].type != TYPE_MAP && args[0].type != TYPE_SET)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	return map_to_array(args[0].map_v, true);
+}
+
+//The items of a persistent vector are its values too
+DECL_R_OP(values) {
+	if(args[0].type == TYPE_PMAP)
+		return pmap_to_array(args[0].pmap_v, false);
+	
+	if(args[0].type == TYPE_PVEC) {
+		struct r_pvec *vec = args[0].pvec_v;
+		struct r_array *array = int_new_array(vec->len);
+		for(unsigned i = 0; i < vec->len; i++) {
+			array->items[i] = int_pvec_get(vec, i);
+			int_incr_refcount(array->items[i]);
+		}
+		return (struct r_val) { .type = TYPE_ARRAY, .array_v = array };
+	}
+	
+	if(args[0].type != TYPE_MAP)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	return map_to_array(args[0].map_v, false);
+}
+
+//(merge map ...) makes a new map; for keys in several maps the last one wins
+DECL_R_OP(merge) {
+	for(unsigned i = 0; i < n_args; i++) {
+		if(args[i].type != TYPE_MAP)
+			return (struct r_val) { .type = TYPE_NULL };
+	}
+	
+	struct r_map *map = int_copy_map(args[0].map_v);
+	for(unsigned i = 1; i < n_args; i++) {
+		INT_MAP_FOREACH(args[i].map_v, e)
+			int_map_set(map, e->key, e->val);
+	}
+	
+	return (struct r_val) { .type = TYPE_MAP, .map_v = map };
+}
+
+static bool keys_ok(struct r_val val) {
+	if(val.type != TYPE_ARRAY)
+		return int_map_key_ok(val);
+	
+	for(unsigned i = 0; i < val.array_v->len; i++) {
+		if(!int_map_key_ok(val.array_v->items[i]))
+			return false;
+	}
+	return true;
+}
+
+static void add_keys(struct r_map *set, struct r_val val) {
+	if(val.type == TYPE_ARRAY)
+		int_map_add_keys(set, val.array_v->items, val.array_v->len);
+	else
+		int_map_add_keys(set, &val, 1);
+}
+
+//(hashset item ...) where arrays are added item by item, so (hashset (split (ls) "\n")) works
+DECL_R_OP(hashset) {
+	unsigned n = 0;
+	for(unsigned i = 0; i < n_args; i++) {
+		if(!keys_ok(args[i]))
+			return (struct r_val) { .type = TYPE_NULL };
+		n += args[i].type == TYPE_ARRAY ? args[i].array_v->len : 1;
+	}
+	
+	struct r_map *set = int_new_map(n);
+	for(unsigned i = 0; i < n_args; i++)
+		add_keys(set, args[i]);
+	
+	return (struct r_val) { .type = TYPE_SET, .map_v = set };
+}
+
+//Set operations take sets or arrays, arrays are turned into temporary sets
+static bool set_args(const struct r_val *args, unsigned n_args, struct r_map **sets) {
+	for(unsigned i = 0; i < n_args; i++) {
+		if(args[i].type != TYPE_SET && (args[i].type != TYPE_ARRAY || !keys_ok(args[i])))
+			return false;
+	}
+	
+	for(unsigned i = 0; i < n_args; i++) {
+		if(args[i].type == TYPE_SET) {
+			sets[i] = args[i].map_v;
+			sets[i]->ref_c++;
+		} else {
+			sets[i] = int_new_map(args[i].array_v->len);
+			add_keys(sets[i], args[i]);
+		}
+	}
+	return true;
+}
+
+static void free_set_args(struct r_map **sets, unsigned n_args) {
+	for(unsigned i = 0; i < n_args; i++)
+		int_decr_refcount((struct r_val) { .type = TYPE_SET, .map_v = sets[i] });
+	s_dealloc(sets);
+}
+
+static void set_add_entry(struct r_map *set, const struct r_map_entry *e) {
+	int_map_set_hashed(set, e->key, (struct r_val) { .type = TYPE_NULL }, e->hash);
+}
+
+enum {
+	SET_UNION,
+	SET_INTERSECT,
+	SET_DIFFERENCE
+};
+
+//Always makes a new set; membership checks reuse the hashes stored in the entries
+static struct r_val set_op(int op, const struct r_val *args, unsigned n_args) {
+	struct r_map **sets = NSALLOC(struct r_map *, n_args);
+	if(!set_args(args, n_args, sets)) {
+		s_dealloc(sets);
+		return (struct r_val) { .type = TYPE_NULL };
+	}
+	
+	struct r_map *res;
+	
+	if(op == SET_UNION) {
+		unsigned n = 0;
+		for(unsigned i = 0; i < n_args; i++)
+			n += sets[i]->len;
+		
+		res = int_new_map(n);
+		for(unsigned i = 0; i < n_args; i++) {
+			INT_MAP_FOREACH(sets[i], e)
+				set_add_entry(res, e);
+		}
+	} else if(op == SET_INTERSECT) {
+		//Walk the smallest set, the order of the others doesn't matter
+		unsigned smallest = 0;
+		for(unsigned i = 1; i < n_args; i++) {
+			if(sets[i]->len < sets[smallest]->len)
+				smallest = i;
+		}
+		
+		res = int_new_map(sets[smallest]->len);
+		INT_MAP_FOREACH(sets[smallest], e) {
+			bool in_all = true;
+			for(unsigned i = 0; i < n_args && in_all; i++)
+				in_all = i == smallest || int_map_get_hashed(sets[i], e->key, e->hash) != NULL;
+			if(in_all)
+				set_add_entry(res, e);
+		}
+	} else {
+		res = int_new_map(sets[0]->len);
+		INT_MAP_FOREACH(sets[0], e) {
+			bool in_any = false;
+			for(unsigned i = 1; i < n_args && !in_any; i++)
+				in_any = int_map_get_hashed(sets[i], e->key, e->hash) != NULL;
+			if(!in_any)
+				set_add_entry(res, e);
+		}
+	}
+	
+	free_set_args(sets, n_args);
+	return (struct r_val) { .type = TYPE_SET, .map_v = res };
+}
+
+DECL_R_OP(set_union) {
+	return set_op(SET_UNION, args, n_args);
+}
+
+DECL_R_OP(set_intersect) {
+	return set_op(SET_INTERSECT, args, n_args);
+}
+
+//(difference a b ...) is what's in a but in none of the others
+DECL_R_OP(set_difference) {
+	return set_op(SET_DIFFERENCE, args, n_args);
+}
+
+static struct rlib_op ops[] = {
+	DEF_R_OP(hashmap, "hashmap", -1),
+	DEF_R_OP(get, "get", -3),
+	DEF_R_OP(put, "put", 3),
+	DEF_R_OP(del, "del", 2),
+	DEF_R_OP(has, "has", 2),
+	DEF_R_OP(keys, "keys", 1),
+	DEF_R_OP(values, "values", 1),
+	DEF_R_OP(merge, "merge", -2),
+	DEF_R_OP(hashset, "hashset", -1),
+	DEF_R_OP(set_union, "union", -2),
+	DEF_R_OP(set_intersect, "intersect", -2),
+	DEF_R_OP(set_difference, "difference", -2)
+};
+
+static char loaded = 0;
+
+void rlib_map_load() {
+	if(loaded)
+		return;
+	
+	loaded = 1;
+	LOAD_RLIB(ops);
+}
+
+void rlib_map_put(struct interp_env *env) {
+	PUT_RLIB(ops, env);
+}
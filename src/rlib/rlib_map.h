@@ -0,0 +1,10 @@
+#ifndef RLIB_MAP_H_INCLUDED
+#define RLIB_MAP_H_INCLUDED
+
+#include "../interpreter/interpreter.h"
+
+void rlib_map_load();
+
+void rlib_map_put(struct interp_env *env);
+
+#endif
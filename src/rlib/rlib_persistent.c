@@ -0,0 +1,160 @@
+#include "rlib_persistent.h"
+
+#include "rlib.h"
+
+#include "../interpreter/interpreter_pvec.h"
+#include "../interpreter/interpreter_pmap.h"
+
+/*
+ * Persistent vectors and maps never change; conj, assoc and dissoc make new versions that share most of their structure
+ * with the old one, so keeping every version of a large collection around is cheap. get, has, keys, values and length
+ * work on them like on arrays and hash maps.
+ */
+
+DECL_R_OP(pvec) {
+	return (struct r_val) { .type = TYPE_PVEC, .pvec_v = int_new_pvec(args, n_args) };
+}
+
+DECL_R_OP(pvec_from) {
+	if(args[0].type != TYPE_ARRAY)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	return (struct r_val) { .type = TYPE_PVEC, .pvec_v = int_new_pvec(args[0].array_v->items, args[0].array_v->len) };
+}
+
+//(pmap key value key value ...)
+DECL_R_OP(pmap) {
+	if(n_args % 2 != 0)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	for(unsigned i = 0; i < n_args; i += 2) {
+		if(!int_map_key_ok(args[i]))
+			return (struct r_val) { .type = TYPE_NULL };
+	}
+	
+	struct r_pmap *map = int_new_pmap();
+	for(unsigned i = 0; i < n_args; i += 2)
+		int_pmap_set_in_place(map, args[i], args[i + 1]);
+	
+	return (struct r_val) { .type = TYPE_PMAP, .pmap_v = map };
+}
+
+//(pmap-from hashmap)
+DECL_R_OP(pmap_from) {
+	if(args[0].type != TYPE_MAP)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	struct r_pmap *map = int_new_pmap();
+	INT_MAP_FOREACH(args[0].map_v, e)
+		int_pmap_set_in_place(map, e->key, e->val);
+	
+	return (struct r_val) { .type = TYPE_PMAP, .pmap_v = map };
+}
+
+//(conj vector item ...) appends the items
+DECL_R_OP(conj) {
+	if(args[0].type != TYPE_PVEC)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	struct r_pvec *vec = int_pvec_push(args[0].pvec_v, args[1]);
+	for(unsigned i = 2; i < n_args; i++) {
+		struct r_pvec *next = int_pvec_push(vec, args[i]);
+		int_free_pvec(vec);
+		vec = next;
+	}
+	
+	return (struct r_val) { .type = TYPE_PVEC, .pvec_v = vec };
+}
+
+static struct r_val assoc_pvec(struct r_pvec *vec, struct r_val *args, unsigned n_args) {
+	for(unsigned i = 0; i < n_args; i += 2) {
+		if(args[i].type != TYPE_INT || args[i].int_v < 0 || args[i].int_v > vec->len) {
+			if(i != 0)
+				int_free_pvec(vec);
+			return (struct r_val) { .type = TYPE_NULL };
+		}
+		
+		//The index just past the end appends
+		struct r_pvec *next = args[i].int_v == vec->len ? int_pvec_push(vec, args[i + 1]) : int_pvec_set(vec, args[i].int_v, args[i + 1]);
+		if(i != 0)
+			int_free_pvec(vec);
+		vec = next;
+	}
+	
+	return (struct r_val) { .type = TYPE_PVEC, .pvec_v = vec };
+}
+
+//(assoc collection key value ...) sets keys of a persistent map or indices of a persistent vector
+DECL_R_OP(assoc) {
+	if(n_args % 2 != 1)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	if(args[0].type == TYPE_PVEC)
+		return assoc_pvec(args[0].pvec_v, args + 1, n_args - 1);
+	
+	if(args[0].type != TYPE_PMAP)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	for(unsigned i = 1; i < n_args; i += 2) {
+		if(!int_map_key_ok(args[i]))
+			return (struct r_val) { .type = TYPE_NULL };
+	}
+	
+	//Nothing else can see a temporary, or the new version once it's made, so the remaining changes can go in place
+	struct r_pmap *map;
+	unsigned first;
+	if(rlib_is_unique(args[0])) {
+		map = args[0].pmap_v;
+		map->ref_c++;
+		first = 1;
+	} else {
+		map = int_pmap_set(args[0].pmap_v, args[1], args[2]);
+		first = 3;
+	}
+	
+	for(unsigned i = first; i < n_args; i += 2)
+		int_pmap_set_in_place(map, args[i], args[i + 1]);
+	
+	return (struct r_val) { .type = TYPE_PMAP, .pmap_v = map };
+}
+
+//(dissoc map key ...)
+DECL_R_OP(dissoc) {
+	if(args[0].type != TYPE_PMAP)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	struct r_pmap *map = args[0].pmap_v;
+	map->ref_c++;
+	
+	for(unsigned i = 1; i < n_args; i++) {
+		struct r_pmap *next = int_pmap_del(map, args[i]);
+		int_decr_refcount((struct r_val) { .type = TYPE_PMAP, .pmap_v = map });
+		map = next;
+	}
+	
+	return (struct r_val) { .type = TYPE_PMAP, .pmap_v = map };
+}
+
+static struct rlib_op ops[] = {
+	DEF_R_OP(pvec, "pvec", -1),
+	DEF_R_OP(pvec_from, "pvec-from", 1),
+	DEF_R_OP(pmap, "pmap", -1),
+	DEF_R_OP(pmap_from, "pmap-from", 1),
+	DEF_R_OP(conj, "conj", -3),
+	DEF_R_OP(assoc, "assoc", -4),
+	DEF_R_OP(dissoc, "dissoc", -3)
+};
+
+static char loaded = 0;
+
+void rlib_persistent_load() {
+	if(loaded)
+		return;
+	
+	loaded = 1;
+	LOAD_RLIB(ops);
+}
+
+void rlib_persistent_put(struct interp_env *env) {
+	PUT_RLIB(ops, env);
+}
@@ -0,0 +1,10 @@
+#ifndef RLIB_PERSISTENT_H_INCLUDED
+#define RLIB_PERSISTENT_H_INCLUDED
+
+#include "../interpreter/interpreter.h"
+
+void rlib_persistent_load();
+
+void rlib_persistent_put(struct interp_env *env);
+
+#endif
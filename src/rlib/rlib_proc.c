@@ -0,0 +1,1017 @@
+#include "rlib_proc.h"
+
+#include "rlib.h"
+
+#include "../proj_utils.h"
+#include "../interpreter/interpreter_fmt.h"
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+
+//---------------------------- Coprocesses
+
+/*
+A coprocess is a long running child process that the script talks to over a pair of pipes; requests are written as lines to its
+stdin and responses are read as lines from its stdout. A handle refers to a group of one or more identical processes (a pool),
+writes and reads are each distributed round-robin over the group, so the n:th response read always belongs to the n:th request written.
+*/
+
+struct coproc {
+	pid_t pid;
+	FILE *to, *from;
+};
+
+struct coproc_group {
+	struct coproc *procs;
+	unsigned n, write_i, read_i;
+	bool open;
+};
+
+static struct { struct coproc_group *items; size_t len, cap; } coproc_groups;
+
+static struct coproc_group *get_coproc_group(struct r_val handle) {
+	if(handle.type != TYPE_INT || handle.int_v < 0 || handle.int_v >= coproc_groups.len)
+		return NULL;
+	
+	struct coproc_group *group = &coproc_groups.items[handle.int_v];
+	if(!group->open)
+		return NULL;
+	
+	return group;
+}
+
+static int start_coproc(struct coproc *proc, char **arg_strs, struct interp_env *env) {
+	int to_child[2], from_child[2];
+	
+	if(pipe(to_child))
+		return -1;
+	
+	if(pipe(from_child)) {
+		close(to_child[0]);
+		close(to_child[1]);
+		return -1;
+	}
+	
+	//The parent ends shouldn't leak into other children (including other coprocesses), or they would never see an end of file
+	fcntl(to_child[1], F_SETFD, FD_CLOEXEC);
+	fcntl(from_child[0], F_SETFD, FD_CLOEXEC);
+	
+	fflush(stdout);
+	
+	pid_t pid = fork();
+	switch(pid) {
+		case -1:
+			close(to_child[0]);
+			close(to_child[1]);
+			close(from_child[0]);
+			close(from_child[1]);
+			return -1;
+		
+		case 0:
+			dup2(to_child[0], STDIN_FILENO);
+			dup2(from_child[1], STDOUT_FILENO);
+			close(to_child[0]);
+			close(from_child[1]);
+			
+			int_reset_exec_signals();
+			int_apply_exec_limits(env);
+			execvp(arg_strs[0], arg_strs);
+			
+			fprintf(int_get_errout(env), "Unable to exec '%s': %s\n", arg_strs[0], strerror(errno));
+			exit(-1);
+		
+		default:
+			close(to_child[0]);
+			close(from_child[1]);
+			
+			proc->pid = pid;
+			proc->to = fdopen(to_child[1], "w");
+			proc->from = fdopen(from_child[0], "r");
+			
+			if(proc->to == NULL || proc->from == NULL) {
+				int fdopen_errno = errno; //Kept for the callers message
+				
+				if(proc->to != NULL)
+					fclose(proc->to);
+				else
+					close(to_child[1]);
+				if(proc->from != NULL)
+					fclose(proc->from);
+				else
+					close(from_child[0]);
+				
+				//With its stdin closed the child ends the same way a stopped coprocess does
+				while(waitpid(pid, NULL, 0) == -1 && errno == EINTR);
+				
+				errno = fdopen_errno;
+				return -1;
+			}
+			return 0;
+	}
+}
+
+static void stop_coproc(struct coproc *proc) {
+	fclose(proc->to); //Closing the childs stdin is what tells a well behaved filter to exit
+	fclose(proc->from);
+	
+	int status;
+	while(waitpid(proc->pid, &status, 0) == -1 && errno == EINTR);
+}
+
+static struct r_val open_coproc_group(unsigned n, struct r_val com, struct r_val *args, unsigned n_args, struct interp_env *env) {
+	if(com.type != TYPE_STR || n == 0)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	memory_region *tmp_region = NEW_REGION();
+	
+	lstring com_str = { .str = com.str_v->str, .len = com.str_v->len };
+	char **arg_strs = int_prepare_command(com_str, args, n_args, env, tmp_region);
+	
+	if(arg_strs == NULL) {
+		free_memory_region(tmp_region);
+		return (struct r_val) { .type = TYPE_NULL };
+	}
+	
+	struct coproc *procs = NSALLOC(struct coproc, n);
+	for(unsigned i = 0; i < n; i++) {
+		if(start_coproc(&procs[i], arg_strs, env)) {
+			fprintf(int_get_errout(env), "Unable to start coprocess '%s': %s\n", arg_strs[0], strerror(errno));
+			
+			for(unsigned j = 0; j < i; j++)
+				stop_coproc(&procs[j]);
+			
+			s_dealloc(procs);
+			free_memory_region(tmp_region);
+			return (struct r_val) { .type = TYPE_NULL };
+		}
+	}
+	
+	free_memory_region(tmp_region);
+	
+	if(coproc_groups.len == coproc_groups.cap) {
+		coproc_groups.cap += 1;
+		coproc_groups.cap *= 2;
+		coproc_groups.items = SREALLOC(struct coproc_group, coproc_groups.items, coproc_groups.cap);
+	}
+	
+	coproc_groups.items[coproc_groups.len] = (struct coproc_group) { .procs = procs, .n = n, .write_i = 0, .read_i = 0, .open = true };
+	
+	return (struct r_val) { .type = TYPE_INT, .int_v = coproc_groups.len++ };
+}
+
+DECL_R_OP(coproc) {
+	return open_coproc_group(1, args[0], args + 1, n_args - 1, env);
+}
+
+DECL_R_OP(coproc_pool) {
+	if(args[0].type != TYPE_INT || args[0].int_v <= 0)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	return open_coproc_group(args[0].int_v, args[1], args + 2, n_args - 2, env);
+}
+
+static int coproc_write(struct coproc_group *group, struct r_val *args, unsigned n_args) {
+	struct coproc *proc = &group->procs[group->write_i];
+	group->write_i = (group->write_i + 1) % group->n;
+	
+	for(unsigned i = 0; i < n_args; i++) {
+		fmt_print_r_val(proc->to, args[i]);
+		if(i != n_args - 1)
+			putc(' ', proc->to);
+	}
+	putc('\n', proc->to);
+	
+	return fflush(proc->to);
+}
+
+static struct r_val coproc_read(struct coproc_group *group) {
+	struct coproc *proc = &group->procs[group->read_i];
+	group->read_i = (group->read_i + 1) % group->n;
+	
+	struct r_string *line = read_r_string_line(proc->from);
+	if(line == NULL)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	return (struct r_val) { .type = TYPE_STR, .str_v = line };
+}
+
+DECL_R_OP(coproc_write) {
+	struct coproc_group *group = get_coproc_group(args[0]);
+	if(group == NULL)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	if(coproc_write(group, args + 1, n_args - 1)) {
+		fprintf(int_get_errout(env), "Unable to write to coprocess: %s\n", strerror(errno));
+		return (struct r_val) { .type = TYPE_NULL };
+	}
+	
+	return (struct r_val) { .type = TYPE_INT, .int_v = 1 };
+}
+
+DECL_R_OP(coproc_readline) {
+	struct coproc_group *group = get_coproc_group(args[0]);
+	if(group == NULL)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	return coproc_read(group);
+}
+
+DECL_R_OP(coproc_call) {
+	struct coproc_group *group = get_coproc_group(args[0]);
+	if(group == NULL)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	if(coproc_write(group, args + 1, n_args - 1)) {
+		fprintf(int_get_errout(env), "Unable to write to coprocess: %s\n", strerror(errno));
+		return (struct r_val) { .type = TYPE_NULL };
+	}
+	
+	return coproc_read(group);
+}
+
+DECL_R_OP(coproc_close) {
+	struct coproc_group *group = get_coproc_group(args[0]);
+	if(group == NULL)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	for(unsigned i = 0; i < group->n; i++)
+		stop_coproc(&group->procs[i]);
+	
+	s_dealloc(group->procs);
+	group->procs = NULL;
+	group->open = false;
+	
+	return (struct r_val) { .type = TYPE_NULL };
+}
+
+//---------------------------- Process substitution
+
+/*
+psub runs a command with its output connected to a pipe and evaluates to a /dev/fd path for the read end, psub-in does the
+same with the commands input and the write end. The path is meant to be passed as an argument to an external command; the
+parents end of the pipe stays open (and inheritable) until that command has finished, after which the child is waited for.
+*/
+
+static struct r_val process_substitution(struct r_val com, struct r_val *args, unsigned n_args, struct interp_env *env, bool child_writes) {
+	if(com.type != TYPE_STR)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	memory_region *tmp_region = NEW_REGION();
+	
+	lstring com_str = { .str = com.str_v->str, .len = com.str_v->len };
+	char **arg_strs = int_prepare_command(com_str, args, n_args, env, tmp_region);
+	
+	if(arg_strs == NULL) {
+		free_memory_region(tmp_region);
+		return (struct r_val) { .type = TYPE_NULL };
+	}
+	
+	int fds[2];
+	if(pipe(fds)) {
+		fprintf(int_get_errout(env), "Unable to create pipe: %s\n", strerror(errno));
+		free_memory_region(tmp_region);
+		return (struct r_val) { .type = TYPE_NULL };
+	}
+	
+	int child_end = child_writes ? fds[1] : fds[0];
+	int parent_end = child_writes ? fds[0] : fds[1];
+	
+	fflush(stdout);
+	
+	pid_t pid = fork();
+	switch(pid) {
+		case -1:
+			fprintf(int_get_errout(env), "Unable to fork: %s\n", strerror(errno));
+			close(fds[0]);
+			close(fds[1]);
+			free_memory_region(tmp_region);
+			return (struct r_val) { .type = TYPE_NULL };
+		
+		case 0:
+			int_close_pending_fds();
+			close(parent_end);
+			dup2(child_end, child_writes ? STDOUT_FILENO : STDIN_FILENO);
+			close(child_end);
+			
+			int_reset_exec_signals();
+			int_apply_exec_limits(env);
+			execvp(arg_strs[0], arg_strs);
+			
+			fprintf(int_get_errout(env), "Unable to exec '%s': %s\n", arg_strs[0], strerror(errno));
+			exit(-1);
+		
+		default:
+			break;
+	}
+	
+	free_memory_region(tmp_region);
+	close(child_end);
+	int_add_pending_proc(pid, parent_end);
+	
+	char path[32];
+	snprintf(path, sizeof(path), "/dev/fd/%i", parent_end);
+	
+	return (struct r_val) { .type = TYPE_STR, .str_v = cstr_to_rstring(path) };
+}
+
+DECL_R_OP(psub) {
+	return process_substitution(args[0], args + 1, n_args - 1, env, true);
+}
+
+DECL_R_OP(psub_in) {
+	return process_substitution(args[0], args + 1, n_args - 1, env, false);
+}
+
+//---------------------------- Resource limits
+
+#include "../parser/parser_fmt.h"
+
+static bool parse_core_mask(struct r_val v, unsigned long long *mask) {
+	if(v.type == TYPE_INT) {
+		if(v.int_v < 0 || v.int_v >= 64)
+			return false;
+		*mask = 1ULL << v.int_v;
+		return true;
+	}
+	
+	if(v.type != TYPE_ARRAY)
+		return false;
+	
+	*mask = 0;
+	for(unsigned i = 0; i < v.array_v->len; i++) {
+		struct r_val core = v.array_v->items[i];
+		if(core.type != TYPE_INT || core.int_v < 0 || core.int_v >= 64)
+			return false;
+		*mask |= 1ULL << core.int_v;
+	}
+	return true;
+}
+
+/*
+(restrict key value ... expr) evaluates expr (like open, the result is discarded) with the given limits applied to every external command run during its evaluation.
+Limits that aren't given are inherited from any enclosing restrict. Keys:
+	timeout	wall clock time in milliseconds, after which the command is killed
+	mem	address space limit in bytes
+	cpu	cpu time limit in seconds
+	nice	niceness increment
+	cores	core (or array of cores) to pin the command to
+*/
+DECL_OP(restrict) {
+	if(n_args % 2 != 1) {
+		fputs("restrict: expected key value pairs followed by an expression\n", int_get_errout(env));
+		return (struct r_val) { .type = TYPE_NULL };
+	}
+	
+	struct exec_limits limits = *int_get_exec_limits(env);
+	
+	for(unsigned i = 0; i + 1 < n_args; i += 2) {
+		if(args[i]->type != PNODE_SYM) {
+			fmt_blame_parse_node(int_get_errout(env), "Expected limit name, got %", args[i], get_static_src(), src_name);
+			return (struct r_val) { .type = TYPE_NULL };
+		}
+		
+		lstring key = args[i]->str;
+		struct r_val v = int_eval_expr(args[i + 1], env, src_name);
+		bool ok = true;
+		
+		if(lstring_cmp(&key, &LSTRING("cores"))) {
+			ok = parse_core_mask(v, &limits.cores);
+		} else if(v.type != TYPE_INT || v.int_v < 0) {
+			ok = lstring_cmp(&key, &LSTRING("nice")) && v.type == TYPE_INT;
+			if(ok) {
+				limits.nice = v.int_v;
+				limits.set_nice = true;
+			}
+		} else if(lstring_cmp(&key, &LSTRING("timeout"))) {
+			limits.timeout_ms = v.int_v;
+		} else if(lstring_cmp(&key, &LSTRING("mem"))) {
+			limits.mem_bytes = v.int_v;
+		} else if(lstring_cmp(&key, &LSTRING("cpu"))) {
+			limits.cpu_secs = v.int_v;
+		} else if(lstring_cmp(&key, &LSTRING("nice"))) {
+			limits.nice = v.int_v;
+			limits.set_nice = true;
+		} else {
+			ok = false;
+		}
+		
+		int_decr_refcount(v);
+		
+		if(!ok) {
+			fmt_blame_parse_node(int_get_errout(env), "Invalid limit '%'", args[i], get_static_src(), src_name);
+			return (struct r_val) { .type = TYPE_NULL };
+		}
+	}
+	
+	struct exec_limits restore = int_set_exec_limits(env, limits);
+	struct r_val res = int_eval_expr(args[n_args - 1], env, src_name);
+	int_decr_refcount(res);
+	int_set_exec_limits(env, restore);
+	
+	return (struct r_val) { .type = TYPE_NULL };
+}
+
+//---------------------------- Command statistics
+
+//Evaluates to (status wall-us user-us sys-us max-rss-kb minor-faults major-faults) for the last external command
+DECL_R_OP(exec_stats) {
+	const struct exec_stats *stats = int_get_last_exec(env);
+	
+	r_int fields[] = { stats->status, stats->wall_us, stats->user_us, stats->sys_us, stats->max_rss_kb, stats->minor_faults, stats->major_faults };
+	
+	struct r_array *res = int_new_array(LENOF(fields));
+	
+	for(unsigned i = 0; i < LENOF(fields); i++)
+		res->items[i] = (struct r_val) { .type = TYPE_INT, .int_v = fields[i] };
+	
+	return (struct r_val) { .type = TYPE_ARRAY, .array_v = res };
+}
+
+//---------------------------- Result cache
+
+/*
+(cached inputs env-vars com args...) runs com like an ordinary external command, but keeps its stdout and exit status in a cache
+directory keyed by a hash of the working directory, the argument vector, the values of the named environment variables and the
+contents of the input files. If the same key is seen again the output is replayed instead of running the command. Commands that
+couldn't be run, were killed, timed out or denied are never cached. The cache lives in $WHIPPET_CACHE_DIR, $XDG_CACHE_HOME/whippet
+or ~/.cache/whippet.
+*/
+
+#include <sys/stat.h>
+
+struct cache_key {
+	unsigned long long h[2];
+};
+
+static void cache_hash(struct cache_key *key, const void *data, size_t len) {
+	key->h[0] = hash_bytes(data, len, key->h[0]);
+	key->h[1] = hash_bytes(data, len, key->h[1] ^ 0x5851F42D4C957F2DULL);
+}
+
+static void cache_hash_cstr(struct cache_key *key, const char *str) {
+	cache_hash(key, str, strlen(str) + 1); //Including the terminator, so that ("ab" "c") and ("a" "bc") differ
+}
+
+static void cache_hash_file(struct cache_key *key, const char *path) {
+	cache_hash_cstr(key, path);
+	
+	FILE *f = fopen(path, "rb");
+	if(f == NULL) {
+		cache_hash_cstr(key, "\x01missing");
+		return;
+	}
+	
+	char buff[1 << 16];
+	size_t n;
+	while( (n = fread(buff, 1, sizeof(buff), f)) != 0 )
+		cache_hash(key, buff, n);
+	
+	fclose(f);
+}
+
+static bool make_dirs(char *path) {
+	for(char *c = path + 1; *c != '\0'; c++) {
+		if(*c != '/')
+			continue;
+		
+		*c = '\0';
+		int res = mkdir(path, 0755);
+		*c = '/';
+		if(res && errno != EEXIST)
+			return false;
+	}
+	
+	return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+static char *get_cache_dir() {
+	const char *dir = getenv("WHIPPET_CACHE_DIR");
+	const char *suffix = "";
+	
+	if(dir == NULL) {
+		dir = getenv("XDG_CACHE_HOME");
+		suffix = "/whippet";
+	}
+	if(dir == NULL) {
+		dir = getenv("HOME");
+		suffix = "/.cache/whippet";
+	}
+	if(dir == NULL)
+		return NULL;
+	
+	size_t len = strlen(dir) + strlen(suffix) + 1;
+	char *path = s_alloc(len);
+	snprintf(path, len, "%s%s", dir, suffix);
+	
+	if(!make_dirs(path)) {
+		s_dealloc(path);
+		return NULL;
+	}
+	
+	return path;
+}
+
+static bool copy_file_to(const char *path, FILE *to) {
+	FILE *f = fopen(path, "rb");
+	if(f == NULL)
+		return false;
+	
+	char buff[1 << 16];
+	size_t n;
+	while( (n = fread(buff, 1, sizeof(buff), f)) != 0 )
+		fwrite(buff, 1, n, to);
+	
+	fclose(f);
+	fflush(to);
+	return true;
+}
+
+static bool get_str_array(struct r_val v, struct r_val **items, unsigned *n) {
+	switch(v.type) {
+		case TYPE_NULL:
+			*n = 0;
+			return true;
+		
+		case TYPE_ARRAY:
+			for(unsigned i = 0; i < v.array_v->len; i++) {
+				if(v.array_v->items[i].type != TYPE_STR)
+					return false;
+			}
+			*items = v.array_v->items;
+			*n = v.array_v->len;
+			return true;
+		
+		default:
+			return false;
+	}
+}
+
+//Accepts a single string, an array of strings or Null (no strings)
+static bool get_str_list(struct r_val *v, struct r_val **items, unsigned *n) {
+	if(v->type == TYPE_STR) {
+		*items = v;
+		*n = 1;
+		return true;
+	}
+	
+	return get_str_array(*v, items, n);
+}
+
+DECL_R_OP(cached) {
+	struct r_val *inputs, *env_vars;
+	unsigned n_inputs, n_env_vars;
+	
+	if(!get_str_list(&args[0], &inputs, &n_inputs)) {
+		fputs("cached: expected an array of input paths\n", int_get_errout(env));
+		return (struct r_val) { .type = TYPE_NULL };
+	}
+	
+	if(!get_str_list(&args[1], &env_vars, &n_env_vars)) {
+		fputs("cached: expected an array of environment variable names\n", int_get_errout(env));
+		return (struct r_val) { .type = TYPE_NULL };
+	}
+	
+	if(args[2].type != TYPE_STR)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	lstring com_str = { .str = args[2].str_v->str, .len = args[2].str_v->len };
+	struct r_val *com_args = args + 3;
+	unsigned n_com_args = n_args - 3;
+	
+	memory_region *tmp_region = NEW_REGION();
+	
+	char **arg_strs = int_exec_args(com_str, com_args, n_com_args, tmp_region);
+	if(arg_strs == NULL) {
+		fputs("cached: arguments dont fit into the string buffer\n", int_get_errout(env));
+		free_memory_region(tmp_region);
+		return (struct r_val) { .type = TYPE_NULL };
+	}
+	
+	struct cache_key key = { .h = { 0xCBF29CE484222325ULL, 0x84222325CBF29CE4ULL } };
+	cache_hash_cstr(&key, "whippet-cache-v1");
+	
+	char cwd[1024];
+	if(getcwd(cwd, sizeof(cwd)))
+		cache_hash_cstr(&key, cwd);
+	
+	for(char **a = arg_strs; *a != NULL; a++)
+		cache_hash_cstr(&key, *a);
+	
+	for(unsigned i = 0; i < n_env_vars; i++) {
+		char *name = r_string_to_cstr(env_vars[i].str_v);
+		const char *val = getenv(name);
+		cache_hash_cstr(&key, name);
+		cache_hash_cstr(&key, val != NULL ? val : "\x01unset");
+		s_dealloc(name);
+	}
+	
+	for(unsigned i = 0; i < n_inputs; i++) {
+		char *path = r_string_to_cstr(inputs[i].str_v);
+		cache_hash_file(&key, path);
+		s_dealloc(path);
+	}
+	
+	free_memory_region(tmp_region);
+	
+	char *dir = get_cache_dir();
+	if(dir == NULL) { //Without a usable cache directory the command is simply run
+		fputs("cached: unable to create cache directory, running uncached\n", int_get_errout(env));
+		int_exec_command(env, com_str, com_args, n_com_args, -1);
+		return (struct r_val) { .type = TYPE_NULL };
+	}
+	
+	size_t path_len = strlen(dir) + 64;
+	char *out_path = s_alloc(path_len), *status_path = s_alloc(path_len), *tmp_path = s_alloc(path_len);
+	snprintf(out_path, path_len, "%s/%016llx%016llx.out", dir, key.h[0], key.h[1]);
+	snprintf(status_path, path_len, "%s/%016llx%016llx.status", dir, key.h[0], key.h[1]);
+	snprintf(tmp_path, path_len, "%s/%016llx%016llx.%i", dir, key.h[0], key.h[1], (int) getpid());
+	s_dealloc(dir);
+	
+	FILE *out = int_get_stdout(env);
+	fflush(out);
+	
+	int status = -1;
+	FILE *status_f = fopen(status_path, "r");
+	
+	if(status_f != NULL && fscanf(status_f, "%i", &status) == 1 && copy_file_to(out_path, out)) {
+		//Cache hit
+		fclose(status_f);
+		struct exec_stats stats = { .status = status };
+		int_set_last_exec(env, &stats);
+	} else {
+		if(status_f != NULL)
+			fclose(status_f);
+		
+		int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if(fd == -1) {
+			fprintf(int_get_errout(env), "cached: unable to create '%s': %s\n", tmp_path, strerror(errno));
+			int_exec_command(env, com_str, com_args, n_com_args, -1);
+		} else {
+			status = int_exec_command(env, com_str, com_args, n_com_args, fd);
+			close(fd);
+			
+			copy_file_to(tmp_path, out);
+			
+			//The status is written before the output is moved into place, so a hit always finds both
+			if(status >= 0 && (status_f = fopen(status_path, "w")) != NULL) {
+				fprintf(status_f, "%i\n", status);
+				fclose(status_f);
+				rename(tmp_path, out_path);
+			} else {
+				unlink(tmp_path);
+			}
+		}
+	}
+	
+	s_dealloc(out_path);
+	s_dealloc(status_path);
+	s_dealloc(tmp_path);
+	
+	return (struct r_val) { .type = TYPE_NULL };
+}
+
+//---------------------------- Event loop
+
+/*
+watch starts every given command at once (each one given as an array of the command and its arguments) and multiplexes their
+stdout and stderr through a single epoll instance. The callback is called as (fn i stream line) for each complete line as it arrives,
+where stream is either out or err, and as (fn i exit status) once the i:th command has exited. Exits are observed through pidfds when
+the kernel supports them, otherwise the child is reaped once both of its pipes are closed.
+*/
+
+#ifdef __linux__
+
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+
+#define WATCH_READ_SIZE 4096
+
+struct watch_stream {
+	int fd;
+	char *buff;
+	size_t len, cap;
+};
+
+struct watched_proc {
+	pid_t pid;
+	int pidfd, status;
+	bool exited;
+	struct watch_stream streams[2];
+};
+
+enum { WATCH_OUT, WATCH_ERR, WATCH_EXIT };
+
+static int open_pidfd(pid_t pid) {
+	#ifdef SYS_pidfd_open
+		return syscall(SYS_pidfd_open, pid, 0);
+	#else
+		errno = ENOSYS;
+		return -1;
+	#endif
+}
+
+static struct r_val watch_event_str(int kind) {
+	switch(kind) {
+		case WATCH_OUT:
+			return (struct r_val) { .type = TYPE_STR, .str_v = cstr_to_rstring("out") };
+		case WATCH_ERR:
+			return (struct r_val) { .type = TYPE_STR, .str_v = cstr_to_rstring("err") };
+		default:
+			return (struct r_val) { .type = TYPE_STR, .str_v = cstr_to_rstring("exit") };
+	}
+}
+
+static void watch_callback(struct r_val fn, unsigned proc_i, int kind, struct r_val v, struct interp_env *env, const char *src_name) {
+	struct r_val cb_args[3] = {
+		{ .type = TYPE_INT, .int_v = proc_i },
+		watch_event_str(kind),
+		v
+	};
+	
+	struct r_val res = int_call_r_fn(fn, cb_args, 3, env, src_name);
+	int_decr_refcount(res);
+	
+	int_decr_refcount(cb_args[1]);
+}
+
+static void watch_emit_line(struct r_val fn, unsigned proc_i, int kind, const char *line, size_t len, struct interp_env *env, const char *src_name) {
+	struct r_val v = { .type = TYPE_STR, .str_v = int_new_string(line, len) };
+	watch_callback(fn, proc_i, kind, v, env, src_name);
+	int_decr_refcount(v);
+}
+
+//Reads what is available from the stream and emits every complete line; returns false once the stream has reached its end
+static bool watch_read_stream(struct watch_stream *stream, struct r_val fn, unsigned proc_i, int kind, struct interp_env *env, const char *src_name) {
+	if(stream->cap - stream->len < WATCH_READ_SIZE) {
+		stream->cap = stream->cap * 2 + WATCH_READ_SIZE;
+		stream->buff = s_realloc(stream->buff, stream->cap);
+	}
+	
+	ssize_t n = read(stream->fd, stream->buff + stream->len, WATCH_READ_SIZE);
+	if(n < 0 && (errno == EINTR || errno == EAGAIN))
+		return true;
+	
+	if(n <= 0) {
+		if(stream->len != 0) //Emit the last line even if it wasn't terminated
+			watch_emit_line(fn, proc_i, kind, stream->buff, stream->len, env, src_name);
+		stream->len = 0;
+		return false;
+	}
+	
+	char *line_start = stream->buff;
+	char *scan = stream->buff + stream->len;
+	char *end = scan + n;
+	
+	char *nl;
+	while( (nl = memchr(scan, '\n', end - scan)) != NULL ) {
+		watch_emit_line(fn, proc_i, kind, line_start, nl - line_start, env, src_name);
+		line_start = nl + 1;
+		scan = line_start;
+	}
+	
+	stream->len = end - line_start;
+	memmove(stream->buff, line_start, stream->len);
+	
+	return true;
+}
+
+static int start_watched_proc(struct watched_proc *proc, struct r_val com, struct interp_env *env) {
+	if(com.type != TYPE_ARRAY || com.array_v->len == 0 || com.array_v->items[0].type != TYPE_STR)
+		return -1;
+	
+	memory_region *tmp_region = NEW_REGION();
+	
+	struct r_string *com_name = com.array_v->items[0].str_v;
+	lstring com_str = { .str = com_name->str, .len = com_name->len };
+	char **arg_strs = int_prepare_command(com_str, com.array_v->items + 1, com.array_v->len - 1, env, tmp_region);
+	
+	if(arg_strs == NULL) {
+		free_memory_region(tmp_region);
+		return -1;
+	}
+	
+	int out_pipe[2], err_pipe[2];
+	if(pipe(out_pipe)) {
+		free_memory_region(tmp_region);
+		return -1;
+	}
+	if(pipe(err_pipe)) {
+		close(out_pipe[0]);
+		close(out_pipe[1]);
+		free_memory_region(tmp_region);
+		return -1;
+	}
+	
+	fcntl(out_pipe[0], F_SETFD, FD_CLOEXEC);
+	fcntl(err_pipe[0], F_SETFD, FD_CLOEXEC);
+	
+	fflush(stdout);
+	
+	pid_t pid = fork();
+	switch(pid) {
+		case -1:
+			close(out_pipe[0]);
+			close(out_pipe[1]);
+			close(err_pipe[0]);
+			close(err_pipe[1]);
+			free_memory_region(tmp_region);
+			return -1;
+		
+		case 0:
+			dup2(out_pipe[1], STDOUT_FILENO);
+			dup2(err_pipe[1], STDERR_FILENO);
+			close(out_pipe[1]);
+			close(err_pipe[1]);
+			
+			if(int_get_stdin(env) != stdin)
+				dup2(fileno(int_get_stdin(env)), STDIN_FILENO);
+			
+			int_reset_exec_signals();
+			int_apply_exec_limits(env);
+			execvp(arg_strs[0], arg_strs);
+			
+			fprintf(stderr, "Unable to exec '%s': %s\n", arg_strs[0], strerror(errno));
+			exit(-1);
+		
+		default:
+			break;
+	}
+	
+	free_memory_region(tmp_region);
+	close(out_pipe[1]);
+	close(err_pipe[1]);
+	
+	proc->pid = pid;
+	proc->pidfd = open_pidfd(pid);
+	proc->exited = false;
+	proc->status = -1;
+	proc->streams[WATCH_OUT] = (struct watch_stream) { .fd = out_pipe[0] };
+	proc->streams[WATCH_ERR] = (struct watch_stream) { .fd = err_pipe[0] };
+	
+	return 0;
+}
+
+static int reap_watched_proc(struct watched_proc *proc) {
+	int status;
+	while(waitpid(proc->pid, &status, 0) == -1) {
+		if(errno != EINTR)
+			return -1;
+	}
+	
+	if(WIFEXITED(status))
+		return WEXITSTATUS(status);
+	
+	return -2;
+}
+
+//epoll events carry the process index and the kind of fd packed into a single value
+#define WATCH_EVENT_DATA(proc_i, kind) ( ((uint64_t) (proc_i) << 2) | (kind) )
+
+DECL_R_OP(watch) {
+	struct r_val fn = args[0];
+	unsigned n_procs = n_args - 1;
+	
+	int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if(epoll_fd == -1) {
+		fprintf(int_get_errout(env), "Unable to create epoll instance: %s\n", strerror(errno));
+		return (struct r_val) { .type = TYPE_NULL };
+	}
+	
+	struct watched_proc *procs = NSALLOC(struct watched_proc, n_procs);
+	unsigned n_started = 0, n_open = 0; //n_open is the number of fds and pidfds that still have to be closed before the loop is done
+	
+	for(; n_started < n_procs; n_started++) {
+		struct watched_proc *proc = &procs[n_started];
+		
+		if(start_watched_proc(proc, args[n_started + 1], env)) {
+			fprintf(int_get_errout(env), "Unable to start watched command %u\n", n_started);
+			break;
+		}
+		
+		for(int k = WATCH_OUT; k <= WATCH_ERR; k++) {
+			struct epoll_event ev = { .events = EPOLLIN, .data.u64 = WATCH_EVENT_DATA(n_started, k) };
+			epoll_ctl(epoll_fd, EPOLL_CTL_ADD, proc->streams[k].fd, &ev);
+			n_open++;
+		}
+		
+		if(proc->pidfd != -1) {
+			struct epoll_event ev = { .events = EPOLLIN, .data.u64 = WATCH_EVENT_DATA(n_started, WATCH_EXIT) };
+			epoll_ctl(epoll_fd, EPOLL_CTL_ADD, proc->pidfd, &ev);
+			n_open++;
+		}
+	}
+	
+	#define WATCH_MAX_EVENTS 32
+	struct epoll_event events[WATCH_MAX_EVENTS];
+	
+	while(n_open > 0) {
+		int n_ev = epoll_wait(epoll_fd, events, WATCH_MAX_EVENTS, -1);
+		if(n_ev == -1) {
+			if(errno == EINTR)
+				continue;
+			fprintf(int_get_errout(env), "epoll_wait failed: %s\n", strerror(errno));
+			break;
+		}
+		
+		for(int e = 0; e < n_ev; e++) {
+			unsigned proc_i = events[e].data.u64 >> 2;
+			int kind = events[e].data.u64 & 3;
+			struct watched_proc *proc = &procs[proc_i];
+			
+			if(kind == WATCH_EXIT) {
+				epoll_ctl(epoll_fd, EPOLL_CTL_DEL, proc->pidfd, NULL);
+				close(proc->pidfd);
+				proc->pidfd = -1;
+				n_open--;
+				
+				//Output that was written before the exit may still be unread, the exit callback waits until the pipes are drained
+				proc->status = reap_watched_proc(proc);
+				proc->exited = true;
+			} else {
+				struct watch_stream *stream = &proc->streams[kind];
+				if(stream->fd == -1)
+					continue;
+				
+				if(!watch_read_stream(stream, fn, proc_i, kind, env, src_name)) {
+					epoll_ctl(epoll_fd, EPOLL_CTL_DEL, stream->fd, NULL);
+					close(stream->fd);
+					stream->fd = -1;
+					n_open--;
+				}
+			}
+			
+			bool drained = proc->streams[WATCH_OUT].fd == -1 && proc->streams[WATCH_ERR].fd == -1;
+			
+			if(drained && proc->pidfd == -1) {
+				if(!proc->exited) { //No pidfd support, or the exit hasn't been reported yet
+					proc->status = reap_watched_proc(proc);
+					proc->exited = true;
+				}
+				
+				if(proc->pid != -1) {
+					proc->pid = -1;
+					watch_callback(fn, proc_i, WATCH_EXIT, (struct r_val) { .type = TYPE_INT, .int_v = proc->status }, env, src_name);
+				}
+			}
+		}
+	}
+	
+	close(epoll_fd);
+	
+	struct r_array *statuses = int_new_array(n_started);
+	
+	for(unsigned i = 0; i < n_started; i++) {
+		statuses->items[i] = (struct r_val) { .type = TYPE_INT, .int_v = procs[i].status };
+		s_dealloc(procs[i].streams[WATCH_OUT].buff);
+		s_dealloc(procs[i].streams[WATCH_ERR].buff);
+	}
+	
+	s_dealloc(procs);
+	
+	return (struct r_val) { .type = TYPE_ARRAY, .array_v = statuses };
+}
+
+#else
+
+DECL_R_OP(watch) {
+	fputs("watch: not supported on this platform\n", int_get_errout(env));
+	return (struct r_val) { .type = TYPE_NULL };
+}
+
+#endif
+
+static struct rlib_op ops[] = {
+	DEF_R_OP(coproc, "coproc", -2),
+	DEF_R_OP(coproc_pool, "coproc-pool", -3),
+	DEF_R_OP(coproc_write, "coproc-write", -2),
+	DEF_R_OP(coproc_readline, "coproc-readline", 1),
+	DEF_R_OP(coproc_call, "coproc-call", -2),
+	DEF_R_OP(coproc_close, "coproc-close", 1),
+	
+	DEF_R_OP(psub, "psub", -2),
+	DEF_R_OP(psub_in, "psub-in", -2),
+	
+	DEF_OP(restrict, "restrict", -2),
+	DEF_R_OP(exec_stats, "exec-stats", 0),
+	DEF_R_OP(cached, "cached", -4),
+	
+	DEF_R_OP(watch, "watch", -2)
+};
+
+static char loaded = 0;
+
+void rlib_proc_load() {
+	if(loaded)
+		return;
+	
+	loaded = 1;
+	LOAD_RLIB(ops);
+}
+
+void rlib_proc_put(struct interp_env *env) {
+	PUT_RLIB(ops, env);
+}
@@ -0,0 +1,10 @@
+#ifndef RLIB_PROC_H_INCLUDED
+#define RLIB_PROC_H_INCLUDED
+
+#include "../interpreter/interpreter.h"
+
+void rlib_proc_load();
+
+void rlib_proc_put(struct interp_env *env);
+
+#endif
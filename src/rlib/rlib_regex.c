@@ -0,0 +1,221 @@
+#include "rlib_regex.h"
+
+#include "rlib.h"
+
+#include "../proj_utils.h"
+#include "../regex/regex.h"
+
+#include <string.h>
+
+/*
+(regex pattern) compiles a pattern into a value that can be called with a string, or given to filter, to test whether it matches.
+(match pattern str), (find-all pattern str) and (replace pattern str replacement) take either such a value or the pattern itself.
+Patterns written as literals are compiled once and cached by their parse node, together with a copy of the text since the
+prompt reuses parse nodes once it frees a line.
+*/
+
+struct cached_regex {
+	const struct parse_node *node;
+	char *text;
+	unsigned text_len;
+	struct r_val regex;
+};
+
+#define REGEX_CACHE_SIZE 64
+
+static struct cached_regex regex_cache[REGEX_CACHE_SIZE];
+
+static struct r_val compile_regex(const char *pattern, size_t len, struct interp_env *env) {
+	const char *err;
+	struct regex *re = regex_compile(pattern, len, &err);
+	if(re == NULL) {
+		FILE *err_out = int_get_errout(env);
+		fputs("Invalid regex '", err_out);
+		print_len_str(err_out, pattern, len);
+		fprintf(err_out, "': %s\n", err);
+		return (struct r_val) { .type = TYPE_NULL };
+	}
+	
+	struct r_regex *r = SALLOC(struct r_regex);
+	r->ref_c = 1;
+	r->re = re;
+	return (struct r_val) { .type = TYPE_REGEX, .regex_v = r };
+}
+
+static struct r_val get_cached_regex(const struct parse_node *node, struct interp_env *env) {
+	struct cached_regex *entry = &regex_cache[hash_bytes(&node, sizeof(node), 0) % REGEX_CACHE_SIZE];
+	
+	if(entry->node == node && cmp_len_strs(entry->text, entry->text_len, node->str.str, node->str.len)) {
+		int_incr_refcount(entry->regex);
+		return entry->regex;
+	}
+	
+	struct r_val regex = compile_regex(node->str.str, node->str.len, env);
+	if(regex.type == TYPE_NULL)
+		return regex;
+	
+	if(entry->node != NULL) {
+		s_dealloc(entry->text);
+		int_decr_refcount(entry->regex);
+	}
+	
+	entry->node = node;
+	entry->text_len = node->str.len;
+	entry->text = s_alloc(node->str.len);
+	memcpy(entry->text, node->str.str, node->str.len);
+	entry->regex = regex;
+	
+	int_incr_refcount(regex);
+	return regex;
+}
+
+//Returns an owned TYPE_REGEX value, or null after reporting why
+static struct r_val eval_regex(struct parse_node *arg, struct interp_env *env, const char *src_name) {
+	if(arg->type == PNODE_SYM)
+		return get_cached_regex(arg, env);
+	
+	struct r_val v = int_eval_expr(arg, env, src_name);
+	
+	switch(v.type) {
+		case TYPE_REGEX:
+			return v;
+		
+		case TYPE_STR: {
+			struct r_val regex = compile_regex(v.str_v->str, v.str_v->len, env);
+			int_decr_refcount(v);
+			return regex;
+		}
+		
+		default:
+			int_decr_refcount(v);
+			return (struct r_val) { .type = TYPE_NULL };
+	}
+}
+
+DECL_OP(regex) {
+	return rlib_op_result(eval_regex(args[0], env, src_name));
+}
+
+DECL_OP(match) {
+	struct r_val regex = eval_regex(args[0], env, src_name);
+	struct r_val str = int_eval_expr(args[1], env, src_name);
+	
+	struct r_val res = { .type = TYPE_NULL };
+	if(regex.type == TYPE_REGEX && str.type == TYPE_STR)
+		res = (struct r_val) { .type = TYPE_INT, .int_v = regex_is_match(regex.regex_v->re, str.str_v->str, str.str_v->len) };
+	
+	int_decr_refcount(regex);
+	int_decr_refcount(str);
+	return res;
+}
+
+//Steps past an empty match so that the search always moves forward
+static size_t next_search_pos(size_t start, size_t end) {
+	return end > start ? end : end + 1;
+}
+
+DECL_OP(find_all) {
+	struct r_val regex = eval_regex(args[0], env, src_name);
+	struct r_val str = int_eval_expr(args[1], env, src_name);
+	
+	struct r_val res = { .type = TYPE_NULL };
+	if(regex.type != TYPE_REGEX || str.type != TYPE_STR)
+		goto EXIT;
+	
+	struct { struct r_val *items; unsigned len, cap; } found = { .len = 0, .cap = 4 };
+	found.items = NSALLOC(struct r_val, found.cap);
+	
+	size_t pos = 0, start, end;
+	while(regex_find(regex.regex_v->re, str.str_v->str, str.str_v->len, pos, &start, &end)) {
+		if(found.len == found.cap) {
+			found.cap *= 2;
+			found.items = SREALLOC(struct r_val, found.items, found.cap);
+		}
+		found.items[found.len++] = (struct r_val) { .type = TYPE_STR, .str_v = int_string_slice(str.str_v, start, end - start) };
+		
+		pos = next_search_pos(start, end);
+	}
+	
+	struct r_array *array = int_new_array(found.len);
+	memcpy(array->items, found.items, sizeof(struct r_val) * found.len);
+	s_dealloc(found.items);
+	
+	res = rlib_op_result((struct r_val) { .type = TYPE_ARRAY, .array_v = array });
+	
+	EXIT:
+	int_decr_refcount(regex);
+	int_decr_refcount(str);
+	return res;
+}
+
+DECL_OP(replace) {
+	struct r_val regex = eval_regex(args[0], env, src_name);
+	struct r_val str = int_eval_expr(args[1], env, src_name);
+	struct r_val with = int_eval_expr(args[2], env, src_name);
+	
+	struct r_val res = { .type = TYPE_NULL };
+	if(regex.type != TYPE_REGEX || str.type != TYPE_STR || with.type != TYPE_STR)
+		goto EXIT;
+	
+	const struct r_string *s = str.str_v;
+	struct { size_t *items; unsigned len, cap; } matches = { .len = 0, .cap = 8 };
+	matches.items = NSALLOC(size_t, matches.cap);
+	
+	//Collect the match bounds first so the result can be allocated at its exact size
+	size_t pos = 0, start, end, len = s->len;
+	while(regex_find(regex.regex_v->re, s->str, s->len, pos, &start, &end)) {
+		if(matches.len + 2 > matches.cap) {
+			matches.cap *= 2;
+			matches.items = SREALLOC(size_t, matches.items, matches.cap);
+		}
+		matches.items[matches.len++] = start;
+		matches.items[matches.len++] = end;
+		len = len - (end - start) + with.str_v->len;
+		
+		pos = next_search_pos(start, end);
+	}
+	
+	struct r_string *out = int_new_string(NULL, len);
+	char *top = out->data;
+	size_t copied = 0;
+	
+	for(unsigned i = 0; i < matches.len; i += 2) {
+		memcpy(top, s->str + copied, matches.items[i] - copied);
+		top += matches.items[i] - copied;
+		memcpy(top, with.str_v->str, with.str_v->len);
+		top += with.str_v->len;
+		copied = matches.items[i + 1];
+	}
+	memcpy(top, s->str + copied, s->len - copied);
+	
+	s_dealloc(matches.items);
+	
+	res = rlib_op_result((struct r_val) { .type = TYPE_STR, .str_v = out });
+	
+	EXIT:
+	int_decr_refcount(regex);
+	int_decr_refcount(str);
+	int_decr_refcount(with);
+	return res;
+}
+
+static struct rlib_op ops[] = {
+	DEF_OP(regex, "regex", 1),
+	DEF_OP(match, "match", 2),
+	DEF_OP(find_all, "find-all", 2),
+	DEF_OP(replace, "replace", 3)
+};
+
+static char loaded = 0;
+
+void rlib_regex_load() {
+	if(loaded)
+		return;
+	
+	loaded = 1;
+	LOAD_RLIB(ops);
+}
+
+void rlib_regex_put(struct interp_env *env) {
+	PUT_RLIB(ops, env);
+}
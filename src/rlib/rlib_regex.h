@@ -0,0 +1,10 @@
+#ifndef RLIB_REGEX_H_INCLUDED
+#define RLIB_REGEX_H_INCLUDED
+
+#include "../interpreter/interpreter.h"
+
+void rlib_regex_load();
+
+void rlib_regex_put(struct interp_env *env);
+
+#endif
@@ -0,0 +1,216 @@
+#include "rlib_sort.h"
+
+#include "rlib.h"
+
+#include "../sort.h"
+#include "../interpreter/interpreter_intvec.h"
+#include "../interpreter/interpreter_iter.h"
+
+#include <string.h>
+
+/*
+ * (sort coll), (sort-desc coll) and (sort-by coll fn), all stable. Sorting picks its kernel from the keys: a radix sort
+ * when they are all ints, a string sort when they are all strings and a merge sort on r_vals_order otherwise. Packed
+ * int arrays stay packed; iterators and ranges are collected into arrays first.
+ */
+
+#define NULL_VAL ((struct r_val) { .type = TYPE_NULL })
+
+//Descending sorts fill the kernels' input back to front, sort it ascending and read it back to front, which keeps
+//equal items in their original order
+static inline unsigned item_at(unsigned pos, unsigned n, bool desc) {
+	return desc ? n - 1 - pos : pos;
+}
+
+struct order_ctx {
+	const struct r_val *keys;
+	unsigned n;
+	bool desc;
+};
+
+static int cmp_keys(const void *a, const void *b, void *ctx) {
+	const struct order_ctx *o = ctx;
+	unsigned pos_a = *(const unsigned *) a, pos_b = *(const unsigned *) b;
+	return r_vals_order(o->keys[item_at(pos_a, o->n, o->desc)], o->keys[item_at(pos_b, o->n, o->desc)]);
+}
+
+static bool all_of_type(const struct r_val *keys, unsigned n, unsigned char type) {
+	for(unsigned i = 0; i < n; i++) {
+		if(keys[i].type != type)
+			return false;
+	}
+	return true;
+}
+
+//The indices of the items in sorted order
+static unsigned *sort_order(const struct r_val *keys, unsigned n, bool desc) {
+	unsigned *pos = NSALLOC(unsigned, n + 1);
+	
+	if(all_of_type(keys, n, TYPE_INT)) {
+		r_int *ints = NSALLOC(r_int, n + 1);
+		for(unsigned i = 0; i < n; i++) {
+			ints[i] = keys[item_at(i, n, desc)].int_v;
+			pos[i] = i;
+		}
+		
+		sort_ints(ints, pos, n);
+		s_dealloc(ints);
+	} else if(all_of_type(keys, n, TYPE_STR)) {
+		struct sort_str *strs = NSALLOC(struct sort_str, n + 1);
+		for(unsigned i = 0; i < n; i++) {
+			const struct r_string *str = keys[item_at(i, n, desc)].str_v;
+			strs[i] = (struct sort_str) { .str = str->str, .len = str->len, .idx = i };
+		}
+		
+		sort_strs(strs, n);
+		for(unsigned i = 0; i < n; i++)
+			pos[i] = strs[i].idx;
+		s_dealloc(strs);
+	} else {
+		for(unsigned i = 0; i < n; i++)
+			pos[i] = i;
+		
+		struct order_ctx ctx = { .keys = keys, .n = n, .desc = desc };
+		sort_stable(pos, n, sizeof(unsigned), cmp_keys, &ctx);
+	}
+	
+	unsigned *order = NSALLOC(unsigned, n + 1);
+	for(unsigned i = 0; i < n; i++)
+		order[i] = item_at(pos[item_at(i, n, desc)], n, desc);
+	
+	s_dealloc(pos);
+	return order;
+}
+
+//The items of a temporary array are moved rather than copied
+static struct r_val sorted_array(struct r_val arg, const struct r_val *keys, bool desc) {
+	struct r_array *src = arg.array_v;
+	unsigned *order = sort_order(keys, src->len, desc);
+	
+	struct r_array *array;
+	if(rlib_is_unique(arg)) {
+		struct r_val *items = NSALLOC(struct r_val, src->len + 1);
+		memcpy(items, src->items, sizeof(struct r_val) * src->len);
+		for(unsigned i = 0; i < src->len; i++)
+			src->items[i] = items[order[i]];
+		
+		s_dealloc(items);
+		array = src;
+		array->ref_c++;
+	} else {
+		array = int_new_array(src->len);
+		for(unsigned i = 0; i < src->len; i++) {
+			array->items[i] = src->items[order[i]];
+			int_incr_refcount(array->items[i]);
+		}
+	}
+	
+	s_dealloc(order);
+	return (struct r_val) { .type = TYPE_ARRAY, .array_v = array };
+}
+
+static struct r_val sorted_intvec(struct r_val arg, bool desc) {
+	struct r_intvec *src = arg.intvec_v, *vec;
+	if(rlib_is_unique(arg)) {
+		vec = src;
+		vec->ref_c++;
+	} else {
+		vec = int_new_intvec(src->len);
+		memcpy(vec->items, src->items, sizeof(r_int) * src->len);
+	}
+	
+	sort_ints(vec->items, NULL, vec->len);
+	if(desc) {
+		for(unsigned i = 0, j = vec->len; i + 1 < j; i++, j--) {
+			r_int tmp = vec->items[i];
+			vec->items[i] = vec->items[j - 1];
+			vec->items[j - 1] = tmp;
+		}
+	}
+	
+	return (struct r_val) { .type = TYPE_INTVEC, .intvec_v = vec };
+}
+
+//Arrays get a new reference, iterators, ranges and packed arrays are collected; Null for anything else
+static struct r_val as_array(struct r_val val, struct interp_env *env, const char *src_name) {
+	if(val.type == TYPE_ARRAY) {
+		int_incr_refcount(val);
+		return val;
+	}
+	
+	if(val.type != TYPE_ITER && !int_iter_source_ok(val))
+		return NULL_VAL;
+	
+	struct r_iter *iter = val.type == TYPE_ITER ? val.iter_v : int_new_iter(ITER_SOURCE, val, NULL_VAL, 0);
+	struct r_array *array = int_iter_collect(iter, env, src_name);
+	if(val.type != TYPE_ITER)
+		int_free_iter(iter);
+	
+	return (struct r_val) { .type = TYPE_ARRAY, .array_v = array };
+}
+
+static struct r_val sort_val(struct r_val arg, bool desc, struct interp_env *env, const char *src_name) {
+	if(arg.type == TYPE_INTVEC)
+		return sorted_intvec(arg, desc);
+	if(arg.type == TYPE_ARRAY)
+		return sorted_array(arg, arg.array_v->items, desc);
+	
+	struct r_val array = as_array(arg, env, src_name);
+	if(array.type == TYPE_NULL)
+		return NULL_VAL;
+	
+	struct r_val res = sorted_array(array, array.array_v->items, desc);
+	int_decr_refcount(array);
+	return res;
+}
+
+DECL_R_OP(sort) {
+	return sort_val(args[0], false, env, src_name);
+}
+
+DECL_R_OP(sort_desc) {
+	return sort_val(args[0], true, env, src_name);
+}
+
+//(sort-by coll fn) orders the items by the result of fn for each, which is called once per item
+DECL_R_OP(sort_by) {
+	struct r_val array = as_array(args[0], env, src_name);
+	if(array.type == TYPE_NULL)
+		return NULL_VAL;
+	
+	struct r_array *src = array.array_v;
+	struct r_val *keys = NSALLOC(struct r_val, src->len + 1);
+	unsigned n_keys = 0;
+	for(; n_keys < src->len && !int_interrupted(); n_keys++)
+		keys[n_keys] = int_call_r_fn(args[1], &src->items[n_keys], 1, env, src_name);
+	
+	struct r_val res = NULL_VAL;
+	if(!int_interrupted())
+		res = sorted_array(array, keys, false);
+	
+	for(unsigned i = 0; i < n_keys; i++)
+		int_decr_refcount(keys[i]);
+	s_dealloc(keys);
+	int_decr_refcount(array);
+	return res;
+}
+
+static struct rlib_op ops[] = {
+	DEF_R_OP(sort, "sort", 1),
+	DEF_R_OP(sort_desc, "sort-desc", 1),
+	DEF_R_OP(sort_by, "sort-by", 2)
+};
+
+static char loaded = 0;
+
+void rlib_sort_load() {
+	if(loaded)
+		return;
+	
+	loaded = 1;
+	LOAD_RLIB(ops);
+}
+
+void rlib_sort_put(struct interp_env *env) {
+	PUT_RLIB(ops, env);
+}
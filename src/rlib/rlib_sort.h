@@ -0,0 +1,10 @@
+#ifndef RLIB_SORT_H_INCLUDED
+#define RLIB_SORT_H_INCLUDED
+
+#include "../interpreter/interpreter.h"
+
+void rlib_sort_load();
+
+void rlib_sort_put(struct interp_env *env);
+
+#endif
@@ -3,6 +3,14 @@
 #include "rlib.h"
 
 #include "../proj_utils.h"
+#include "../str_search.h"
+#include "../interpreter/interpreter_fmt.h"
+#include "../tui/utf8.h"
+#include "../interpreter/interpreter_map.h"
+#include "../interpreter/interpreter_pvec.h"
+#include "../interpreter/interpreter_pmap.h"
+#include "../interpreter/interpreter_intvec.h"
+#include "../interpreter/interpreter_range.h"
 
 #include <string.h>
 
@@ -21,28 +29,13 @@ DECL_R_OP(endswith) {
 	return (struct r_val) { .type = TYPE_INT, .int_v = 1 };
 }
 
-static int cmp_r_strings(const struct r_string *a, const struct r_string *b, unsigned a_i) {
-	S_ASSERT(a_i < a->len);
-	if(a->len - a_i < b->len)
-		return 0;
+static void init_r_str_search(struct str_search *search, const struct r_val *needles, unsigned n_needles) {
+	lstring *strs = NSALLOC(lstring, n_needles);
+	for(unsigned i = 0; i < n_needles; i++)
+		strs[i] = (lstring) { .str = needles[i].str_v->str, .len = needles[i].str_v->len };
 	
-	for(unsigned i = 0; i < b->len; i++) {
-		if(a->str[a_i + i] != b->str[i])
-			return 0;
-	}
-	
-	return 1;
-}
-
-static struct r_string *r_string_substr(const struct r_string *str, unsigned start, unsigned len) {
-	S_ASSERT(start + len <= str->len);
-	
-	struct r_string *substr = s_alloc(sizeof(struct r_string *) + len);
-	memcpy( (char *) substr->str, str->str + start, len);
-	substr->len = len;
-	substr->ref_c = 1;
-	
-	return substr;
+	str_search_init(search, strs, n_needles);
+	s_dealloc(strs);
 }
 
 static int is_whitespace(char c) {
@@ -69,42 +62,31 @@ DECL_R_OP(split) {
 	struct { struct r_string **strs; unsigned len, cap; } str_buff = { .len = 0, .cap = 4 };
 	str_buff.strs = NSALLOC(struct r_string*, str_buff.cap);
 	
-	unsigned i = 0;
-	//const char *str_start = args[0].str_v->str;
+	struct str_search search;
+	init_r_str_search(&search, args + 1, n_args - 1);
+	
+	const struct r_string *str = args[0].str_v;
 	unsigned str_start = 0;
+	size_t match_pos, match_len;
 	
-	while(i < args[0].str_v->len) {
-		
-		bool matched = false;
-		for(unsigned j = 1; j < n_args; j++) {
-			if(cmp_r_strings(args[0].str_v, args[j].str_v, i)) {
-				
-				if(str_start != i) { /*
-					struct r_string *substr = s_alloc(sizeof(struct r_string) + i - str_start);
-					substr->len = i - str_start;
-					memcpy( (char *) substr->str, args[0].str_v->str + str_start, substr->len); */
-					struct r_string *substr = r_string_substr(args[0].str_v, str_start, i - str_start);
-					
-					if(str_buff.len == str_buff.cap) {
-						str_buff.cap *= 2;
-						str_buff.strs = SREALLOC(struct r_string*, str_buff.strs, str_buff.cap);
-					}
-					str_buff.strs[str_buff.len++] = substr;
-				}
-				
-				i += args[j].str_v->len;
-				str_start = i;
-				
-				matched = true;
-				break;
+	while(str_search_next(&search, str->str, str->len, str_start, &match_pos, &match_len)) {
+		if(match_pos != str_start) {
+			struct r_string *substr = int_string_slice(args[0].str_v, str_start, match_pos - str_start);
+			
+			if(str_buff.len == str_buff.cap) {
+				str_buff.cap *= 2;
+				str_buff.strs = SREALLOC(struct r_string*, str_buff.strs, str_buff.cap);
 			}
+			str_buff.strs[str_buff.len++] = substr;
 		}
-		if(!matched)
-			i++;
+		
+		str_start = match_pos + match_len;
 	}
 	
+	str_search_free(&search);
+	
 	if(str_start < args[0].str_v->len) {
-		struct r_string *substr = r_string_substr(args[0].str_v, str_start, args[0].str_v->len - str_start);
+		struct r_string *substr = int_string_slice(args[0].str_v, str_start, args[0].str_v->len - str_start);
 		
 		if(str_buff.len == str_buff.cap) {
 			str_buff.cap += 1;
@@ -113,9 +95,7 @@ DECL_R_OP(split) {
 		str_buff.strs[str_buff.len++] = substr;
 	}
 	
-	struct r_array *res = s_alloc(sizeof(struct r_array) + sizeof(struct r_val) * str_buff.len);
-	res->len = str_buff.len;
-	res->ref_c = 1;
+	struct r_array *res = int_new_array(str_buff.len);
 	
 	for(unsigned i = 0; i < str_buff.len; i++) {
 		res->items[i] = (struct r_val) { .type = TYPE_STR, .str_v = str_buff.strs[i] };
@@ -130,7 +110,7 @@ DECL_R_OP(trim) {
 	if(args[0].type != TYPE_STR)
 		return (struct r_val) { .type = TYPE_NULL };
 	
-	const struct r_string *str = args[0].str_v;
+	struct r_string *str = args[0].str_v;
 	
 	unsigned start, end;
 	for(start = 0; start < str->len; start++) {
@@ -153,11 +133,56 @@ DECL_R_OP(trim) {
 		len = 0;
 	}
 	
-	struct r_string *res = r_string_substr(str, start, len);
+	//A temporary is trimmed in place instead of being kept alive by a slice; removing ascii whitespace keeps the ascii/utf8 flags valid
+	if(rlib_is_unique(args[0])) {
+		memmove(str->data, str->data + start, len);
+		str->len = len;
+		str->flags &= ~R_STRING_HASHED;
+		str->ref_c++;
+		return args[0];
+	}
+	
+	struct r_string *res = int_string_slice(str, start, len);
 	
 	return (struct r_val) { .type = TYPE_STR, .str_v = res };
 }
 
+//Only ascii letters are mapped, everything else (including utf8 sequences) is copied as is
+static struct r_val map_case(struct r_val arg, bool upper) {
+	if(arg.type != TYPE_STR)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	struct r_string *src = arg.str_v;
+	struct r_string *dst;
+	
+	if(rlib_is_unique(arg)) {
+		dst = src;
+		dst->flags &= ~R_STRING_HASHED; //Still ascii or utf8 if it was before
+		dst->ref_c++;
+	} else {
+		dst = int_new_string(NULL, src->len);
+	}
+	
+	const unsigned char *in = (const unsigned char *) src->str;
+	unsigned char *out = (unsigned char *) dst->data;
+	unsigned char from = upper ? 'a' : 'A';
+	
+	for(unsigned i = 0; i < src->len; i++) {
+		unsigned char c = in[i];
+		out[i] = (unsigned char) (c - from) < 26 ? c ^ 0x20 : c;
+	}
+	
+	return (struct r_val) { .type = TYPE_STR, .str_v = dst };
+}
+
+DECL_R_OP(upper) {
+	return map_case(args[0], true);
+}
+
+DECL_R_OP(lower) {
+	return map_case(args[0], false);
+}
+
 DECL_R_OP(contains) {
 	if(args[0].type != TYPE_STR)
 		return (struct r_val) { .type = TYPE_NULL };
@@ -169,21 +194,201 @@ DECL_R_OP(contains) {
 	
 	const struct r_string *str = args[0].str_v;
 	
-	for(unsigned i = 0; i < str->len; i++) {
-		for(unsigned j = 1; j < n_args; j++) {
-			if(cmp_r_strings(str, args[j].str_v, i))
-				return (struct r_val) { .type = TYPE_INT, .int_v = 1 };
+	//An empty needle is contained in any non-empty string
+	for(unsigned i = 1; i < n_args; i++) {
+		if(args[i].str_v->len == 0)
+			return (struct r_val) { .type = TYPE_INT, .int_v = str->len > 0 };
+	}
+	
+	struct str_search search;
+	init_r_str_search(&search, args + 1, n_args - 1);
+	
+	size_t match_pos, match_len;
+	bool found = str_search_next(&search, str->str, str->len, 0, &match_pos, &match_len);
+	
+	str_search_free(&search);
+	
+	return (struct r_val) { .type = TYPE_INT, .int_v = found };
+}
+
+DECL_R_OP(concat) {
+	size_t len = 0;
+	for(unsigned i = 0; i < n_args; i++)
+		len += fmt_r_val_len(args[i]);
+	
+	struct r_string *res = int_new_string(NULL, len);
+	char *top = res->data;
+	for(unsigned i = 0; i < n_args; i++)
+		top = fmt_write_r_val(top, args[i]);
+	
+	return (struct r_val) { .type = TYPE_STR, .str_v = res };
+}
+
+DECL_R_OP(join) {
+	if(args[0].type != TYPE_ARRAY || (n_args > 1 && args[1].type != TYPE_STR))
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	const struct r_array *array = args[0].array_v;
+	const struct r_string *sep = n_args > 1 ? args[1].str_v : NULL;
+	
+	size_t len = 0;
+	for(unsigned i = 0; i < array->len; i++)
+		len += fmt_r_val_len(array->items[i]);
+	if(sep != NULL && array->len > 1)
+		len += (size_t) sep->len * (array->len - 1);
+	
+	struct r_string *res = int_new_string(NULL, len);
+	char *top = res->data;
+	for(unsigned i = 0; i < array->len; i++) {
+		if(i != 0 && sep != NULL) {
+			memcpy(top, sep->str, sep->len);
+			top += sep->len;
 		}
+		top = fmt_write_r_val(top, array->items[i]);
 	}
 	
-	return (struct r_val) { .type = TYPE_INT, .int_v = 0 };
+	return (struct r_val) { .type = TYPE_STR, .str_v = res };
+}
+
+static void builder_reserve(struct r_strbuilder *b, size_t extra) {
+	size_t len = b->str != NULL ? b->str->len : 0;
+	if(b->str != NULL && len + extra <= b->cap)
+		return;
+	
+	size_t cap = b->cap;
+	while(cap < len + extra) {
+		cap += 1;
+		cap *= 2;
+	}
+	
+	if(b->str == NULL) {
+		b->str = int_new_string(NULL, cap);
+		b->str->len = 0;
+	} else {
+		b->str = s_realloc(b->str, sizeof(struct r_string) + cap);
+		b->str->str = b->str->data;
+	}
+	b->cap = cap;
+}
+
+DECL_R_OP(builder) {
+	struct r_strbuilder *b = SALLOC(struct r_strbuilder);
+	b->ref_c = 1;
+	b->cap = 0;
+	b->str = NULL;
+	
+	size_t len = 0;
+	for(unsigned i = 0; i < n_args; i++)
+		len += fmt_r_val_len(args[i]);
+	
+	if(len != 0) {
+		builder_reserve(b, len);
+		char *top = b->str->data;
+		for(unsigned i = 0; i < n_args; i++)
+			top = fmt_write_r_val(top, args[i]);
+		b->str->len = len;
+	}
+	
+	return (struct r_val) { .type = TYPE_STRBUILDER, .builder_v = b };
+}
+
+DECL_R_OP(builder_append) {
+	if(args[0].type != TYPE_STRBUILDER)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	struct r_strbuilder *b = args[0].builder_v;
+	
+	size_t len = 0;
+	for(unsigned i = 1; i < n_args; i++)
+		len += fmt_r_val_len(args[i]);
+	
+	builder_reserve(b, len);
+	
+	//The length is only updated at the end, so appending a builder to itself copies what it held before the call
+	char *top = b->str->data + b->str->len;
+	for(unsigned i = 1; i < n_args; i++)
+		top = fmt_write_r_val(top, args[i]);
+	b->str->len += len;
+	
+	int_incr_refcount(args[0]);
+	return args[0];
+}
+
+//Hands the buffer over as a string (trimmed to size in place) and leaves the builder empty
+DECL_R_OP(builder_freeze) {
+	if(args[0].type != TYPE_STRBUILDER)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	struct r_strbuilder *b = args[0].builder_v;
+	
+	struct r_string *res;
+	if(b->str == NULL) {
+		res = int_new_string(NULL, 0);
+	} else {
+		res = s_realloc(b->str, sizeof(struct r_string) + b->str->len);
+		res->str = res->data;
+	}
+	
+	b->str = NULL;
+	b->cap = 0;
+	
+	return (struct r_val) { .type = TYPE_STR, .str_v = res };
+}
+
+//Characters in a string (bytes that aren't valid utf8 count as one each), items in an array or map
+DECL_R_OP(length) {
+	switch(args[0].type) {
+		case TYPE_STR: {
+			struct r_string *str = args[0].str_v;
+			r_int len;
+			
+			if(int_string_is_ascii(str))
+				len = str->len;
+			else if(int_string_is_utf8(str))
+				len = utf8_count_valid_chars(str->str, str->len);
+			else
+				len = utf8_count_chars(str->str, str->str + str->len);
+			
+			return (struct r_val) { .type = TYPE_INT, .int_v = len };
+		}
+		
+		case TYPE_ARRAY:
+			return (struct r_val) { .type = TYPE_INT, .int_v = args[0].array_v->len };
+		
+		case TYPE_MAP:
+		case TYPE_SET:
+			return (struct r_val) { .type = TYPE_INT, .int_v = args[0].map_v->len };
+		
+		case TYPE_PVEC:
+			return (struct r_val) { .type = TYPE_INT, .int_v = args[0].pvec_v->len };
+		
+		case TYPE_PMAP:
+			return (struct r_val) { .type = TYPE_INT, .int_v = args[0].pmap_v->len };
+		
+		case TYPE_INTVEC:
+			return (struct r_val) { .type = TYPE_INT, .int_v = args[0].intvec_v->len };
+		
+		case TYPE_RANGE:
+			return (struct r_val) { .type = TYPE_INT, .int_v = args[0].range_v->len };
+		
+		default:
+			return (struct r_val) { .type = TYPE_NULL };
+	}
 }
 
 static struct rlib_op ops[] = {
 	DEF_R_OP(endswith, "endswith", 2),
 	DEF_R_OP(split, "split", -3),
 	DEF_R_OP(trim, "trim", 1),
-	DEF_R_OP(contains, "contains", -3)
+	DEF_R_OP(upper, "upper", 1),
+	DEF_R_OP(lower, "lower", 1),
+	DEF_R_OP(contains, "contains", -3),
+	DEF_R_OP(concat, "concat", -1),
+	DEF_R_OP(join, "join", -2),
+	DEF_R_OP(builder, "builder", -1),
+	DEF_R_OP(builder_append, "builder-append", -2),
+	DEF_R_OP(builder_freeze, "builder-freeze", 1),
+	DEF_R_OP(length, "length", 1)
 };
 
 static char loaded = 0;
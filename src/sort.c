@@ -0,0 +1,263 @@
+#include "sort.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#define SMALL_SORT 24 //Below this insertion sort beats the setup of the others
+
+//---------------------------- Ints
+
+static void insertion_sort_ints(unsigned long long *keys, unsigned *payload, size_t n) {
+	for(size_t i = 1; i < n; i++) {
+		unsigned long long k = keys[i];
+		unsigned p = payload != NULL ? payload[i] : 0;
+		
+		size_t j = i;
+		for(; j > 0 && keys[j - 1] > k; j--) {
+			keys[j] = keys[j - 1];
+			if(payload != NULL)
+				payload[j] = payload[j - 1];
+		}
+		keys[j] = k;
+		if(payload != NULL)
+			payload[j] = p;
+	}
+}
+
+//With the sign bit flipped the keys sort as unsigned numbers, which is what the byte by byte passes need
+#define SIGN_BIT (1ULL << 63)
+
+void sort_ints(r_int *int_keys, unsigned *payload, size_t n) {
+	unsigned long long *keys = (unsigned long long *) int_keys;
+	for(size_t i = 0; i < n; i++)
+		keys[i] ^= SIGN_BIT;
+	
+	if(n <= SMALL_SORT) {
+		insertion_sort_ints(keys, payload, n);
+		goto DONE;
+	}
+	
+	//The counts for every pass come from a single read of the keys
+	size_t (*counts)[256] = s_alloc(sizeof(size_t) * 8 * 256);
+	memset(counts, 0, sizeof(size_t) * 8 * 256);
+	for(size_t i = 0; i < n; i++) {
+		for(unsigned b = 0; b < 8; b++)
+			counts[b][(keys[i] >> (b * 8)) & 0xFF]++;
+	}
+	
+	unsigned long long *src = keys, *dst = NSALLOC(unsigned long long, n);
+	unsigned *src_p = payload, *dst_p = payload != NULL ? NSALLOC(unsigned, n) : NULL;
+	unsigned long long *tmp = dst;
+	unsigned *tmp_p = dst_p;
+	
+	for(unsigned b = 0; b < 8; b++) {
+		unsigned shift = b * 8;
+		if(counts[b][(src[0] >> shift) & 0xFF] == n) //All the keys have the same byte here
+			continue;
+		
+		size_t pos[256], sum = 0;
+		for(unsigned d = 0; d < 256; d++) {
+			pos[d] = sum;
+			sum += counts[b][d];
+		}
+		
+		for(size_t i = 0; i < n; i++) {
+			size_t to = pos[(src[i] >> shift) & 0xFF]++;
+			dst[to] = src[i];
+			if(payload != NULL)
+				dst_p[to] = src_p[i];
+		}
+		
+		unsigned long long *swap = src;
+		src = dst;
+		dst = swap;
+		unsigned *swap_p = src_p;
+		src_p = dst_p;
+		dst_p = swap_p;
+	}
+	
+	if(src != keys) {
+		memcpy(keys, src, sizeof(unsigned long long) * n);
+		if(payload != NULL)
+			memcpy(payload, src_p, sizeof(unsigned) * n);
+	}
+	
+	s_dealloc(tmp);
+	s_dealloc(tmp_p);
+	s_dealloc(counts);
+	
+	DONE:
+	for(size_t i = 0; i < n; i++)
+		keys[i] ^= SIGN_BIT;
+}
+
+//---------------------------- Strings
+
+//The 8 bytes from depth on as a big endian number, zero padded past the end, so that comparing them compares the bytes
+static unsigned long long chunk_at(const struct sort_str *s, size_t depth) {
+	unsigned long long key = 0;
+	for(size_t i = depth; i < depth + 8; i++)
+		key = (key << 8) | (i < s->len ? (unsigned char) s->str[i] : 0);
+	return key;
+}
+
+static void load_keys(struct sort_str *strs, size_t n, size_t depth) {
+	for(size_t i = 0; i < n; i++)
+		strs[i].key = chunk_at(&strs[i], depth);
+}
+
+//For strings that are equal before depth and have their keys loaded for it
+static int cmp_from(const struct sort_str *a, const struct sort_str *b, size_t depth) {
+	if(a->key != b->key)
+		return a->key < b->key ? -1 : 1;
+	
+	size_t len_a = a->len > depth ? a->len - depth : 0, len_b = b->len > depth ? b->len - depth : 0;
+	int res = memcmp(a->str + depth, b->str + depth, len_a < len_b ? len_a : len_b);
+	if(res != 0)
+		return res;
+	if(a->len != b->len)
+		return a->len < b->len ? -1 : 1;
+	
+	return a->idx < b->idx ? -1 : a->idx > b->idx;
+}
+
+static void insertion_sort_strs(struct sort_str *strs, size_t n, size_t depth) {
+	for(size_t i = 1; i < n; i++) {
+		struct sort_str s = strs[i];
+		size_t j = i;
+		for(; j > 0 && cmp_from(&strs[j - 1], &s, depth) > 0; j--)
+			strs[j] = strs[j - 1];
+		strs[j] = s;
+	}
+}
+
+static int cmp_len_idx(const void *a, const void *b) {
+	const struct sort_str *sa = a, *sb = b;
+	if(sa->len != sb->len)
+		return sa->len < sb->len ? -1 : 1;
+	return sa->idx < sb->idx ? -1 : sa->idx > sb->idx;
+}
+
+static void swap_strs(struct sort_str *a, struct sort_str *b) {
+	struct sort_str tmp = *a;
+	*a = *b;
+	*b = tmp;
+}
+
+static void sort_strs_at(struct sort_str *strs, size_t n, size_t depth);
+
+//Strings that agree on the 8 bytes at depth. Those ending within them are prefixes of the rest and go first, ordered by
+//length; the rest continue at the next 8 bytes.
+static void sort_equal_keys(struct sort_str *strs, size_t n, size_t depth) {
+	size_t n_short = 0;
+	for(size_t i = 0; i < n; i++) {
+		if(strs[i].len <= depth + 8)
+			swap_strs(&strs[i], &strs[n_short++]);
+	}
+	
+	if(n_short > 1)
+		qsort(strs, n_short, sizeof(struct sort_str), cmp_len_idx);
+	
+	if(n - n_short > 1) {
+		load_keys(strs + n_short, n - n_short, depth + 8);
+		sort_strs_at(strs + n_short, n - n_short, depth + 8);
+	}
+}
+
+static unsigned long long median3(unsigned long long a, unsigned long long b, unsigned long long c) {
+	if(a < b)
+		return b < c ? b : a < c ? c : a;
+	return a < c ? a : b < c ? c : b;
+}
+
+static void sort_strs_at(struct sort_str *strs, size_t n, size_t depth) {
+	while(n > SMALL_SORT) {
+		//The median of three medians of three, as input that is already partly in order would otherwise give lopsided
+		//partitions with a pivot from the ends
+		size_t step = n / 8;
+		unsigned long long pivot = median3(
+			median3(strs[0].key, strs[step].key, strs[2 * step].key),
+			median3(strs[3 * step].key, strs[n / 2].key, strs[5 * step].key),
+			median3(strs[6 * step].key, strs[7 * step].key, strs[n - 1].key));
+		
+		//Three way partition: [0, lt) below the pivot, [lt, gt) equal to it, [gt, n) above
+		size_t lt = 0, i = 0, gt = n;
+		while(i < gt) {
+			if(strs[i].key < pivot)
+				swap_strs(&strs[lt++], &strs[i++]);
+			else if(strs[i].key > pivot)
+				swap_strs(&strs[i], &strs[--gt]);
+			else
+				i++;
+		}
+		
+		sort_strs_at(strs, lt, depth);
+		sort_equal_keys(strs + lt, gt - lt, depth);
+		
+		strs += gt;
+		n -= gt;
+	}
+	
+	insertion_sort_strs(strs, n, depth);
+}
+
+void sort_strs(struct sort_str *strs, size_t n) {
+	load_keys(strs, n, 0);
+	sort_strs_at(strs, n, 0);
+}
+
+//---------------------------- Stable merge sort
+
+struct merge_ctx {
+	size_t size;
+	int (*cmp)(const void *a, const void *b, void *ctx);
+	void *ctx;
+	char *tmp;
+};
+
+static void merge_sort(char *items, size_t n, struct merge_ctx *m) {
+	size_t size = m->size;
+	
+	if(n <= SMALL_SORT) {
+		for(size_t i = 1; i < n; i++) {
+			memcpy(m->tmp, items + i * size, size);
+			size_t j = i;
+			for(; j > 0 && m->cmp(items + (j - 1) * size, m->tmp, m->ctx) > 0; j--)
+				memcpy(items + j * size, items + (j - 1) * size, size);
+			memcpy(items + j * size, m->tmp, size);
+		}
+		return;
+	}
+	
+	size_t half = n / 2;
+	char *right = items + half * size, *end = items + n * size;
+	merge_sort(items, half, m);
+	merge_sort(right, n - half, m);
+	
+	if(m->cmp(right - size, right, m->ctx) <= 0) //Already in order, as is common for partly sorted input
+		return;
+	
+	//The left half moves out of the way and the merge fills in from the front, never overtaking the right half
+	memcpy(m->tmp, items, half * size);
+	char *l = m->tmp, *l_end = m->tmp + half * size, *r = right, *out = items;
+	while(l < l_end && r < end) {
+		if(m->cmp(r, l, m->ctx) < 0) {
+			memcpy(out, r, size);
+			r += size;
+		} else {
+			memcpy(out, l, size);
+			l += size;
+		}
+		out += size;
+	}
+	memcpy(out, l, l_end - l);
+}
+
+void sort_stable(void *items, size_t n, size_t size, int (*cmp)(const void *a, const void *b, void *ctx), void *ctx) {
+	if(n < 2)
+		return;
+	
+	struct merge_ctx m = { .size = size, .cmp = cmp, .ctx = ctx, .tmp = s_alloc(size * (n / 2 + 1)) };
+	merge_sort(items, n, &m);
+	s_dealloc(m.tmp);
+}
@@ -0,0 +1,30 @@
+#ifndef SORT_H_INCLUDED
+#define SORT_H_INCLUDED
+
+#include "proj_utils.h"
+#include "proj_defs.h"
+
+/*
+ * Sorting kernels for the sort builtins. Ints get an LSD radix sort, a byte per pass, skipping the passes where every
+ * key has the same byte. Strings get a multikey quicksort that compares 8 bytes at a time, with the 8 bytes at the
+ * current depth cached next to each string so that partitioning reads one contiguous array instead of every string.
+ * Everything else goes through a stable merge sort with a comparison function.
+ */
+
+struct sort_str {
+	unsigned long long key; //Used by sort_strs
+	const char *str;
+	unsigned len;
+	unsigned idx; //Orders equal strings, which makes the sort stable if it's the original position
+};
+
+//Ascending; payload, if not NULL, is moved along with the keys. Stable.
+void sort_ints(r_int *keys, unsigned *payload, size_t n);
+
+//By the bytes of the strings, shorter first where one is a prefix of the other
+void sort_strs(struct sort_str *strs, size_t n);
+
+//cmp gives a negative number, 0 or a positive one like for qsort
+void sort_stable(void *items, size_t n, size_t size, int (*cmp)(const void *a, const void *b, void *ctx), void *ctx);
+
+#endif
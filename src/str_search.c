@@ -0,0 +1,298 @@
+#define _GNU_SOURCE //memmem
+
+#include "str_search.h"
+
+#include <string.h>
+#include <stdint.h>
+
+#ifdef __SSE2__
+	#include <emmintrin.h>
+#endif
+
+/*
+ * Dense DFA built from the needles. Bytes that do not occur in any needle share class 0, so a table row only
+ * needs one column per distinct needle byte. Every state is the longest suffix of the input that is a prefix
+ * of some needle; out is the index + 1 of the first needle ending in that state and dict links to the next
+ * state on the failure chain that also ends a needle.
+ */
+struct search_automaton {
+	unsigned char classes[256];
+	unsigned n_classes;
+	
+	unsigned n_states;
+	unsigned *trans;
+	unsigned *fail, *dict, *out;
+	
+	size_t *needle_lens;
+};
+
+static struct search_automaton *build_automaton(const lstring *needles, unsigned n_needles) {
+	struct search_automaton *ac = SALLOC(struct search_automaton);
+	
+	memset(ac->classes, 0, sizeof(ac->classes));
+	ac->n_classes = 1;
+	
+	size_t max_states = 1;
+	for(unsigned i = 0; i < n_needles; i++) {
+		max_states += needles[i].len;
+		for(size_t j = 0; j < needles[i].len; j++) {
+			unsigned char c = needles[i].str[j];
+			if(ac->classes[c] == 0)
+				ac->classes[c] = ac->n_classes++;
+		}
+	}
+	
+	unsigned nc = ac->n_classes;
+	
+	ac->trans = NSALLOC(unsigned, max_states * nc);
+	ac->fail = NSALLOC(unsigned, max_states);
+	ac->dict = NSALLOC(unsigned, max_states);
+	ac->out = NSALLOC(unsigned, max_states);
+	ac->needle_lens = NSALLOC(size_t, n_needles);
+	
+	memset(ac->trans, 0, sizeof(unsigned) * max_states * nc);
+	memset(ac->out, 0, sizeof(unsigned) * max_states);
+	ac->n_states = 1;
+	
+	//Trie, a zero transition means no child (the root is never a child)
+	for(unsigned i = 0; i < n_needles; i++) {
+		ac->needle_lens[i] = needles[i].len;
+		
+		unsigned state = 0;
+		for(size_t j = 0; j < needles[i].len; j++) {
+			unsigned *t = &ac->trans[state * nc + ac->classes[(unsigned char) needles[i].str[j]]];
+			if(*t == 0)
+				*t = ac->n_states++;
+			state = *t;
+		}
+		
+		if(ac->out[state] == 0)
+			ac->out[state] = i + 1;
+	}
+	
+	//Breadth first so that failure links always point at finished states
+	unsigned *queue = NSALLOC(unsigned, ac->n_states);
+	unsigned q_start = 0, q_end = 0;
+	
+	ac->fail[0] = 0;
+	ac->dict[0] = 0;
+	for(unsigned c = 0; c < nc; c++) {
+		unsigned t = ac->trans[c];
+		if(t != 0) {
+			ac->fail[t] = 0;
+			ac->dict[t] = 0;
+			queue[q_end++] = t;
+		}
+	}
+	
+	while(q_start < q_end) {
+		unsigned s = queue[q_start++];
+		
+		for(unsigned c = 0; c < nc; c++) {
+			unsigned *t = &ac->trans[s * nc + c];
+			unsigned via_fail = ac->trans[ac->fail[s] * nc + c];
+			
+			if(*t == 0) {
+				*t = via_fail;
+			} else {
+				ac->fail[*t] = via_fail;
+				ac->dict[*t] = ac->out[via_fail] ? via_fail : ac->dict[via_fail];
+				queue[q_end++] = *t;
+			}
+		}
+	}
+	
+	s_dealloc(queue);
+	
+	return ac;
+}
+
+static void free_automaton(struct search_automaton *ac) {
+	s_dealloc(ac->trans);
+	s_dealloc(ac->fail);
+	s_dealloc(ac->dict);
+	s_dealloc(ac->out);
+	s_dealloc(ac->needle_lens);
+	s_dealloc(ac);
+}
+
+void str_search_init(struct str_search *s, const lstring *needles, unsigned n_needles) {
+	s->kind = SEARCH_NONE;
+	s->max_len = 0;
+	s->n_bytes = 0;
+	s->ac = NULL;
+	memset(s->byte_set, 0, sizeof(s->byte_set));
+	
+	unsigned n_used = 0, first_used = 0;
+	bool all_bytes = true;
+	for(unsigned i = 0; i < n_needles; i++) {
+		if(needles[i].len == 0)
+			continue;
+		
+		if(n_used++ == 0)
+			first_used = i;
+		
+		if(needles[i].len > s->max_len)
+			s->max_len = needles[i].len;
+		if(needles[i].len != 1)
+			all_bytes = false;
+		
+		unsigned char c = needles[i].str[0];
+		if(!s->byte_set[c]) {
+			s->byte_set[c] = true;
+			if(s->n_bytes < LENOF(s->bytes))
+				s->bytes[s->n_bytes] = c;
+			s->n_bytes++;
+		}
+	}
+	
+	if(n_used == 0)
+		return;
+	
+	if(all_bytes && s->n_bytes == 1) {
+		s->kind = SEARCH_BYTE;
+		s->needle = needles[first_used];
+	} else if(all_bytes) {
+		s->kind = SEARCH_BYTES;
+	} else if(n_used == 1) {
+		s->kind = SEARCH_SUBSTR;
+		s->needle = needles[first_used];
+	} else {
+		//Drop the empty needles, indices only matter relative to each other
+		lstring *used = NSALLOC(lstring, n_used);
+		for(unsigned i = 0, j = 0; i < n_needles; i++) {
+			if(needles[i].len != 0)
+				used[j++] = needles[i];
+		}
+		
+		s->kind = SEARCH_MULTI;
+		s->ac = build_automaton(used, n_used);
+		s_dealloc(used);
+	}
+}
+
+void str_search_free(struct str_search *s) {
+	if(s->ac != NULL)
+		free_automaton(s->ac);
+	s->ac = NULL;
+}
+
+static size_t scan_byte_set(const struct str_search *s, const unsigned char *hay, size_t len, size_t i) {
+#ifdef __SSE2__
+	if(s->n_bytes <= LENOF(s->bytes)) {
+		__m128i needles[LENOF(s->bytes)];
+		for(unsigned b = 0; b < s->n_bytes; b++)
+			needles[b] = _mm_set1_epi8((char) s->bytes[b]);
+		
+		for(; i + 16 <= len; i += 16) {
+			__m128i chunk = _mm_loadu_si128((const __m128i *) (hay + i));
+			__m128i eq = _mm_cmpeq_epi8(chunk, needles[0]);
+			for(unsigned b = 1; b < s->n_bytes; b++)
+				eq = _mm_or_si128(eq, _mm_cmpeq_epi8(chunk, needles[b]));
+			
+			int mask = _mm_movemask_epi8(eq);
+			if(mask != 0)
+				return i + __builtin_ctz(mask);
+		}
+	}
+#endif
+
+	for(; i < len; i++) {
+		if(s->byte_set[hay[i]])
+			return i;
+	}
+	
+	return len;
+}
+
+static bool search_automaton(const struct str_search *s, const unsigned char *hay, size_t len, size_t i, size_t *match_pos, size_t *match_len) {
+	const struct search_automaton *ac = s->ac;
+	const unsigned nc = ac->n_classes;
+	
+	size_t best_start = SIZE_MAX;
+	unsigned best_needle = 0;
+	
+	unsigned state = 0;
+	while(i < len) {
+		if(state == 0) {
+			//Nothing in progress, so no later match can start before one we already have
+			if(best_start != SIZE_MAX)
+				break;
+			
+			i = scan_byte_set(s, hay, len, i);
+			if(i == len)
+				break;
+		}
+		
+		state = ac->trans[state * nc + ac->classes[hay[i]]];
+		
+		for(unsigned o = ac->out[state] ? state : ac->dict[state]; o != 0; o = ac->dict[o]) {
+			unsigned needle = ac->out[o] - 1;
+			size_t start = i + 1 - ac->needle_lens[needle];
+			
+			if(start < best_start || (start == best_start && needle < best_needle)) {
+				best_start = start;
+				best_needle = needle;
+			}
+		}
+		
+		i++;
+		
+		//Anything starting at or before best_start has ended by now
+		if(best_start != SIZE_MAX && i >= best_start + s->max_len)
+			break;
+	}
+	
+	if(best_start == SIZE_MAX)
+		return false;
+	
+	*match_pos = best_start;
+	*match_len = ac->needle_lens[best_needle];
+	return true;
+}
+
+bool str_search_next(const struct str_search *s, const char *hay, size_t len, size_t from, size_t *match_pos, size_t *match_len) {
+	if(from >= len)
+		return false;
+	
+	const unsigned char *uhay = (const unsigned char *) hay;
+	
+	switch(s->kind) {
+	
+		case SEARCH_BYTE: {
+			const char *p = memchr(hay + from, s->needle.str[0], len - from);
+			if(p == NULL)
+				return false;
+			
+			*match_pos = p - hay;
+			*match_len = 1;
+			return true;
+		}
+		
+		case SEARCH_BYTES: {
+			size_t i = scan_byte_set(s, uhay, len, from);
+			if(i == len)
+				return false;
+			
+			*match_pos = i;
+			*match_len = 1;
+			return true;
+		}
+		
+		case SEARCH_SUBSTR: {
+			const char *p = memmem(hay + from, len - from, s->needle.str, s->needle.len);
+			if(p == NULL)
+				return false;
+			
+			*match_pos = p - hay;
+			*match_len = s->needle.len;
+			return true;
+		}
+		
+		case SEARCH_MULTI:
+			return search_automaton(s, uhay, len, from, match_pos, match_len);
+		
+		default:
+			return false;
+	}
+}
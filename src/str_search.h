@@ -0,0 +1,43 @@
+#ifndef STR_SEARCH_H_INCLUDED
+#define STR_SEARCH_H_INCLUDED
+
+#include "proj_utils.h"
+
+/*
+ * Finds the leftmost occurrence of any of a set of needles in a string. When several needles match at the same
+ * position the one given first wins, matching the order in which builtins like split check their delimiters.
+ * The strategy is picked once in str_search_init: memchr for a single byte, memmem for a single needle,
+ * a vectorised byte scan for sets of single bytes, and an Aho-Corasick automaton for everything else.
+ */
+
+enum {
+	SEARCH_NONE,
+	SEARCH_BYTE,
+	SEARCH_BYTES,
+	SEARCH_SUBSTR,
+	SEARCH_MULTI
+};
+
+struct search_automaton;
+
+struct str_search {
+	int kind;
+	unsigned max_len;
+	
+	lstring needle; //SEARCH_BYTE and SEARCH_SUBSTR
+	
+	unsigned n_bytes;
+	unsigned char bytes[4];
+	bool byte_set[256]; //Delimiter bytes for SEARCH_BYTES, possible first bytes of a match for SEARCH_MULTI
+	
+	struct search_automaton *ac;
+};
+
+//Empty needles are ignored, since they would match everywhere
+void str_search_init(struct str_search *s, const lstring *needles, unsigned n_needles);
+void str_search_free(struct str_search *s);
+
+//Returns true and sets match_pos/match_len if a needle occurs at or after from
+bool str_search_next(const struct str_search *s, const char *hay, size_t len, size_t from, size_t *match_pos, size_t *match_len);
+
+#endif
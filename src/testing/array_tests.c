@@ -0,0 +1,142 @@
+#include "../proj_utils.h"
+
+#include "../interpreter/interpreter.h"
+
+#include "test_script.h"
+
+#include <string.h>
+
+#ifndef NO_INCLUDE_ASSERTS
+
+#define ARRAY_V(a) ((struct r_val) { .type = TYPE_ARRAY, .array_v = (a) })
+
+static struct r_array *array_of_strs(unsigned len) {
+	struct r_array *array = int_new_array(len);
+	for(unsigned i = 0; i < len; i++) {
+		char text[16];
+		snprintf(text, sizeof(text), "s%u", i);
+		array->items[i] = (struct r_val) { .type = TYPE_STR, .str_v = int_new_string(text, strlen(text)) };
+	}
+	return array;
+}
+
+//Slices are views on the root array and keep it alive, without touching the items' own counts
+static void test1() {
+	struct r_array *array = array_of_strs(10);
+	
+	struct r_array *slice = int_array_slice(array, 2, 5);
+	S_ASSERT(slice->parent == array && slice->items == array->items + 2 && slice->len == 5);
+	S_ASSERT(array->ref_c == 2 && array->items[2].str_v->ref_c == 1);
+	
+	struct r_array *inner = int_array_slice(slice, 1, 3);
+	S_ASSERT(inner->parent == array && inner->items == array->items + 3);
+	S_ASSERT(array->ref_c == 3);
+	
+	struct r_array *whole = int_array_slice(array, 0, 10);
+	S_ASSERT(whole == array && array->ref_c == 4);
+	int_decr_refcount(ARRAY_V(whole));
+	
+	//A single item is copied rather than viewed
+	struct r_array *one = int_array_slice(slice, 4, 1);
+	S_ASSERT(one->parent == NULL && array->ref_c == 3);
+	S_ASSERT(one->items[0].str_v == array->items[6].str_v && one->items[0].str_v->ref_c == 2);
+	
+	//The parent outlives its last reference from a variable for as long as a slice is around
+	int_decr_refcount(ARRAY_V(array));
+	S_ASSERT(array->ref_c == 2);
+	int_decr_refcount(ARRAY_V(slice));
+	S_ASSERT(array->ref_c == 1);
+	S_ASSERT(inner->items[0].str_v->len == 2 && memcmp(inner->items[0].str_v->str, "s3", 2) == 0);
+	
+	int_decr_refcount(ARRAY_V(inner));
+	S_ASSERT(one->items[0].str_v->ref_c == 1);
+	int_decr_refcount(ARRAY_V(one));
+}
+
+//Slices through the builtins, including index, map, filter and arguments of external commands
+static void test2() {
+	struct test_script ts;
+	test_script_start(&ts);
+	
+	PRINTS("let a (array 1 2 3 4 5 6)", "(1 2 3 4 5 6)");
+	PRINTS("let s (slice @a 1 4)", "(2 3 4 5)");
+	PRINTS("slice @a (- 0 2)", "(5 6)");
+	PRINTS("slice @a 4 10", "(5 6)");
+	PRINTS("slice @a 7", "()");
+	PRINTS("slice @s 1 2", "(3 4)");
+	PRINTS("slice \"abc\" 0 1", "Null");
+	
+	PRINTS("index @s 0", "2");
+	PRINTS("index @s (- 0 1)", "5");
+	PRINTS("index @s 4", "Null");
+	PRINTS("map @s (! x (* @x 10))", "(20 30 40 50)");
+	PRINTS("filter @s (! x (> @x 3))", "(4 5)");
+	PRINTS("map (slice (array 1 2 3 4) 1 3) (! x (* @x 10))", "(20 30 40)");
+	PRINTS("@a", "(1 2 3 4 5 6)");
+	
+	struct r_val slice = test_eval(&ts, "@s");
+	memory_region *region = NEW_REGION();
+	char **argv = int_exec_args(LSTRING("echo"), &slice, 1, region);
+	S_ASSERT(argv != NULL && strcmp(argv[0], "echo") == 0);
+	S_ASSERT(strcmp(argv[1], "2") == 0 && strcmp(argv[4], "5") == 0 && argv[5] == NULL);
+	free_memory_region(region);
+	int_decr_refcount(slice);
+	
+	test_script_end(&ts);
+}
+
+//The array a variable holds, without keeping a reference that would make it shared
+static struct r_array *array_of_var(struct test_script *ts, const char *src) {
+	struct r_val val = test_eval(ts, src);
+	S_ASSERT(val.type == TYPE_ARRAY);
+	int_decr_refcount(val);
+	return val.array_v;
+}
+
+//push, pop, extend and insert change an array nothing else holds in place, and copy a shared one
+static void test3() {
+	struct test_script ts;
+	test_script_start(&ts);
+	
+	PRINTS("let a (array 1 2)", "(1 2)");
+	PRINTS("push @a 3", "3");
+	struct r_array *unique = array_of_var(&ts, "@a");
+	S_ASSERT(unique->ref_c == 1 && unique->cap > 3);
+	PRINTS("push @a 4", "4");
+	PRINTS("insert @a 0 x y", "6");
+	PRINTS("pop @a", "4");
+	S_ASSERT(array_of_var(&ts, "@a") == unique);
+	PRINTS("extend @a (array 7 8) (array 9)", "8");
+	PRINTS("@a", "(x y 1 2 3 7 8 9)");
+	unique = array_of_var(&ts, "@a"); //Growing may have moved it
+	
+	PRINTS("let b @a", "(x y 1 2 3 7 8 9)");
+	PRINTS("push @a 10", "9");
+	S_ASSERT(array_of_var(&ts, "@a") != unique && array_of_var(&ts, "@b") == unique);
+	PRINTS("@b", "(x y 1 2 3 7 8 9)");
+	
+	const char *changes[] = { "pop @b", "extend @b (array 0)", "insert @b (- 0 1) z" };
+	const char *results[] = { "(x y 1 2 3 7 8)", "(x y 1 2 3 7 8 9 0)", "(x y 1 2 3 7 8 z 9)" };
+	for(unsigned i = 0; i < LENOF(changes); i++) {
+		PRINTS("let c @b", "(x y 1 2 3 7 8 9)");
+		test_eval_prints(&ts, changes[i], "");
+		PRINTS("@c", "(x y 1 2 3 7 8 9)");
+		PRINTS("@b", results[i]);
+		PRINTS("let b @c", "(x y 1 2 3 7 8 9)");
+	}
+	
+	PRINTS("let e (array)", "()");
+	PRINTS("pop @e", "Null");
+	PRINTS("insert @e 100 last", "1");
+	PRINTS("push 5 1", "Null");
+	
+	test_script_end(&ts);
+}
+
+#endif
+
+void do_array_tests() {
+	IF_ASSERTS(test1());
+	IF_ASSERTS(test2());
+	IF_ASSERTS(test3());
+}
@@ -0,0 +1,94 @@
+#include "../proj_utils.h"
+
+#include "test_script.h"
+
+#ifndef NO_INCLUDE_ASSERTS
+
+//reduce and fold over every kind of collection, with + applied natively and with a lambda
+static void test1() {
+	struct test_script ts;
+	test_script_start(&ts);
+	
+	const char *colls[] = { "(array 1 2 3)", "(ints 1 2 3)", "(range 1 4)", "(iter (array 1 2 3))", "(map (iter (ints 0 1 2)) (! x (+ @x 1)))" };
+	for(unsigned i = 0; i < LENOF(colls); i++) {
+		char src[256];
+		snprintf(src, sizeof(src), "(reduce %s @+)", colls[i]);
+		PRINTS(src, "6");
+		snprintf(src, sizeof(src), "(reduce %s (! acc x (+ @acc @x)))", colls[i]);
+		PRINTS(src, "6");
+		snprintf(src, sizeof(src), "(fold %s 10 @+)", colls[i]);
+		PRINTS(src, "16");
+		snprintf(src, sizeof(src), "(fold %s 10 (! acc x (- @acc @x)))", colls[i]);
+		PRINTS(src, "4");
+		snprintf(src, sizeof(src), "(reduce %s @-)", colls[i]);
+		PRINTS(src, "-4");
+		snprintf(src, sizeof(src), "(fold %s 1 @*)", colls[i]);
+		PRINTS(src, "6");
+	}
+	
+	PRINTS("(fold (array \"a\" \"b\") \"\" (! acc x (concat @acc @x)))", "ab");
+	PRINTS("(reduce (array (ints 1 2) (ints 10 20)) @+)", "#(11 22)");
+	PRINTS("(reduce (array 1 \"a\") @+)", "Null");
+	
+	test_script_end(&ts);
+}
+
+//Empty collections
+static void test2() {
+	struct test_script ts;
+	test_script_start(&ts);
+	
+	PRINTS("(reduce (array) @+)", "Null");
+	PRINTS("(reduce (ints) @+)", "Null");
+	PRINTS("(reduce (range 0) (! acc x @x))", "Null");
+	PRINTS("(fold (array) 5 @+)", "5");
+	PRINTS("(fold (range 3 3) 5 @+)", "5");
+	PRINTS("(fold (take (iter (array 1 2)) 0) 5 @+)", "5");
+	PRINTS("(sum (array))", "0");
+	PRINTS("(count (ints))", "0");
+	PRINTS("(min (array))", "Null");
+	PRINTS("(max (range 0))", "Null");
+	PRINTS("(mean (array))", "Null");
+	PRINTS("(any (array))", "0");
+	PRINTS("(all (array))", "1");
+	
+	test_script_end(&ts);
+}
+
+//The other aggregates, any and all with and without a predicate
+static void test3() {
+	struct test_script ts;
+	test_script_start(&ts);
+	
+	PRINTS("(sum (range 10 0 (- 0 3)))", "22");
+	PRINTS("(sum (range 0 3000000000 7))", "642857142642857142");
+	PRINTS("(sum (array 1 \"x\"))", "Null");
+	PRINTS("(count (array 3 1 4 1 5) (! x (> @x 2)))", "3");
+	PRINTS("(count (filter (iter (range 10)) (! x (> @x 6))))", "3");
+	PRINTS("(min (range 10 0 (- 0 3)))", "1");
+	PRINTS("(max (range 10 0 (- 0 3)))", "10");
+	PRINTS("(min (array \"pear\" \"apple\"))", "apple");
+	PRINTS("(max (iter (ints 3 9 2)))", "9");
+	PRINTS("(mean (range 1 5))", "2");
+	PRINTS("(mean (ints 9223372036854775807 9223372036854775807))", "Null");
+	PRINTS("(mean (ints 9223372036854775807 (- 0 9223372036854775807)))", "0");
+	
+	PRINTS("(any (array 0 \"\" 2))", "1");
+	PRINTS("(any (array 0 \"\"))", "0");
+	PRINTS("(all (array 1 \"a\"))", "1");
+	PRINTS("(all (array 1 0))", "0");
+	PRINTS("(any (range 5) (! x (> @x 3)))", "1");
+	PRINTS("(any (range 5) (! x (> @x 4)))", "0");
+	PRINTS("(all (ints 1 2 3) (! x (> @x 0)))", "1");
+	PRINTS("(all (iter (ints 1 2 3)) (! x (> @x 1)))", "0");
+	
+	test_script_end(&ts);
+}
+
+#endif
+
+void do_fold_tests() {
+	IF_ASSERTS(test1());
+	IF_ASSERTS(test2());
+	IF_ASSERTS(test3());
+}
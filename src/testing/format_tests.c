@@ -0,0 +1,31 @@
+#include "../proj_utils.h"
+
+#include "test_script.h"
+
+#ifndef NO_INCLUDE_ASSERTS
+
+//Compiled from a literal, so through the cache, and from a computed string
+static void test1() {
+	struct test_script ts;
+	test_script_start(&ts);
+	
+	PRINTS("format \"a%0b%1c\" 1 x", "a1bxc");
+	PRINTS("format \"%1%0\" 1 2", "21");
+	PRINTS("format \"%0%n\" 5", "5\n");
+	PRINTS("format \"%5-\" 1", "-");
+	PRINTS("format \"50%\"", "50%");
+	PRINTS("format \"%\"", "%");
+	PRINTS("format \"%0%\" 7", "7%");
+	
+	PRINTS("format (concat \"50\" \"%\")", "50%");
+	PRINTS("format (concat \"%0\" \"%\") 7", "7%");
+	PRINTS("format (concat \"%0\" \"b\") 7", "7b");
+	
+	test_script_end(&ts);
+}
+
+#endif
+
+void do_format_tests() {
+	IF_ASSERTS(test1());
+}
@@ -0,0 +1,104 @@
+#include "../proj_utils.h"
+
+#include "../interpreter/interpreter_intvec.h"
+
+#include "test_script.h"
+
+#include <string.h>
+
+#ifndef NO_INCLUDE_ASSERTS
+
+#define N_ITEMS 103 //Not a multiple of the vector width, so the scalar tails get tested too
+
+static void fill(r_int *a, unsigned long long seed) {
+	for(unsigned i = 0; i < N_ITEMS; i++) {
+		seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+		a[i] = (r_int) (seed >> 20) - (1LL << 43);
+	}
+}
+
+//The kernels against plain loops, including overflowing products and a negative scalar on the left
+static void test1() {
+	r_int a[N_ITEMS], b[N_ITEMS], out[N_ITEMS];
+	fill(a, 1);
+	fill(b, 2);
+	b[7] = a[7];
+	
+	int_intvec_apply(INTVEC_MUL, out, a, false, b, false, N_ITEMS);
+	for(unsigned i = 0; i < N_ITEMS; i++)
+		S_ASSERT(out[i] == (r_int) ((unsigned long long) a[i] * (unsigned long long) b[i]));
+	
+	r_int s = -5;
+	int_intvec_apply(INTVEC_SUB, out, &s, true, b, false, N_ITEMS);
+	for(unsigned i = 0; i < N_ITEMS; i++)
+		S_ASSERT(out[i] == -5 - b[i]);
+	
+	int_intvec_apply(INTVEC_LESS, out, a, false, b, false, N_ITEMS);
+	for(unsigned i = 0; i < N_ITEMS; i++)
+		S_ASSERT(out[i] == (a[i] < b[i]));
+	
+	int_intvec_apply(INTVEC_EQ, out, a, false, b, false, N_ITEMS);
+	S_ASSERT(out[7] == 1 && int_intvec_sum(out, N_ITEMS) == 1);
+	
+	r_int sum = 0, min = a[0], max = a[0];
+	size_t argmax = 0;
+	for(unsigned i = 0; i < N_ITEMS; i++) {
+		sum += a[i];
+		min = a[i] < min ? a[i] : min;
+		if(a[i] > max) {
+			max = a[i];
+			argmax = i;
+		}
+	}
+	S_ASSERT(int_intvec_sum(a, N_ITEMS) == sum);
+	S_ASSERT(int_intvec_min(a, N_ITEMS) == min && int_intvec_max(a, N_ITEMS) == max);
+	S_ASSERT(int_intvec_argmax(a, N_ITEMS) == argmax);
+}
+
+static void test2() {
+	r_int a[N_ITEMS], out[N_ITEMS];
+	fill(a, 3);
+	
+	int_intvec_prefix_sum(out, a, N_ITEMS);
+	r_int sum = 0;
+	for(unsigned i = 0; i < N_ITEMS; i++) {
+		sum += a[i];
+		S_ASSERT(out[i] == sum);
+	}
+	
+	//In place, as done for temporaries
+	r_int mask[N_ITEMS];
+	r_int zero = 0;
+	int_intvec_apply(INTVEC_GREATER, mask, a, false, &zero, true, N_ITEMS);
+	memcpy(out, a, sizeof(a));
+	size_t n = int_intvec_select(out, out, mask, N_ITEMS);
+	
+	size_t j = 0;
+	for(unsigned i = 0; i < N_ITEMS; i++) {
+		if(a[i] > 0)
+			S_ASSERT(j < n && out[j++] == a[i]);
+	}
+	S_ASSERT(j == n);
+}
+
+//Numeric strings that don't fit in an r_int are rejected rather than wrapped
+static void test3() {
+	struct test_script ts;
+	test_script_start(&ts);
+	
+	PRINTS("ints \"9223372036854775807\" \"-9223372036854775808\" \" +12 \"", "#(9223372036854775807 -9223372036854775808 12)");
+	PRINTS("ints \"9223372036854775808\"", "Null");
+	PRINTS("ints \"-9223372036854775809\"", "Null");
+	PRINTS("ints \"99999999999999999999999\"", "Null");
+	PRINTS("ints \"-\"", "Null");
+	
+	test_script_end(&ts);
+}
+
+#endif
+
+void do_intvec_tests() {
+	IF_ASSERTS(test1());
+	IF_ASSERTS(test2());
+	IF_ASSERTS(test3());
+}
@@ -0,0 +1,75 @@
+#include "../proj_utils.h"
+
+#include "../interpreter/interpreter_iter.h"
+
+#include "test_script.h"
+
+#include <string.h>
+
+#ifndef NO_INCLUDE_ASSERTS
+
+#define NULL_V ((struct r_val) { .type = TYPE_NULL })
+#define ITER_V(it) ((struct r_val) { .type = TYPE_ITER, .iter_v = (it) })
+
+//Stopping part way through gives back every reference the cursor took
+static void test1() {
+	struct r_array *array = int_new_array(4);
+	for(unsigned i = 0; i < array->len; i++)
+		array->items[i] = (struct r_val) { .type = TYPE_STR, .str_v = int_new_string("item", 4) };
+	struct r_val array_v = { .type = TYPE_ARRAY, .array_v = array };
+	
+	struct r_iter *src = int_new_iter(ITER_SOURCE, array_v, NULL_V, 0);
+	struct r_iter *take = int_new_iter(ITER_TAKE, ITER_V(src), NULL_V, 3);
+	S_ASSERT(array->ref_c == 2 && src->ref_c == 2);
+	
+	struct iter_cursor *cursor = int_iter_start(take);
+	struct r_val item;
+	S_ASSERT(int_iter_next(cursor, &item, NULL, "test"));
+	S_ASSERT(item.str_v == array->items[0].str_v && item.str_v->ref_c == 2);
+	int_decr_refcount(item);
+	S_ASSERT(int_iter_next(cursor, &item, NULL, "test"));
+	int_iter_end(cursor);
+	
+	S_ASSERT(item.str_v == array->items[1].str_v && item.str_v->ref_c == 2);
+	int_decr_refcount(item);
+	for(unsigned i = 0; i < array->len; i++)
+		S_ASSERT(array->items[i].str_v->ref_c == 1);
+	
+	//take stops after n items even with more in the source, and the iterator can be run again
+	struct r_array *taken = int_iter_collect(take, NULL, "test");
+	S_ASSERT(taken->len == 3 && taken->items[2].str_v == array->items[2].str_v && array->items[2].str_v->ref_c == 2);
+	int_decr_refcount((struct r_val) { .type = TYPE_ARRAY, .array_v = taken });
+	
+	int_decr_refcount(ITER_V(src));
+	int_decr_refcount(ITER_V(take));
+	S_ASSERT(array->ref_c == 1);
+	int_decr_refcount(array_v);
+}
+
+//Fused chains, take and zip through the builtins
+static void test2() {
+	struct test_script ts;
+	test_script_start(&ts);
+	
+	PRINTS("let it (map (filter (iter (range 10)) (! x (> @x 2))) (! x (* @x @x)))", "Iterator");
+	PRINTS("collect @it", "(9 16 25 36 49 64 81)");
+	PRINTS("collect (take @it 2)", "(9 16)");
+	PRINTS("collect (take @it 100)", "(9 16 25 36 49 64 81)");
+	PRINTS("collect (take @it 0)", "()");
+	PRINTS("collect (map (take (iter (ints 5 6 7)) 2) (! x (+ @x 1)))", "(6 7)");
+	PRINTS("collect (filter (iter (array 1 \"\" \"a\" 0)) (! x @x))", "(1 a)");
+	
+	PRINTS("collect (zip (array 1 2 3) (range 10 12))", "((1 10) (2 11))");
+	PRINTS("collect (zip @it (array a b))", "((9 a) (16 b))");
+	PRINTS("collect (zip (array) @it)", "()");
+	PRINTS("collect (take (zip (range 100) (range 100)) 1)", "((0 0))");
+	
+	test_script_end(&ts);
+}
+
+#endif
+
+void do_iter_tests() {
+	IF_ASSERTS(test1());
+	IF_ASSERTS(test2());
+}
@@ -0,0 +1,102 @@
+#include "../proj_utils.h"
+
+#include "../interpreter/interpreter_map.h"
+
+#include "test_script.h"
+
+#ifndef NO_INCLUDE_ASSERTS
+
+#define INT_V(v) ((struct r_val) { .type = TYPE_INT, .int_v = (v) })
+
+//Grows past several rebuilds while deleting, so lookups have to probe past tombstones
+static void test1() {
+	struct r_map *map = int_new_map(0);
+	
+	for(r_int i = 0; i < 1000; i++) {
+		int_map_set(map, INT_V(i), INT_V(i * 2));
+		if(i % 2 == 1)
+			S_ASSERT(int_map_del(map, INT_V(i - 1)));
+	}
+	
+	for(r_int i = 0; i < 1000; i++) {
+		struct r_val *v = int_map_get(map, INT_V(i));
+		S_ASSERT(i % 2 == 0 ? v == NULL : v != NULL && v->int_v == i * 2);
+	}
+	S_ASSERT(map->len == 500);
+	
+	unsigned n = 0;
+	INT_MAP_FOREACH(map, e)
+		n++;
+	S_ASSERT(n == map->len);
+	
+	struct r_map *copy = int_copy_map(map);
+	S_ASSERT(copy->len == map->len);
+	S_ASSERT(int_map_get(copy, INT_V(999)) != NULL && int_map_get(copy, INT_V(999))->int_v == 1998);
+	
+	int_free_map(copy);
+	int_free_map(map);
+}
+
+static void test2() {
+	struct r_map *map = int_new_map(2);
+	struct r_string *key = int_new_string("key", 3), *same = int_new_string("key", 3);
+	struct r_val key_v = { .type = TYPE_STR, .str_v = key }, same_v = { .type = TYPE_STR, .str_v = same };
+	
+	int_map_set(map, key_v, INT_V(1));
+	int_map_set(map, same_v, INT_V(2));
+	S_ASSERT(map->len == 1 && int_map_get(map, key_v)->int_v == 2);
+	S_ASSERT(int_map_get(map, INT_V(3)) == NULL);
+	
+	int_free_map(map);
+	int_decr_refcount(key_v);
+	int_decr_refcount(same_v);
+}
+
+//Bulk adds with duplicates, on top of existing entries and tombstones
+static void test3() {
+	struct r_map *set = int_new_map(0);
+	int_map_set(set, INT_V(-1), (struct r_val) { .type = TYPE_NULL });
+	int_map_set(set, INT_V(-2), (struct r_val) { .type = TYPE_NULL });
+	S_ASSERT(int_map_del(set, INT_V(-2)));
+	
+	struct r_val keys[3000];
+	for(unsigned i = 0; i < LENOF(keys); i++)
+		keys[i] = INT_V(i % 1000);
+	
+	int_map_add_keys(set, keys, LENOF(keys));
+	S_ASSERT(set->len == 1001);
+	S_ASSERT(int_map_get(set, INT_V(-1)) != NULL && int_map_get(set, INT_V(-2)) == NULL);
+	
+	for(r_int i = 0; i < 1000; i++) {
+		struct r_val *v = int_map_get(set, INT_V(i));
+		S_ASSERT(v != NULL && v->type == TYPE_NULL);
+	}
+	
+	int_free_map(set);
+}
+
+//A map can't be put into itself, directly or through what it holds
+static void test4() {
+	struct test_script ts;
+	test_script_start(&ts);
+	
+	PRINTS("let m (hashmap 1 2)", "{1 2}");
+	PRINTS("put @m self @m", "Null");
+	PRINTS("put @m list (array 1 (array @m))", "Null");
+	PRINTS("put (hashmap) inner @m", "{inner {1 2}}");
+	PRINTS("let outer (hashmap inner @m)", "{inner {1 2}}");
+	PRINTS("put @m outer @outer", "Null");
+	PRINTS("put @m other (hashmap 3 4)", "{1 2, other {3 4}}");
+	PRINTS("length (keys @m)", "2");
+	
+	test_script_end(&ts);
+}
+
+#endif
+
+void do_map_tests() {
+	IF_ASSERTS(test1());
+	IF_ASSERTS(test2());
+	IF_ASSERTS(test3());
+	IF_ASSERTS(test4());
+}
@@ -0,0 +1,231 @@
+#include "../proj_utils.h"
+
+#include "../interpreter/interpreter_pvec.h"
+#include "../interpreter/interpreter_pmap.h"
+
+#include <string.h>
+
+#ifndef NO_INCLUDE_ASSERTS
+
+#define INT_V(v) ((struct r_val) { .type = TYPE_INT, .int_v = (v) })
+
+//Every kept version has to stay as it was, across tails moving into the trie and the root growing a level
+static void test1() {
+	struct r_pvec *versions[40];
+	struct r_pvec *vec = int_new_pvec(NULL, 0);
+	
+	for(unsigned i = 0; i < 40000; i++) {
+		if(i % 1000 == 0)
+			versions[i / 1000] = vec;
+		
+		struct r_pvec *next = int_pvec_push(vec, INT_V(i));
+		if(i % 1000 != 0)
+			int_free_pvec(vec);
+		vec = next;
+	}
+	
+	for(unsigned v = 0; v < LENOF(versions); v++) {
+		S_ASSERT(versions[v]->len == v * 1000);
+		for(unsigned i = 0; i < versions[v]->len; i += 7)
+			S_ASSERT(int_pvec_get(versions[v], i).int_v == i);
+		int_free_pvec(versions[v]);
+	}
+	
+	struct r_pvec *in_trie = int_pvec_set(vec, 1234, INT_V(-1));
+	struct r_pvec *changed = int_pvec_set(in_trie, 39999, INT_V(-2));
+	int_free_pvec(in_trie);
+	S_ASSERT(int_pvec_get(vec, 1234).int_v == 1234 && int_pvec_get(changed, 1234).int_v == -1);
+	S_ASSERT(int_pvec_get(vec, 39999).int_v == 39999 && int_pvec_get(changed, 39999).int_v == -2);
+	
+	struct r_val items[100];
+	for(unsigned i = 0; i < LENOF(items); i++)
+		items[i] = INT_V(i * 3);
+	struct r_pvec *built = int_new_pvec(items, LENOF(items));
+	S_ASSERT(built->len == 100 && int_pvec_get(built, 99).int_v == 297 && int_pvec_get(built, 31).int_v == 93);
+	
+	int_free_pvec(built);
+	int_free_pvec(changed);
+	int_free_pvec(vec);
+}
+
+//Shared items are released once the last version holding them is gone
+static void test2() {
+	struct r_val str = { .type = TYPE_STR, .str_v = int_new_string("item", 4) };
+	
+	struct r_pvec *a = int_new_pvec(&str, 1);
+	struct r_pvec *b = int_pvec_push(a, str);
+	struct r_pmap *empty = int_new_pmap();
+	struct r_pmap *m = int_pmap_set(empty, str, str);
+	int_free_pmap(empty);
+	S_ASSERT(str.str_v->ref_c == 6);
+	
+	int_free_pvec(a);
+	int_free_pvec(b);
+	empty = int_pmap_del(m, str);
+	S_ASSERT(empty->len == 0 && int_pmap_get(empty, str) == NULL);
+	int_free_pmap(m);
+	int_free_pmap(empty);
+	
+	S_ASSERT(str.str_v->ref_c == 1);
+	int_decr_refcount(str);
+}
+
+//Checked against a hash map while adding and removing keys, keeping the old versions intact
+static void test3() {
+	struct r_map *ref = int_new_map(0);
+	struct r_pmap *map = int_new_pmap();
+	struct r_pmap *half = NULL;
+	struct r_map *ref_half = NULL;
+	
+	unsigned long long x = 12345;
+	for(unsigned i = 0; i < 20000; i++) {
+		x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+		struct r_val key = INT_V((x >> 33) % 5000);
+		
+		//half is the version from before this step
+		if(i == 10000)
+			ref_half = int_copy_map(ref);
+		
+		struct r_pmap *next;
+		if(i % 3 == 2) {
+			next = int_pmap_del(map, key);
+			int_map_del(ref, key);
+		} else {
+			next = int_pmap_set(map, key, INT_V(i));
+			int_map_set(ref, key, INT_V(i));
+		}
+		
+		if(i == 10000)
+			half = map;
+		else
+			int_free_pmap(map);
+		map = next;
+	}
+	
+	S_ASSERT(map->len == ref->len);
+	for(r_int k = 0; k < 5000; k++) {
+		struct r_val *a = int_pmap_get(map, INT_V(k)), *b = int_map_get(ref, INT_V(k));
+		S_ASSERT((a == NULL) == (b == NULL));
+		S_ASSERT(a == NULL || a->int_v == b->int_v);
+	}
+	
+	S_ASSERT(half->len == ref_half->len);
+	for(r_int k = 0; k < 5000; k++) {
+		struct r_val *a = int_pmap_get(half, INT_V(k)), *b = int_map_get(ref_half, INT_V(k));
+		S_ASSERT((a == NULL) == (b == NULL));
+		S_ASSERT(a == NULL || a->int_v == b->int_v);
+	}
+	
+	int_pmap_set_in_place(map, INT_V(-1), INT_V(1));
+	S_ASSERT(map->len == ref->len + 1 && int_pmap_get(half, INT_V(-1)) == NULL);
+	
+	int_free_pmap(half);
+	int_free_pmap(map);
+	int_free_map(ref_half);
+	int_free_map(ref);
+}
+
+//Strings with their hash cached up front, so keys can be made to collide
+static struct r_val hashed_key(const char *s, unsigned long long hash) {
+	struct r_string *str = int_new_string(s, strlen(s));
+	str->hash = hash;
+	str->flags |= R_STRING_HASHED;
+	return (struct r_val) { .type = TYPE_STR, .str_v = str };
+}
+
+//Keys whose whole hash is equal end up in one collision node past the last level, which folds back up as it empties
+static void test4() {
+	const unsigned long long hash = 0x0123456789abcdefULL;
+	struct r_val keys[4];
+	for(unsigned i = 0; i < LENOF(keys); i++)
+		keys[i] = hashed_key((const char *[]) { "a", "b", "c", "d" }[i], hash);
+	struct r_val missing = hashed_key("e", hash), near = hashed_key("f", hash ^ (1ULL << 63));
+	
+	struct r_pmap *versions[LENOF(keys) + 1];
+	versions[0] = int_new_pmap();
+	for(unsigned i = 0; i < LENOF(keys); i++)
+		versions[i + 1] = int_pmap_set(versions[i], keys[i], INT_V(i));
+	
+	struct r_pmap *full = versions[LENOF(keys)];
+	S_ASSERT(full->len == 4 && int_pmap_get(full, missing) == NULL);
+	for(unsigned i = 0; i < LENOF(keys); i++)
+		S_ASSERT(int_pmap_get(full, keys[i])->int_v == i);
+	
+	struct r_pmap *with_near = int_pmap_set(full, near, INT_V(10));
+	struct r_pmap *replaced = int_pmap_set(with_near, keys[1], INT_V(11));
+	struct r_pmap *unchanged = int_pmap_del(replaced, missing);
+	S_ASSERT(with_near->len == 5 && replaced->len == 5 && unchanged->len == 5 && unchanged->root == replaced->root);
+	S_ASSERT(int_pmap_get(replaced, keys[1])->int_v == 11 && int_pmap_get(with_near, keys[1])->int_v == 1);
+	S_ASSERT(int_pmap_get(replaced, near)->int_v == 10 && int_pmap_get(full, near) == NULL);
+	int_free_pmap(unchanged);
+	int_free_pmap(replaced);
+	int_free_pmap(with_near);
+	
+	struct r_pmap *map = int_pmap_del(full, missing);
+	for(unsigned i = 0; i < LENOF(keys); i++) {
+		struct r_pmap *next = int_pmap_del(map, keys[i]);
+		int_free_pmap(map);
+		map = next;
+		
+		S_ASSERT(map->len == LENOF(keys) - i - 1 && int_pmap_get(map, keys[i]) == NULL);
+		for(unsigned j = i + 1; j < LENOF(keys); j++)
+			S_ASSERT(int_pmap_get(map, keys[j])->int_v == j);
+		
+		//A lone entry left over is kept inline in the root rather than at the bottom of a chain of subtries
+		if(map->len == 1)
+			S_ASSERT(map->root->node_map == 0 && map->root->n_data == 1);
+	}
+	S_ASSERT(map->root->node_map == 0 && map->root->n_data == 0);
+	int_free_pmap(map);
+	
+	for(unsigned v = 0; v <= LENOF(keys); v++) {
+		S_ASSERT(versions[v]->len == v);
+		for(unsigned i = 0; i < v; i++)
+			S_ASSERT(int_pmap_get(versions[v], keys[i])->int_v == i);
+		int_free_pmap(versions[v]);
+	}
+	
+	for(unsigned i = 0; i < LENOF(keys); i++) {
+		S_ASSERT(keys[i].str_v->ref_c == 1);
+		int_decr_refcount(keys[i]);
+	}
+	int_decr_refcount(missing);
+	int_decr_refcount(near);
+}
+
+//Removing every key again, in another order, leaves a map with nothing but an empty root
+static void test5() {
+	struct r_pmap *map = int_new_pmap();
+	for(r_int k = 0; k < 3000; k++)
+		int_pmap_set_in_place(map, INT_V(k), INT_V(k * 2));
+	S_ASSERT(map->len == 3000 && map->root->node_map != 0);
+	
+	for(r_int i = 0; i < 3000; i++) {
+		r_int k = (i * 7) % 3000;
+		struct r_pmap *next = int_pmap_del(map, INT_V(k));
+		S_ASSERT(next->len == map->len - 1 && int_pmap_get(next, INT_V(k)) == NULL);
+		S_ASSERT(int_pmap_get(map, INT_V(k))->int_v == k * 2);
+		int_free_pmap(map);
+		map = next;
+		
+		if(i % 500 == 0) {
+			for(r_int j = i + 1; j < 3000; j++)
+				S_ASSERT(int_pmap_get(map, INT_V((j * 7) % 3000))->int_v == (j * 7) % 3000 * 2);
+		}
+		if(map->len == 1)
+			S_ASSERT(map->root->node_map == 0 && map->root->n_data == 1);
+	}
+	
+	S_ASSERT(map->len == 0 && map->root->node_map == 0 && map->root->data_map == 0 && map->root->n_data == 0);
+	int_free_pmap(map);
+}
+
+#endif
+
+void do_persistent_tests() {
+	IF_ASSERTS(test1());
+	IF_ASSERTS(test2());
+	IF_ASSERTS(test3());
+	IF_ASSERTS(test4());
+	IF_ASSERTS(test5());
+}
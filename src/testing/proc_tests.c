@@ -0,0 +1,65 @@
+#include "../proj_utils.h"
+
+#include "../rlib/rlib_proc.h"
+
+#include "test_script.h"
+
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#ifndef NO_INCLUDE_ASSERTS
+
+//Writing to a coprocess that has exited evaluates to Null instead of SIGPIPE ending the interpreter
+static void test1() {
+	struct test_script ts;
+	test_script_start(&ts);
+	rlib_proc_put(ts.env);
+	
+	//The command announcements and the write error are expected, so they are kept out of the test output
+	fflush(stdout);
+	fflush(stderr);
+	int saved_in = dup(STDIN_FILENO), saved_out = dup(STDOUT_FILENO), saved_err = dup(STDERR_FILENO);
+	int null_fd = open("/dev/null", O_WRONLY);
+	dup2(null_fd, STDOUT_FILENO);
+	dup2(null_fd, STDERR_FILENO);
+	
+	//Debug builds ask before running each command, so both coprocesses are approved up front
+	int answers[2];
+	S_ASSERT(pipe(answers) == 0);
+	S_ASSERT(write(answers[1], "y\ny\n", 4) == 4);
+	close(answers[1]);
+	dup2(answers[0], STDIN_FILENO);
+	close(answers[0]);
+	
+	int_decr_refcount(test_eval(&ts, "let live (coproc cat)"));
+	PRINTS("coproc-call @live hello", "hello");
+	PRINTS("coproc-close @live", "Null");
+	
+	//Its stdin is closed before the line is written, so once that line is read nothing is left to read what is sent to it
+	int_decr_refcount(test_eval(&ts, "let dead (coproc sh -c \"exec <&-; echo closed\")"));
+	PRINTS("coproc-readline @dead", "closed");
+	PRINTS("coproc-readline @dead", "Null");
+	PRINTS("coproc-write @dead hello", "Null");
+	PRINTS("coproc-call @dead hello", "Null");
+	PRINTS("coproc-close @dead", "Null");
+	
+	fflush(stdout);
+	fflush(stderr);
+	dup2(saved_in, STDIN_FILENO);
+	dup2(saved_out, STDOUT_FILENO);
+	dup2(saved_err, STDERR_FILENO);
+	close(saved_in);
+	close(saved_out);
+	close(saved_err);
+	close(null_fd);
+	clearerr(stdin);
+	
+	test_script_end(&ts);
+}
+
+#endif
+
+void do_proc_tests() {
+	IF_ASSERTS(test1());
+}
@@ -0,0 +1,64 @@
+#include "../proj_utils.h"
+
+#include "test_script.h"
+
+#ifndef NO_INCLUDE_ASSERTS
+
+//Ranges with negative steps, empty ranges and indices outside them
+static void test1() {
+	struct test_script ts;
+	test_script_start(&ts);
+	
+	PRINTS("range 10 0 (- 0 3)", "(range 10 0 -3)");
+	PRINTS("collect (range 10 0 (- 0 3))", "(10 7 4 1)");
+	PRINTS("collect (range (- 0 2) (- 0 6) (- 0 2))", "(-2 -4)");
+	PRINTS("length (range 10 0 (- 0 3))", "4");
+	PRINTS("collect (range 5 5)", "()");
+	PRINTS("length (range 5 0)", "0");
+	PRINTS("length (range 0 5 (- 0 1))", "0");
+	PRINTS("range 1 2 0", "Null");
+	
+	PRINTS("index (range 0 10 3) 3", "9");
+	PRINTS("index (range 0 10 3) 4", "Null");
+	PRINTS("index (range 0 10 3) (- 0 1)", "9");
+	PRINTS("index (range 0 10 3) (- 0 4)", "0");
+	PRINTS("index (range 0 10 3) (- 0 5)", "Null");
+	PRINTS("index (range 3 3) 0", "Null");
+	PRINTS("index (range 10 0 (- 0 3)) 1", "7");
+	
+	PRINTS("map (range 10 0 (- 0 3)) (! x (* @x 2))", "#(20 14 8 2)");
+	PRINTS("filter (range 10) (! x (> @x 6))", "#(7 8 9)");
+	
+	test_script_end(&ts);
+}
+
+//for over each kind of collection it takes, leaving the variable at the last item
+static void test2() {
+	struct test_script ts;
+	test_script_start(&ts);
+	
+	PRINTS("let acc (array)", "()");
+	PRINTS("for x (range 10 0 (- 0 3)) (push @acc @x)", "Null");
+	PRINTS("@acc", "(10 7 4 1)");
+	PRINTS("@x", "1");
+	
+	PRINTS("let n 0", "0");
+	PRINTS("for x (range 5 5) (let n (+ @n 1))", "Null");
+	PRINTS("for x (range 0 5 (- 0 1)) (let n (+ @n 1))", "Null");
+	PRINTS("@n", "0");
+	
+	PRINTS("for x (ints 1 2 3) (let n (+ @n @x))", "Null");
+	PRINTS("for x (array 10 20) (let n (+ @n @x))", "Null");
+	PRINTS("for x (pvec 100 200) (let n (+ @n @x))", "Null");
+	PRINTS("for x (take (iter (range 1000 2000)) 2) (let n (+ @n @x))", "Null");
+	PRINTS("@n", "2337");
+	
+	test_script_end(&ts);
+}
+
+#endif
+
+void do_range_tests() {
+	IF_ASSERTS(test1());
+	IF_ASSERTS(test2());
+}
@@ -0,0 +1,64 @@
+#include "../proj_utils.h"
+
+#include "../regex/regex.h"
+
+#include <string.h>
+
+//The checks are all asserts, so there is nothing to run without them
+#ifndef NO_INCLUDE_ASSERTS
+
+static bool find_str(const char *pattern, const char *str, size_t from, size_t *start, size_t *end) {
+	const char *err;
+	struct regex *re = regex_compile(pattern, strlen(pattern), &err);
+	S_ASSERT(re != NULL);
+	
+	bool found = regex_find(re, str, strlen(str), from, start, end);
+	regex_free(re);
+	return found;
+}
+
+static bool is_match(const char *pattern, const char *str) {
+	const char *err;
+	struct regex *re = regex_compile(pattern, strlen(pattern), &err);
+	S_ASSERT(re != NULL);
+	
+	bool res = regex_is_match(re, str, strlen(str));
+	regex_free(re);
+	return res;
+}
+
+static void test1() {
+	S_ASSERT(is_match("abc", "xxabcxx"));
+	S_ASSERT(!is_match("abd", "xxabcxx"));
+	S_ASSERT(is_match("^a.c$", "abc"));
+	S_ASSERT(!is_match("^b", "abc"));
+	S_ASSERT(is_match("x|b+c", "abbbc"));
+	S_ASSERT(is_match("[a-c]{3}", "zzcab"));
+	S_ASSERT(!is_match("[a-c]{3}", "zzca"));
+	S_ASSERT(is_match("\\d+\\.\\d+", "v1.25"));
+	S_ASSERT(is_match("", ""));
+	S_ASSERT(!is_match("a\\S", "a "));
+	
+	const char *err;
+	S_ASSERT(regex_compile("(ab", 3, &err) == NULL);
+	S_ASSERT(regex_compile("*a", 2, &err) == NULL);
+	S_ASSERT(regex_compile("[a", 2, &err) == NULL);
+}
+
+static void test2() {
+	size_t start, end;
+	
+	//Leftmost, then longest
+	S_ASSERT(find_str("b+|ab", "xabbb", 0, &start, &end) && start == 1 && end == 3);
+	S_ASSERT(find_str("a(bc|b)c?", "abcc", 0, &start, &end) && start == 0 && end == 4);
+	S_ASSERT(find_str("o+", "foo boo", 3, &start, &end) && start == 5 && end == 7);
+	S_ASSERT(find_str("x*$", "abc", 0, &start, &end) && start == 3 && end == 3);
+	S_ASSERT(!find_str("^a", "aaa", 1, &start, &end));
+}
+
+#endif
+
+void do_regex_tests() {
+	IF_ASSERTS(test1());
+	IF_ASSERTS(test2());
+}
@@ -0,0 +1,57 @@
+#include "../proj_utils.h"
+
+#include "test_script.h"
+
+#ifndef NO_INCLUDE_ASSERTS
+
+//Builtins that can reuse a temporary argument leave one held by a variable as it was
+static void test1() {
+	struct test_script ts;
+	test_script_start(&ts);
+	
+	PRINTS("let s \"  Ab c  \"", "  Ab c  ");
+	PRINTS("upper @s", "  AB C  ");
+	PRINTS("lower @s", "  ab c  ");
+	PRINTS("trim @s", "Ab c");
+	PRINTS("@s", "  Ab c  ");
+	
+	PRINTS("let a (array 1 2 3 4)", "(1 2 3 4)");
+	PRINTS("map @a (! x (* @x 10))", "(10 20 30 40)");
+	PRINTS("filter @a (! x (> @x 2))", "(3 4)");
+	PRINTS("@a", "(1 2 3 4)");
+	
+	//An item of a variable's array is shared too
+	PRINTS("let w (array \"ab\" \" cd \")", "(ab  cd )");
+	PRINTS("map @w (! x (upper (trim @x)))", "(AB CD)");
+	PRINTS("@w", "(ab  cd )");
+	
+	test_script_end(&ts);
+}
+
+//A temporary argument is written over instead of allocating the result
+static void test2() {
+	struct test_script ts;
+	test_script_start(&ts);
+	
+	unsigned long long concat = test_count_allocs(&ts, "concat \" ab\" \"cd \"");
+	S_ASSERT(concat > 0);
+	S_ASSERT(test_count_allocs(&ts, "upper (concat \" ab\" \"cd \")") == concat);
+	S_ASSERT(test_count_allocs(&ts, "lower (concat \" ab\" \"cd \")") == concat);
+	S_ASSERT(test_count_allocs(&ts, "trim (concat \" ab\" \"cd \")") == concat);
+	
+	PRINTS("let a (array 1 2 3 4)", "(1 2 3 4)");
+	unsigned long long array = test_count_allocs(&ts, "array 1 2 3 4");
+	unsigned long long map_shared = test_count_allocs(&ts, "map @a (! x (* @x 10))");
+	unsigned long long filter_shared = test_count_allocs(&ts, "filter @a (! x (> @x 2))");
+	S_ASSERT(test_count_allocs(&ts, "map (array 1 2 3 4) (! x (* @x 10))") < array + map_shared);
+	S_ASSERT(test_count_allocs(&ts, "filter (array 1 2 3 4) (! x (> @x 2))") < array + filter_shared);
+	
+	test_script_end(&ts);
+}
+
+#endif
+
+void do_reuse_tests() {
+	IF_ASSERTS(test1());
+	IF_ASSERTS(test2());
+}
@@ -0,0 +1,121 @@
+#include "../proj_utils.h"
+
+#include "../str_search.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_INPUT_LEN (8 * 1024 * 1024)
+#define BENCH_RUNS 5
+
+static double now_ms() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+//Log-like text: words separated by spaces with a few punctuation characters sprinkled in
+static char *make_input(size_t len) {
+	static const char *words[] = { "GET", "/index.html", "200", "user=alice", "POST", "latency", "ms", "WARN", "cache", "miss" };
+	static const char seps[] = "  ,; :=|\t";
+	
+	char *buff = s_alloc(len);
+	unsigned long long r = 42;
+	size_t i = 0;
+	
+	while(i < len) {
+		r = r * 6364136223846793005ULL + 1442695040888963407ULL;
+		const char *w = words[(r >> 33) % LENOF(words)];
+		for(; *w && i < len; w++)
+			buff[i++] = *w;
+		
+		if(i < len)
+			buff[i++] = ((r >> 40) % 64 == 0) ? '\n' : seps[(r >> 45) % (sizeof(seps) - 1)];
+	}
+	
+	return buff;
+}
+
+static size_t naive_count(const char *hay, size_t len, const lstring *needles, unsigned n) {
+	size_t count = 0;
+	for(size_t i = 0; i < len;) {
+		bool matched = false;
+		for(unsigned j = 0; j < n; j++) {
+			if(needles[j].len <= len - i && memcmp(hay + i, needles[j].str, needles[j].len) == 0) {
+				i += needles[j].len;
+				count++;
+				matched = true;
+				break;
+			}
+		}
+		if(!matched)
+			i++;
+	}
+	
+	return count;
+}
+
+static size_t search_count(const char *hay, size_t len, const lstring *needles, unsigned n) {
+	struct str_search s;
+	str_search_init(&s, needles, n);
+	
+	size_t count = 0, from = 0, pos, m_len;
+	while(str_search_next(&s, hay, len, from, &pos, &m_len)) {
+		from = pos + m_len;
+		count++;
+	}
+	
+	str_search_free(&s);
+	return count;
+}
+
+static void run_case(const char *name, const char *input, const lstring *needles, unsigned n) {
+	double naive_best = 0, search_best = 0;
+	size_t naive_c = 0, search_c = 0;
+	
+	for(unsigned r = 0; r < BENCH_RUNS; r++) {
+		double t = now_ms();
+		naive_c = naive_count(input, BENCH_INPUT_LEN, needles, n);
+		t = now_ms() - t;
+		if(r == 0 || t < naive_best)
+			naive_best = t;
+		
+		t = now_ms();
+		search_c = search_count(input, BENCH_INPUT_LEN, needles, n);
+		t = now_ms() - t;
+		if(r == 0 || t < search_best)
+			search_best = t;
+	}
+	
+	if(naive_c != search_c)
+		printf("%s: match count mismatch, naive %zu search %zu\n", name, naive_c, search_c);
+	
+	printf("%-28s %10zu matches   naive %8.2f ms   search %8.2f ms   %6.1fx\n",
+		name, search_c, naive_best, search_best, naive_best / search_best);
+}
+
+void do_search_bench() {
+	char *input = make_input(BENCH_INPUT_LEN);
+	
+	printf("split/contains search over %i MiB, best of %i runs\n", BENCH_INPUT_LEN / (1024 * 1024), BENCH_RUNS);
+	
+	const lstring one[] = { LSTRING("\n") };
+	run_case("1 delimiter (byte)", input, one, LENOF(one));
+	
+	const lstring two[] = { LSTRING(","), LSTRING(";") };
+	run_case("2 delimiters (bytes)", input, two, LENOF(two));
+	
+	const lstring substr[] = { LSTRING("WARN") };
+	run_case("1 delimiter (substring)", input, substr, LENOF(substr));
+	
+	const lstring sixteen[] = {
+		LSTRING("ERROR"), LSTRING("WARN"), LSTRING("FATAL"), LSTRING("timeout"),
+		LSTRING("user=bob"), LSTRING("500"), LSTRING("404"), LSTRING("/admin"),
+		LSTRING("DELETE"), LSTRING("PUT"), LSTRING("miss"), LSTRING("denied"),
+		LSTRING("panic"), LSTRING("retry"), LSTRING("=alice"), LSTRING("|")
+	};
+	run_case("16 delimiters (mixed)", input, sixteen, LENOF(sixteen));
+	
+	s_dealloc(input);
+}
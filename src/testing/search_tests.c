@@ -0,0 +1,75 @@
+#include "../proj_utils.h"
+
+#include "../str_search.h"
+
+#include <string.h>
+
+//Reference: try every needle, in order, at every position
+static bool naive_search(const char *hay, size_t len, const lstring *needles, unsigned n, size_t from, size_t *pos, size_t *n_len) {
+	for(size_t i = from; i < len; i++) {
+		for(unsigned j = 0; j < n; j++) {
+			if(needles[j].len != 0 && needles[j].len <= len - i && memcmp(hay + i, needles[j].str, needles[j].len) == 0) {
+				*pos = i;
+				*n_len = needles[j].len;
+				return true;
+			}
+		}
+	}
+	
+	return false;
+}
+
+static void check_all_matches(const char *hay, const lstring *needles, unsigned n) {
+	size_t len = strlen(hay);
+	
+	struct str_search s;
+	str_search_init(&s, needles, n);
+	
+	size_t from = 0;
+	for(;;) {
+		size_t pos, m_len, naive_pos = 0, naive_len = 0;
+		bool found = str_search_next(&s, hay, len, from, &pos, &m_len);
+		bool naive_found = naive_search(hay, len, needles, n, from, &naive_pos, &naive_len);
+		
+		S_ASSERT(found == naive_found);
+		(void) naive_found;
+		if(!found)
+			break;
+		
+		S_ASSERT(pos == naive_pos && m_len == naive_len);
+		from = pos + m_len;
+	}
+	
+	str_search_free(&s);
+}
+
+static void test1() {
+	const lstring byte[] = { LSTRING(",") };
+	check_all_matches("a,b,,c,", byte, LENOF(byte));
+	
+	const lstring bytes[] = { LSTRING(","), LSTRING(";"), LSTRING(" ") };
+	check_all_matches("a long, line; with separators at the end of the sixteen byte blocks;;;", bytes, LENOF(bytes));
+	
+	const lstring many_bytes[] = { LSTRING("a"), LSTRING("e"), LSTRING("i"), LSTRING("o"), LSTRING("u"), LSTRING("y") };
+	check_all_matches("the quick brown fox jumps over the lazy dog", many_bytes, LENOF(many_bytes));
+}
+
+static void test2() {
+	const lstring substr[] = { LSTRING("abab") };
+	check_all_matches("abababcabababab", substr, LENOF(substr));
+	
+	//Earlier needles win at the same position, earlier positions win over needle order
+	const lstring multi[] = { LSTRING("-"), LSTRING("--"), LSTRING("bcd"), LSTRING("abcde"), LSTRING("") };
+	check_all_matches("a--b---abcdef-bcd", multi, LENOF(multi));
+	
+	const lstring overlapping[] = { LSTRING("he"), LSTRING("she"), LSTRING("his"), LSTRING("hers") };
+	check_all_matches("ushers shishe hishers", overlapping, LENOF(overlapping));
+	
+	const lstring empty[] = { LSTRING("") };
+	check_all_matches("abc", empty, LENOF(empty));
+}
+
+void do_search_tests() {
+	test1();
+	test2();
+}
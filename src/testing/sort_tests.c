@@ -0,0 +1,113 @@
+#include "../proj_utils.h"
+
+#include "../sort.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#ifndef NO_INCLUDE_ASSERTS
+
+#define N_ITEMS 5003 //Enough for the radix passes and several levels of partitioning
+
+static unsigned long long next_rand(unsigned long long *seed) {
+	*seed = *seed * 6364136223846793005ULL + 1442695040888963407ULL;
+	return *seed >> 11;
+}
+
+//Ints against their expected order, with a payload that shows equal keys keep their order
+static void test1() {
+	r_int *keys = NSALLOC(r_int, N_ITEMS);
+	unsigned *payload = NSALLOC(unsigned, N_ITEMS);
+	
+	unsigned long long seed = 1;
+	for(unsigned i = 0; i < N_ITEMS; i++) {
+		keys[i] = (r_int) (next_rand(&seed) % 2001) - 1000;
+		if(i % 7 == 0)
+			keys[i] = (r_int) (next_rand(&seed) << 11); //Big and negative keys exercise the high byte passes
+		payload[i] = i;
+	}
+	r_int *orig = NSALLOC(r_int, N_ITEMS);
+	memcpy(orig, keys, sizeof(r_int) * N_ITEMS);
+	
+	sort_ints(keys, payload, N_ITEMS);
+	for(unsigned i = 0; i < N_ITEMS; i++) {
+		S_ASSERT(orig[payload[i]] == keys[i]);
+		if(i > 0) {
+			S_ASSERT(keys[i - 1] <= keys[i]);
+			S_ASSERT(keys[i - 1] != keys[i] || payload[i - 1] < payload[i]);
+		}
+	}
+	
+	r_int small[] = { 3, -1, 0, -9223372036854775807LL - 1, 9223372036854775807LL, 3 };
+	sort_ints(small, NULL, 6);
+	S_ASSERT(small[0] < -1 && small[1] == -1 && small[2] == 0 && small[3] == 3 && small[4] == 3 && small[5] > 3);
+	
+	s_dealloc(keys);
+	s_dealloc(payload);
+	s_dealloc(orig);
+}
+
+static int cmp_bytes(const struct sort_str *a, const struct sort_str *b) {
+	unsigned len = a->len < b->len ? a->len : b->len;
+	int res = memcmp(a->str, b->str, len);
+	if(res != 0)
+		return res;
+	return a->len < b->len ? -1 : a->len > b->len;
+}
+
+//Strings sharing long prefixes, prefixes of each other and zero bytes, which a C string comparison would get wrong
+static void test2() {
+	struct sort_str *strs = NSALLOC(struct sort_str, N_ITEMS);
+	char *bytes = s_alloc(N_ITEMS * 24);
+	
+	unsigned long long seed = 2;
+	for(unsigned i = 0; i < N_ITEMS; i++) {
+		char *str = bytes + i * 24;
+		unsigned len = next_rand(&seed) % 24;
+		for(unsigned j = 0; j < len; j++)
+			str[j] = j < 10 ? 'a' : "\0abz"[next_rand(&seed) % 4];
+		strs[i] = (struct sort_str) { .str = str, .len = len, .idx = i };
+	}
+	
+	sort_strs(strs, N_ITEMS);
+	for(unsigned i = 1; i < N_ITEMS; i++) {
+		int res = cmp_bytes(&strs[i - 1], &strs[i]);
+		S_ASSERT(res < 0 || (res == 0 && strs[i - 1].idx < strs[i].idx));
+	}
+	
+	s_dealloc(strs);
+	s_dealloc(bytes);
+}
+
+struct pair {
+	int key, idx;
+};
+
+static int cmp_pair(const void *a, const void *b, void *ctx) {
+	(void) ctx;
+	return ((const struct pair *) a)->key - ((const struct pair *) b)->key;
+}
+
+//The merge sort keeps equal items in order
+static void test3() {
+	struct pair *pairs = NSALLOC(struct pair, N_ITEMS);
+	unsigned long long seed = 3;
+	for(unsigned i = 0; i < N_ITEMS; i++)
+		pairs[i] = (struct pair) { .key = next_rand(&seed) % 50, .idx = i };
+	
+	sort_stable(pairs, N_ITEMS, sizeof(struct pair), cmp_pair, NULL);
+	for(unsigned i = 1; i < N_ITEMS; i++) {
+		S_ASSERT(pairs[i - 1].key <= pairs[i].key);
+		S_ASSERT(pairs[i - 1].key != pairs[i].key || pairs[i - 1].idx < pairs[i].idx);
+	}
+	
+	s_dealloc(pairs);
+}
+
+#endif
+
+void do_sort_tests() {
+	IF_ASSERTS(test1());
+	IF_ASSERTS(test2());
+	IF_ASSERTS(test3());
+}
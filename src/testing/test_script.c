@@ -0,0 +1,83 @@
+#include "test_script.h"
+
+#include "../interpreter/interpreter_fmt.h"
+
+#include "../rlib/rlib_basic.h"
+#include "../rlib/rlib_strutils.h"
+#include "../rlib/rlib_map.h"
+#include "../rlib/rlib_array.h"
+#include "../rlib/rlib_persistent.h"
+#include "../rlib/rlib_intvec.h"
+#include "../rlib/rlib_iter.h"
+#include "../rlib/rlib_sort.h"
+#include "../rlib/rlib_fold.h"
+
+#include <string.h>
+
+#ifndef NO_INCLUDE_ASSERTS
+
+void test_script_start(struct test_script *ts) {
+	ts->env = int_new_env();
+	ts->parse_region = NEW_REGION();
+	ts->sym_region = NEW_REGION();
+	
+	rlib_basic_put(ts->env);
+	rlib_strutils_put(ts->env);
+	rlib_map_put(ts->env);
+	rlib_array_put(ts->env);
+	rlib_persistent_put(ts->env);
+	rlib_intvec_put(ts->env);
+	rlib_iter_put(ts->env);
+	rlib_sort_put(ts->env);
+	rlib_fold_put(ts->env);
+}
+
+void test_script_end(struct test_script *ts) {
+	int_free_env(ts->env);
+	free_memory_region(ts->parse_region);
+	free_memory_region(ts->sym_region);
+}
+
+struct r_val test_eval(struct test_script *ts, const char *src) {
+	struct parse_node *expr = par_parse("test", src, ts->parse_region, ts->sym_region);
+	if(expr == NULL)
+		return (struct r_val) { .type = TYPE_NULL };
+	
+	return int_eval_expr(expr, ts->env, "test");
+}
+
+bool test_eval_prints(struct test_script *ts, const char *src, const char *expected) {
+	struct r_val val = test_eval(ts, src);
+	
+	size_t len = fmt_r_val_len(val);
+	char *text = s_alloc(len + 1);
+	bool same = fmt_write_r_val(text, val) == text + len && len == strlen(expected) && memcmp(text, expected, len) == 0;
+	
+	s_dealloc(text);
+	int_decr_refcount(val);
+	return same;
+}
+
+static void *(*real_alloc)(size_t);
+static unsigned long long n_allocs;
+
+static void *counting_alloc(size_t n) {
+	n_allocs++;
+	return real_alloc(n);
+}
+
+unsigned long long test_count_allocs(struct test_script *ts, const char *src) {
+	struct parse_node *expr = par_parse("test", src, ts->parse_region, ts->sym_region);
+	S_ASSERT(expr != NULL);
+	
+	real_alloc = s_alloc;
+	s_alloc = counting_alloc;
+	n_allocs = 0;
+	
+	int_decr_refcount(int_eval_expr(expr, ts->env, "test"));
+	
+	s_alloc = real_alloc;
+	return n_allocs;
+}
+
+#endif
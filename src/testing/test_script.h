@@ -0,0 +1,28 @@
+#ifndef TEST_SCRIPT_H_INCLUDED
+#define TEST_SCRIPT_H_INCLUDED
+
+#include "../interpreter/interpreter.h"
+
+/*
+ * Runs snippets of script against an environment with every builtin in it, for the tests of the rlib modules. The
+ * parse regions live as long as the environment, as lambdas keep pointing into them.
+ */
+
+struct test_script {
+	struct interp_env *env;
+	memory_region *parse_region, *sym_region;
+};
+
+void test_script_start(struct test_script *ts);
+void test_script_end(struct test_script *ts);
+
+//The value of src, which the caller owns; Null if it doesn't parse
+struct r_val test_eval(struct test_script *ts, const char *src);
+//Whether src evaluates to a value that prints as expected
+bool test_eval_prints(struct test_script *ts, const char *src, const char *expected);
+//Asserts the above, for tests that keep their script in a struct test_script named ts
+#define PRINTS(src, expected) S_ASSERT(test_eval_prints(&ts, src, expected))
+//The number of allocations made evaluating src and freeing its value, for telling whether a builtin reused an argument
+unsigned long long test_count_allocs(struct test_script *ts, const char *src);
+
+#endif
@@ -1,7 +1,43 @@
 #include "tests.h"
 
 void do_utf8_tests();
+void do_search_tests();
+void do_regex_tests();
+void do_map_tests();
+void do_persistent_tests();
+void do_intvec_tests();
+void do_sort_tests();
+void do_fold_tests();
+void do_array_tests();
+void do_iter_tests();
+void do_range_tests();
+void do_reuse_tests();
+void do_format_tests();
+void do_proc_tests();
 
 void do_tests() {
 	do_utf8_tests();
+	do_search_tests();
+	do_regex_tests();
+	do_map_tests();
+	do_persistent_tests();
+	do_intvec_tests();
+	do_sort_tests();
+	do_fold_tests();
+	do_array_tests();
+	do_iter_tests();
+	do_range_tests();
+	do_reuse_tests();
+	do_format_tests();
+	do_proc_tests();
 }
+
+#ifdef BENCHMARKS
+
+void do_search_bench();
+
+void do_benchmarks() {
+	do_search_bench();
+}
+
+#endif
@@ -9,4 +9,9 @@ void do_tests();
 	#define DO_TESTS() do_tests()
 #endif
 
+//Benchmarks are only built with -DBENCHMARKS and run with --benchmark
+#ifdef BENCHMARKS
+	void do_benchmarks();
+#endif
+
 #endif
@@ -2,6 +2,8 @@
 
 #include "../tui/utf8.h"
 
+#include <string.h>
+
 static void test1() {
 	const char *str1 = "λåð";
 	const char *str1_end = str1 + sizeof("λåð") - 1;
@@ -19,7 +21,27 @@ static void test2() {
 	S_ASSERT(utf8_get_char_end(str1, str1 + 2) == str1 + 1);
 }
 
+#ifndef NO_INCLUDE_ASSERTS
+
+static void test3() {
+	const char *str = "plain ascii text, longer than sixteen bytes λåð";
+	size_t len = strlen(str);
+	
+	S_ASSERT(utf8_ascii_prefix(str, len) == len - 6);
+	S_ASSERT(utf8_validate(str, len));
+	S_ASSERT(utf8_count_valid_chars(str, len) == len - 3);
+	
+	S_ASSERT(!utf8_validate("\xC0\x80", 2)); //Overlong
+	S_ASSERT(!utf8_validate("\xED\xA0\x80", 3)); //Surrogate
+	S_ASSERT(!utf8_validate("\xF4\x90\x80\x80", 4)); //Above U+10FFFF
+	S_ASSERT(!utf8_validate("\xE2\x82", 2)); //Cut off
+	S_ASSERT(utf8_validate("\xF0\x9F\x98\x80", 4));
+}
+
+#endif
+
 void do_utf8_tests() {
 	test1();
 	test2();
+	IF_ASSERTS(test3());
 }
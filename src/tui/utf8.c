@@ -2,6 +2,10 @@
 
 #include <stddef.h>
 
+#ifdef __SSE2__
+	#include <emmintrin.h>
+#endif
+
 //https://en.wikipedia.org/wiki/UTF-8#Encoding
 const char *utf8_get_char_start(const char *ch, const char *lower_limit_c) {
 	const unsigned char *c = (const unsigned char *) ch;
@@ -85,3 +89,88 @@ unsigned utf8_count_chars(const char *from, const char *to) {
 	
 	return n;
 }
+
+size_t utf8_ascii_prefix(const char *str, size_t len) {
+	size_t i = 0;
+	
+#ifdef __SSE2__
+	for(; i + 16 <= len; i += 16) {
+		int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) (str + i)));
+		if(mask != 0)
+			return i + __builtin_ctz(mask);
+	}
+#endif
+	
+	for(; i < len; i++) {
+		if((unsigned char) str[i] & 128)
+			break;
+	}
+	
+	return i;
+}
+
+bool utf8_validate(const char *str, size_t len) {
+	const unsigned char *c = (const unsigned char *) str;
+	size_t i = 0;
+	
+	while(i < len) {
+		i += utf8_ascii_prefix(str + i, len - i);
+		if(i == len)
+			break;
+		
+		unsigned n_cont;
+		unsigned min_second = 0x80, max_second = 0xBF;
+		
+		if(c[i] >= 0xC2 && c[i] <= 0xDF) {
+			n_cont = 1;
+		} else if(c[i] >= 0xE0 && c[i] <= 0xEF) {
+			n_cont = 2;
+			if(c[i] == 0xE0)
+				min_second = 0xA0; //Overlong
+			else if(c[i] == 0xED)
+				max_second = 0x9F; //Surrogates
+		} else if(c[i] >= 0xF0 && c[i] <= 0xF4) {
+			n_cont = 3;
+			if(c[i] == 0xF0)
+				min_second = 0x90; //Overlong
+			else if(c[i] == 0xF4)
+				max_second = 0x8F; //Above U+10FFFF
+		} else {
+			return false;
+		}
+		
+		if(len - i <= n_cont)
+			return false;
+		
+		if(c[i + 1] < min_second || c[i + 1] > max_second)
+			return false;
+		for(unsigned j = 2; j <= n_cont; j++) {
+			if((c[i + j] >> 6) != 2)
+				return false;
+		}
+		
+		i += n_cont + 1;
+	}
+	
+	return true;
+}
+
+size_t utf8_count_valid_chars(const char *str, size_t len) {
+	size_t n = 0, i = 0;
+	
+#ifdef __SSE2__
+	//Every byte that isn't a continuation byte (0x80-0xBF) starts a character; as signed bytes those are exactly the ones below (char) 0xC0
+	const __m128i first_lead = _mm_set1_epi8((char) 0xC0);
+	for(; i + 16 <= len; i += 16) {
+		__m128i chunk = _mm_loadu_si128((const __m128i *) (str + i));
+		n += 16 - __builtin_popcount(_mm_movemask_epi8(_mm_cmplt_epi8(chunk, first_lead)));
+	}
+#endif
+	
+	for(; i < len; i++) {
+		if(((unsigned char) str[i] >> 6) != 2)
+			n++;
+	}
+	
+	return n;
+}
@@ -7,4 +7,16 @@ const char *utf8_get_char_end(const char *ch, const char *end_c);
 
 unsigned utf8_count_chars(const char *from, const char *to);
 
+#include <stdbool.h>
+#include <stddef.h>
+
+//Length of the leading run of ascii bytes
+size_t utf8_ascii_prefix(const char *str, size_t len);
+
+//Strict validation: rejects overlong forms, surrogates and code points above U+10FFFF
+bool utf8_validate(const char *str, size_t len);
+
+//Character count of text that is known to be valid utf8
+size_t utf8_count_valid_chars(const char *str, size_t len);
+
 #endif